@@ -0,0 +1,91 @@
+#ifndef R_ARENA_H
+#define R_ARENA_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+// bump allocator for things that only live until the end of a frame
+// allocating is a pointer bump, freeing is a no-op, and Reset throws the
+// lot away at once
+// if a frame needs more than the arena has, it spills into extra blocks;
+// the next Reset swaps them all for one block big enough to hold that frame,
+// so after the first few frames it stops touching the heap at all
+// not thread safe; give each thread its own
+class RArena {
+public:
+  RArena(size_t capacity = 64 * 1024);
+  ~RArena();
+
+  // never NULL; whatever it points to is gone at the next Reset
+  void *Allocate(size_t bytes, size_t align = alignof(max_align_t));
+
+  void Reset();
+
+  size_t GetUsed();
+  size_t GetCapacity();
+
+  // how many times the arena has had to go to the heap since it was made
+  int GetGrowCount();
+
+private:
+  typedef struct RArenaBlock {
+    RArenaBlock *next;
+    size_t size;
+  } RArenaBlock;
+
+  RArenaBlock *NewBlock(size_t size);
+
+  // the one block that survives a reset
+  char *base;
+  size_t capacity;
+  size_t used;
+
+  // spill blocks for this frame, newest first
+  RArenaBlock *spill;
+  char *spillTop;
+  size_t spillLeft;
+  size_t spillUsed;
+
+  int growCount;
+};
+
+// lets std containers live in an arena; deallocate does nothing, so they
+// only make sense for things thrown away with the arena
+template <typename T> class RArenaAllocator {
+public:
+  typedef T value_type;
+
+  RArenaAllocator(RArena *arena) : arena(arena) {}
+
+  template <typename U>
+  RArenaAllocator(const RArenaAllocator<U> &other) : arena(other.GetArena()) {}
+
+  T *allocate(size_t n) {
+    return (T *)arena->Allocate(n * sizeof(T), alignof(T));
+  }
+
+  void deallocate(T *, size_t) {}
+
+  RArena *GetArena() const { return arena; }
+
+private:
+  RArena *arena;
+};
+
+template <typename T, typename U>
+bool operator==(const RArenaAllocator<T> &a, const RArenaAllocator<U> &b) {
+  return a.GetArena() == b.GetArena();
+}
+
+template <typename T, typename U>
+bool operator!=(const RArenaAllocator<T> &a, const RArenaAllocator<U> &b) {
+  return a.GetArena() != b.GetArena();
+}
+
+typedef std::basic_string<char, std::char_traits<char>, RArenaAllocator<char>>
+    RArenaString;
+
+template <typename T> using RArenaVector = std::vector<T, RArenaAllocator<T>>;
+
+#endif
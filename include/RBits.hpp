@@ -0,0 +1,30 @@
+#ifndef R_BITS_H
+#define R_BITS_H
+
+#include <SDL_stdinc.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// index of the highest set bit, 0 for the lowest; value can't be 0
+inline int HighestBit(Uint64 value) {
+#if defined(__GNUC__)
+  return 63 - __builtin_clzll(value);
+#elif defined(_MSC_VER) && defined(_M_X64)
+  unsigned long bit;
+  _BitScanReverse64(&bit, value);
+
+  return bit;
+#else
+  int bit = 0;
+
+  while (value >>= 1) {
+    bit++;
+  }
+
+  return bit;
+#endif
+}
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef R_CAMERA_H
+#define R_CAMERA_H
+
+#include <SDL_rect.h>
+#include <SDL_render.h>
+
+// what part of the level is on screen, and how big
+// the view is a screen rect (the level area) looking at a rect of the world;
+// everything level side gets drawn between Begin and End in view coords,
+// i.e. world coords minus the (whole px) camera position, and SDL scales
+// them up by the zoom
+class RCamera {
+public:
+  RCamera();
+
+  // screen px the level gets drawn into
+  void SetViewport(int width, int height);
+
+  // world px the camera may look at; it never shows past these
+  void SetBounds(int width, int height);
+
+  void SetZoomLimits(float minZoom, float maxZoom);
+
+  // output px per screen px, for when the screen is drawn at a lower
+  // resolution and scaled up afterwards; End leaves the renderer at this
+  void SetPixelScale(float pixelScale);
+
+  float GetX();
+  float GetY();
+  float GetZoom();
+
+  // visible part of the world, rounded outwards
+  SDL_Rect GetView();
+
+  // by screen px, so panning feels the same at every zoom
+  void Pan(float dx, float dy);
+
+  // keeps whatever's under (screenX, screenY) there
+  void ZoomAt(float factor, int screenX, int screenY);
+
+  void ScreenToWorld(int screenX, int screenY, int *worldX, int *worldY);
+
+  // where to draw something between Begin and End
+  void WorldToView(int worldX, int worldY, int *viewX, int *viewY);
+
+  // for culling; anything touching the view counts
+  bool IsVisible(SDL_Rect *worldRect);
+  bool IsVisible(int worldX, int worldY, int halfWidth, int halfHeight);
+
+  // scales the renderer and clips to the view
+  void Begin(SDL_Renderer *renderer);
+  void End(SDL_Renderer *renderer);
+
+private:
+  void Clamp();
+
+  float x, y;
+  float zoom;
+  float minZoom, maxZoom;
+  float pixelScale;
+
+  int viewportWidth, viewportHeight;
+  int boundsWidth, boundsHeight;
+};
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef R_COMMAND_H
+#define R_COMMAND_H
+
+#include <mutex>
+#include <vector>
+
+// everything the player can do to the simulation goes through one of these;
+// the sim thread is the only one allowed to touch the world directly
+typedef enum RCommandType {
+  C_SPAWN_ENEMY, // a: enemy color
+  C_SET_TARGET   // a, b: level coords the crosshair was placed at
+} RCommandType;
+
+typedef struct RCommand {
+  RCommandType type;
+  int a;
+  int b;
+} RCommand;
+
+class RCommandQueue {
+public:
+  void Push(RCommandType type, int a = 0, int b = 0);
+
+  // moves everything pushed so far into out, oldest first
+  void Drain(std::vector<RCommand> &out);
+
+private:
+  std::mutex mutex;
+  std::vector<RCommand> pending;
+};
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef R_CROWD_LOD_H
+#define R_CROWD_LOD_H
+
+#include "RCamera.hpp"
+#include "RDrawList.hpp"
+#include "RRenderQueue.hpp"
+#include <vector>
+
+// units that fell into one cell of the cluster grid this frame
+typedef struct RCrowdCell {
+  int count;
+  int minX, minY;
+  int maxX, maxY;
+  int colors[3];
+} RCrowdCell;
+
+// picks how much detail to draw units with, from how many were on screen
+// last frame and how far out the camera is, and at the lowest detail lumps
+// dense clusters together
+// levels go up as soon as a threshold is crossed but only come back down
+// once well under it, so a crowd hovering around one doesn't flicker
+class RCrowdLod {
+public:
+  RCrowdLod();
+
+  // visible units from which detail is used; 0 turns the level off
+  void SetCountThreshold(RCrowdDetail detail, int visible);
+
+  // zoom at or below which detail is used; 0 turns the level off
+  void SetZoomThreshold(RCrowdDetail detail, float zoom);
+
+  // world px per cluster cell, and how many units a cell needs before it's
+  // drawn as one
+  void SetClusterSize(int cellSize, int minUnits);
+
+  // always draw at full detail
+  void SetEnabled(bool enabled);
+
+  // call once a frame before drawing; visible is what was drawn last frame
+  RCrowdDetail Update(int visible, float zoom);
+  RCrowdDetail GetDetail();
+
+  // bins the visible units into cells; after this, IsClustered says which
+  // ones not to draw and SubmitClusters draws them instead
+  // halfSize is about half a unit across; returns how many were visible
+  int Cluster(std::vector<REntityDrawItem> &units, RCamera *camera,
+              int halfSize);
+  bool IsClustered(int unit);
+  void SubmitClusters(RRenderQueue *queue, RCamera *camera);
+
+private:
+  int countThresholds[CD_IMPOSTORS + 1];
+  float zoomThresholds[CD_IMPOSTORS + 1];
+
+  int cellSize;
+  int minClusterUnits;
+  int unitHalfSize;
+
+  bool enabled;
+  RCrowdDetail detail;
+
+  // grid over the view, rebuilt every frame
+  SDL_Rect gridArea;
+  int gridCols, gridRows;
+  std::vector<RCrowdCell> cells;
+
+  // cell per unit, -1 if it's off screen
+  std::vector<int> unitCells;
+};
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef R_DRAW_LIST_H
+#define R_DRAW_LIST_H
+
+#include "RCamera.hpp"
+#include "REntity.hpp"
+#include "RRenderQueue.hpp"
+#include "RSprite.hpp"
+#include "RTexture.hpp"
+#include <SDL.h>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+typedef enum RSound { S_SHOOT_ENEMY, S_SHOOT_TOWER, S_HIT_ENEMY } RSound;
+
+// something for the renderer to make a show of; like sounds, these are only
+// sent once
+typedef enum REffectType { FX_HIT, FX_EXPLOSION } REffectType;
+
+typedef struct REffect {
+  REffectType type;
+  int posX, posY;
+} REffect;
+
+// how much of each unit to draw; each level drops a bit more than the last
+// see RCrowdLod for picking one
+typedef enum RCrowdDetail {
+  CD_FULL,
+  CD_HURT_BARS,     // health bars only once a unit has taken damage
+  CD_FIXED_TURRETS, // turrets drawn as they are on the sheet, unrotated
+  CD_NO_TURRETS,
+  CD_IMPOSTORS // like CD_NO_TURRETS, and dense clusters become one blob
+} RCrowdDetail;
+
+typedef struct REntityDrawItem {
+  EntityKind kind;
+  EnemyColor color;
+  int posX, posY;
+  float weaponAngle;
+  int health, maxHealth;
+} REntityDrawItem;
+
+typedef struct RProjectileDrawItem {
+  int posX, posY;
+  EntityKind issuerKind;
+} RProjectileDrawItem;
+
+// picture of the world after one sim tick
+// only holds plain values (never pointers into the world) so the renderer can
+// read it while the sim is already computing the next tick
+class RDrawList {
+public:
+  RDrawList();
+
+  // empties the list but keeps its memory around for the next tick
+  void Clear();
+
+  // these queue up the draws for an item, skipping anything the camera can't
+  // see; return whether they queued anything
+  // sprites are drawn at whatever frame they're on, so advance them once a
+  // frame before submitting
+  static bool SubmitProjectile(RRenderQueue *queue, RProjectileDrawItem *item,
+                               RTexture *texture, RCamera *camera);
+  static bool SubmitEntity(RRenderQueue *queue, REntityDrawItem *item,
+                           RSprite *bodySprite, RSprite *weaponSprite,
+                           RCamera *camera, RCrowdDetail detail = CD_FULL);
+
+  // x, y is the entity's center in view coords
+  static void SubmitHealthBar(RRenderQueue *queue, REntityDrawItem *item,
+                              int x, int y, int bodyHeight);
+
+  Uint64 tick;
+
+  std::vector<RProjectileDrawItem> projectiles;
+  std::vector<REntityDrawItem> enemies;
+  std::vector<REntityDrawItem> towers;
+
+  // sounds and effects triggered since the last published list
+  std::vector<RSound> sounds;
+  std::vector<REffect> effects;
+
+  int enemyTargetX, enemyTargetY;
+
+  int defenderHealth;
+
+  int amtRed;
+  int amtGreen;
+  int amtYellow;
+};
+
+// triple buffer between the sim thread (writer) and the render thread (reader)
+// each list is owned by exactly one side at a time; the lock only guards the
+// index swap, never the contents
+class RDrawListBuffer {
+public:
+  RDrawListBuffer();
+
+  // sim side: fill this, then publish it
+  RDrawList *GetWriteList();
+  void Publish();
+
+  // at most this many of the newest sounds and effects in a list the
+  // renderer never picked up are passed on to the next one; set before the
+  // sim starts publishing
+  void SetCarryLimits(int maxSounds, int maxEffects);
+
+  // render side: returns the newest published list, waiting up to timeoutMs
+  // for one newer than the last; isNew tells whether we actually got one
+  RDrawList *Acquire(int timeoutMs, bool *isNew);
+
+private:
+  RDrawList lists[3];
+
+  int writeIndex;
+  int readyIndex;
+  int readIndex;
+
+  // ready list hasn't been picked up by the renderer yet
+  bool fresh;
+
+  int maxCarriedSounds;
+  int maxCarriedEffects;
+
+  std::mutex mutex;
+  std::condition_variable published;
+};
+
+#endif
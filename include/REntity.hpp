@@ -1,11 +1,11 @@
 #ifndef RAT_H
 #define RAT_H
 
-#include "RSprite.hpp"
-#include "RTexture.hpp"
-#include "RTimer.hpp"
-#include <SDL_mixer.h>
-#include <SDL_render.h>
+#include "RFixed.hpp"
+#include "RPath.hpp"
+#include "RSnapshot.hpp"
+#include <SDL_rect.h>
+#include <SDL_stdinc.h>
 #include <vector>
 
 typedef enum EntityKind{
@@ -13,41 +13,69 @@ typedef enum EntityKind{
   TOWER
 } EntityKind;
 
+// how a tower picks between enemies in range
+typedef enum RTargetPolicy{
+  T_FIRST,    // furthest along the path
+  T_CLOSEST,
+  T_WEAKEST,  // least health left
+  T_STRONGEST // most health left
+} RTargetPolicy;
+
 typedef enum EnemyColor{
   E_RED,
   E_GREEN,
   E_YELLOW
 } EnemyColor;
 
-// you can do this ???
-class REntity;
-
-class RProjectile {
-public:
-  RProjectile(REntity* issuer, RTexture *projectileTexture);
-
-  int GetPosX();
-  int GetPosY();
-  REntity *GetIssuer();
-
-  void SetPos(int x, int y);
-  void SetVel(int vx, int vy);
-
-  void Move();
-
-  void Render(SDL_Renderer *renderer);
-
-private:
+// for colors that come from outside, like commands and saved files
+inline bool IsEnemyColor(int color) {
+  return color >= E_RED && color <= E_YELLOW;
+}
+
+inline bool IsTargetPolicy(int policy) {
+  return policy >= T_FIRST && policy <= T_STRONGEST;
+}
+
+// longest wait between two events for one entity, in seconds; well past any
+// real fire rate or retarget interval, and short enough that the step counts
+// they turn into can't overflow
+const float MAX_EVENT_SECONDS = 3600;
+
+// for rates and intervals from outside, which end up as step counts; NaN, 0
+// and anything that would overflow one are out
+inline bool IsEventSeconds(float seconds) {
+  return seconds > 0 && seconds <= MAX_EVENT_SECONDS;
+}
+
+// refers to an entity by its slot in the world's REntityPool
+// the generation says which occupant of the slot is meant, so a handle to an
+// entity that's gone stops resolving instead of pointing at whoever took
+// its place; generation 0 is never handed out, so a zeroed handle is null
+typedef struct REntityHandle {
+  Uint32 index;
+  Uint32 generation;
+} REntityHandle;
+
+const REntityHandle NULL_HANDLE = {0, 0};
+
+inline bool operator==(REntityHandle a, REntityHandle b) {
+  return a.index == b.index && a.generation == b.generation;
+}
+
+inline bool operator!=(REntityHandle a, REntityHandle b) { return !(a == b); }
+
+// everything needed to put a new projectile in the world
+typedef struct RProjectileSpawn {
   int posX, posY;
   int velX, velY;
-
-  RTexture *texture;
-  REntity *issuer;
-};
+  int damage;
+  REntityHandle issuer;
+  EntityKind issuerKind;
+} RProjectileSpawn;
 
 class REntity {
 public:
-  REntity(EntityKind kind, RSprite *bodySprite, RSprite *weaponSprite, Mix_Chunk *shootSound);
+  REntity(EntityKind kind);
 
   bool IsAtEndOfPath();
 
@@ -55,57 +83,94 @@ public:
   int GetPosY();
   int GetProjectileDamage();
   int GetHealth();
+  int GetMaxHealth();
   float GetFireRate();
+  RReal GetWeaponAngle();
+  RReal GetPathProgress();
+  RReal GetRange();
+  RTargetPolicy GetTargetPolicy();
+  REntityHandle GetLockedTarget();
+  REntityHandle GetHandle();
+  EntityKind GetKind();
+  EnemyColor GetColor();
   SDL_Rect *GetRect();
 
   static bool CheckCollision(SDL_Rect *a, SDL_Rect *b);
   static bool CheckCollision(SDL_Rect *a, int x, int y);
-  static float Distance(int x1, int y1, int x2, int y2);
 
-  void SetPos(float x, float y);
-  void SetVel(float vx, float vy);
-  void SetTarget(float x, float y);
+  // true if the segment (x0, y0) -> (x1, y1) touches a; t is how far along
+  // it first does, 0 at the start and 1 at the end
+  static bool SweepCollision(SDL_Rect *a, int x0, int y0, int x1, int y1,
+                             RReal *t);
+  static RReal Distance(int x1, int y1, int x2, int y2);
+
+  void SetPos(RReal x, RReal y);
+  void SetVel(RReal vx, RReal vy);
+  void SetTarget(RReal x, RReal y);
   void SetProjectileSpeed(int speed);
   void SetFireRate(int rate);
-  void AddToShootTimer(float amt);
-  void SetPath(SDL_Point *path, int pathLength);
-  void SetSpeed(int speed);
+  // pathId is which of the world's paths this is, for snapshots
+  void SetPath(RPath *path, int pathId = 0);
+  void SetMaxHealth(int health);
+  void SetSpeed(RReal speed);
+  void SetSize(int w, int h);
+  void SetColor(EnemyColor color);
+  void SetRange(RReal range);
+  void SetTargetPolicy(RTargetPolicy policy);
+  void SetLockedTarget(REntityHandle target);
+
+  // a weapon that came due with nothing to shoot at waits here until there
+  // is something
+  bool IsWeaponReady();
+  void SetWeaponReady(bool ready);
+
+  // set when the tower's scheduled look for a better target comes up, and
+  // cleared once it has had it
+  bool IsRetargetDue();
+  void SetRetargetDue(bool due);
+
+  // set by the pool when the entity is created
+  void SetHandle(REntityHandle handle);
 
   void TakeDamage(int amt);
   void Heal(int amt);
 
   void Move();
-  void MoveAlongPath();
+  void MoveAlongPath(float dt);
+  void Aim();
+  void UpdateRect();
 
-  void Shoot(RTexture *projectileTexture,
-             std::vector<RProjectile *> &gRProjectiles, float dt);
+  // fills in a projectile fired along the weapon angle
+  // when to fire is up to whoever calls this; see RWorld's scheduler
+  void Fire(RProjectileSpawn *fired);
 
-  void RenderHealthBar(SDL_Renderer *renderer);
-  void Render(SDL_Renderer *renderer, float dt);
+  // path is only remembered by its id; Load looks it up in paths
+  void Save(RSnapshotWriter *out);
+  bool Load(RSnapshotReader *in, const std::vector<RPath *> &paths);
 
 private:
-  RSprite *bodySprite;
-  RSprite *weaponSprite;
-  Mix_Chunk *shootSound;
-
-  // these are stored as floats for calculation purposes
+  // these are stored as reals for calculation purposes
   // but should be rounded to ints for rendering
-  float posX, posY;
-  float velX, velY;
-  float targetX, targetY;
+  RReal posX, posY;
+  RReal velX, velY;
+  RReal targetX, targetY;
 
-  int speed;
+  // px per second along the path
+  RReal speed;
 
   int projectileSpeed;
   int projectileDamage;
 
-  SDL_Point *path;
-  int pathLength;
-  int nextPathPoint;
+  RPath *path;
+  int pathId;
 
-  // used for projectile motion, set by rendering
-  RTimer shootTimer;
-  float weaponAngle;
+  // how far along the path we are, and which segment that puts us on
+  RReal pathDistance;
+  int pathSegment;
+
+  // used for projectile motion, set by aiming
+  RReal weaponAngle;
+  bool weaponReady;
 
   // in seconds
   float fireRate;
@@ -114,10 +179,19 @@ private:
   int maxHealth;
   int health;
 
+  // targeting (towers only)
+  RReal range;
+  RTargetPolicy targetPolicy;
+  REntityHandle lockedTarget;
+  bool retargetDue;
+
   // identifier
+  REntityHandle handle;
   EntityKind kind;
+  EnemyColor color;
 
   // rect/collider
+  int width, height;
   SDL_Rect rect;
 };
 
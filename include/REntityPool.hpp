@@ -0,0 +1,47 @@
+#ifndef R_ENTITY_POOL_H
+#define R_ENTITY_POOL_H
+
+#include "REntity.hpp"
+#include <SDL_stdinc.h>
+#include <deque>
+#include <vector>
+
+// owns every entity in the world
+// slots are reused once their entity is destroyed, and each reuse bumps the
+// slot's generation so handles to whoever was there before stop resolving
+// entities never move once created, so pointers are fine within a tick;
+// anything kept longer than that should hold a handle
+class REntityPool {
+public:
+  REntityPool();
+
+  REntityHandle Create(EntityKind kind);
+  void Destroy(REntityHandle handle);
+  void Clear();
+
+  // NULL if the handle is null or its entity has been destroyed
+  REntity *Get(REntityHandle handle);
+
+  // makes sure there are at least capacity slots, so creating up to that
+  // many entities never allocates
+  void Reserve(int capacity);
+  bool IsValid(REntityHandle handle);
+
+  // live entities, and slots including free ones
+  int GetCount();
+  int GetCapacity();
+
+  // slot indexes waiting to be reused
+  const std::vector<Uint32> &GetFreeSlots();
+
+  void Save(RSnapshotWriter *out);
+  bool Load(RSnapshotReader *in, const std::vector<RPath *> &paths);
+
+private:
+  // deque so growing never moves the entities already there
+  std::deque<REntity> slots;
+  std::vector<Uint32> generations;
+  std::vector<Uint32> freeSlots;
+};
+
+#endif
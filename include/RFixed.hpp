@@ -0,0 +1,147 @@
+#ifndef R_FIXED_H
+#define R_FIXED_H
+
+#include <SDL_stdinc.h>
+
+// 16.16 fixed point, for sim math that has to come out the same everywhere
+//
+// Floats only add, subtract, multiply and divide the same on every machine;
+// sqrt, atan2, sin and cos come from whatever libm and compiler flags the
+// build got. Everything here is integer math, including the tables, so the
+// same inputs give the same bits on any compiler and cpu.
+//
+// Range is +-32767 with a resolution of 1/65536; products and quotients
+// are worked out in 64 bits, but anything that leaves the range wraps like
+// an int would. Squared distances across the level don't fit, which is what
+// FixedHypot is for.
+
+const int FIXED_SHIFT = 16;
+const Sint32 FIXED_ONE = 1 << FIXED_SHIFT;
+
+class RFixed {
+public:
+  // left alone, like a float
+  RFixed() = default;
+  RFixed(int value) : raw(value * FIXED_ONE) {}
+
+  // floats have to be let in on purpose, rounded to nearest; doubles not at
+  // all, so a stray 0.5 doesn't quietly go through the int constructor
+  explicit RFixed(float value)
+      : raw((Sint32)(value * FIXED_ONE + (value < 0 ? -0.5f : 0.5f))) {}
+  RFixed(double value) = delete;
+
+  static RFixed FromRaw(Sint32 raw) {
+    RFixed out;
+    out.raw = raw;
+    return out;
+  }
+
+  Sint32 GetRaw() const { return raw; }
+
+  // towards zero, like a float to int cast
+  explicit operator int() const {
+    return raw >= 0 ? raw >> FIXED_SHIFT : -(-raw >> FIXED_SHIFT);
+  }
+
+  explicit operator float() const { return raw / (float)FIXED_ONE; }
+
+  RFixed operator-() const { return FromRaw(-raw); }
+
+  RFixed &operator+=(RFixed other) {
+    raw += other.raw;
+    return *this;
+  }
+
+  RFixed &operator-=(RFixed other) {
+    raw -= other.raw;
+    return *this;
+  }
+
+  RFixed &operator*=(RFixed other) {
+    raw = (Sint32)(((Sint64)raw * other.raw) >> FIXED_SHIFT);
+    return *this;
+  }
+
+  // dividing by zero gives the biggest value of the right sign, not a trap
+  RFixed &operator/=(RFixed other) {
+    if (other.raw == 0) {
+      raw = raw >= 0 ? SDL_MAX_SINT32 : SDL_MIN_SINT32;
+    } else {
+      raw = (Sint32)(((Sint64)raw * FIXED_ONE) / other.raw);
+    }
+
+    return *this;
+  }
+
+private:
+  Sint32 raw;
+};
+
+// free so ints convert on either side
+inline RFixed operator+(RFixed a, RFixed b) { return a += b; }
+inline RFixed operator-(RFixed a, RFixed b) { return a -= b; }
+inline RFixed operator*(RFixed a, RFixed b) { return a *= b; }
+inline RFixed operator/(RFixed a, RFixed b) { return a /= b; }
+
+inline bool operator==(RFixed a, RFixed b) { return a.GetRaw() == b.GetRaw(); }
+inline bool operator!=(RFixed a, RFixed b) { return !(a == b); }
+inline bool operator<(RFixed a, RFixed b) { return a.GetRaw() < b.GetRaw(); }
+inline bool operator>(RFixed a, RFixed b) { return b < a; }
+inline bool operator<=(RFixed a, RFixed b) { return !(b < a); }
+inline bool operator>=(RFixed a, RFixed b) { return !(a < b); }
+
+const RFixed FIXED_PI = RFixed::FromRaw(205887);
+const RFixed FIXED_HALF_PI = RFixed::FromRaw(102944);
+
+// 0 for anything not above 0
+RFixed FixedSqrt(RFixed x);
+
+// sqrt(dx * dx + dy * dy) without the squares having to fit
+RFixed FixedHypot(RFixed dx, RFixed dy);
+
+// radians in -pi..pi, same as atan2; 0 for (0, 0)
+// this and sin/cos are within a few 1/65536ths of the real thing
+RFixed FixedAtan2(RFixed y, RFixed x);
+
+// radians, any size; from a table
+RFixed FixedSin(RFixed angle);
+RFixed FixedCos(RFixed angle);
+
+// The number type the sim runs on. Floats by default; building with
+// R_FIXED_POINT (GAME_FIXED_POINT in cmake) switches it to RFixed so
+// replays, snapshots and network games match across compilers and cpus.
+// Builds only ever agree with builds of the same kind, which is what
+// SIM_FIXED_POINT is checked against.
+//
+// Code that's meant to work either way sticks to the Real functions below,
+// casts with (RReal), (int) and (float), and keeps squares of positions out
+// of RReal.
+#ifdef R_FIXED_POINT
+typedef RFixed RReal;
+const bool SIM_FIXED_POINT = true;
+#else
+typedef float RReal;
+const bool SIM_FIXED_POINT = false;
+#endif
+
+inline float RealSqrt(float x) { return SDL_sqrtf(x); }
+inline RFixed RealSqrt(RFixed x) { return FixedSqrt(x); }
+
+inline float RealHypot(float dx, float dy) {
+  return SDL_sqrtf(dx * dx + dy * dy);
+}
+
+inline RFixed RealHypot(RFixed dx, RFixed dy) { return FixedHypot(dx, dy); }
+
+// the float one has always gone through double; it stays that way so float
+// builds play out exactly as they used to
+inline float RealAtan2(float y, float x) { return SDL_atan2(y, x); }
+inline RFixed RealAtan2(RFixed y, RFixed x) { return FixedAtan2(y, x); }
+
+inline float RealSin(float angle) { return SDL_sinf(angle); }
+inline RFixed RealSin(RFixed angle) { return FixedSin(angle); }
+
+inline float RealCos(float angle) { return SDL_cosf(angle); }
+inline RFixed RealCos(RFixed angle) { return FixedCos(angle); }
+
+#endif
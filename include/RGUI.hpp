@@ -54,11 +54,9 @@ public:
 
     // check if mouse clicking
     if (e->type == SDL_MOUSEBUTTONDOWN) {
-      // check if mouse in bounds
-      int mouseX = 0;
-      int mouseY = 0;
-
-      SDL_GetMouseState(&mouseX, &mouseY);
+      // check if mouse in bounds, where it was when clicked
+      int mouseX = e->button.x;
+      int mouseY = e->button.y;
 
       SDL_Rect *area = graphic->GetArea();
 
@@ -0,0 +1,47 @@
+#ifndef R_HISTOGRAM_H
+#define R_HISTOGRAM_H
+
+#include <SDL_stdinc.h>
+#include <vector>
+
+// hdr style histogram of non-negative integers
+// every power of two range gets the same number of linear buckets, so
+// percentiles come out within 1 / 2^(subBucketBits - 1) of the real value
+// (under 2% at the default 7 bits) whatever the magnitude, with a fixed,
+// small amount of memory; recording is a couple of shifts and an increment
+class RHistogram {
+public:
+  // values above maxValue are counted as maxValue
+  RHistogram(Uint64 maxValue = 1, int subBucketBits = 7);
+
+  void Record(Uint64 value);
+
+  // adds in everything other has seen; both need the same layout
+  void Merge(const RHistogram &other);
+  void Reset();
+
+  Uint64 GetCount() const;
+  Uint64 GetMin() const;
+  Uint64 GetMax() const;
+  double GetMean() const;
+
+  // smallest value that p percent of the recorded values are at or under,
+  // to the bucket's precision
+  Uint64 GetPercentile(double p) const;
+
+private:
+  int GetIndex(Uint64 value) const;
+  Uint64 GetBucketTop(int index) const;
+
+  int subBucketBits;
+  int subBucketHalf;
+  Uint64 maxValue;
+
+  std::vector<Uint64> counts;
+
+  Uint64 count;
+  Uint64 min, max;
+  double sum;
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef R_INPUT_H
+#define R_INPUT_H
+
+#include <SDL.h>
+#include <SDL_events.h>
+#include <SDL_mouse.h>
+
+// mouse and input timing for the main thread, built up from the events
+// themselves instead of asking sdl for the mouse on every one of them
+// motion is coalesced: however many motion events a frame drains, what's
+// left is the newest position and the summed middle button drag
+// the oldest input that hasn't made it to the screen yet is remembered, so
+// each frame can report how long its input waited to be seen
+class RInput {
+public:
+  RInput();
+
+  // call for every polled event, in order
+  void HandleEvent(const SDL_Event *e);
+
+  // pumps the os queue and takes the mouse position as of right now, for
+  // things drawn under the cursor; the pumped events stay queued and are
+  // handled as usual next frame
+  void Latch();
+
+  int GetMouseX() const;
+  int GetMouseY() const;
+  bool IsLeftDown() const;
+
+  // middle button drag since the last call
+  void TakeDrag(int *dx, int *dy);
+
+  // call right after presenting
+  // returns ms from the oldest input this frame showed to now, or -1 if no
+  // input came in since the last present
+  int Presented();
+
+private:
+  void Stamp(Uint32 timestamp);
+
+  int mouseX, mouseY;
+  bool leftDown;
+
+  int dragX, dragY;
+
+  bool pending;
+  Uint32 pendingSince;
+};
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef R_JOB_SYSTEM_H
+#define R_JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// called once per chunk with the [begin, end) range it covers and its index
+// only refers to the callable, never copies it; ParallelFor blocks until
+// every chunk is done, so whatever is passed in always outlives its jobs
+// (a std::function would go to the heap for every lambda that captures
+// more than a couple of things, every tick)
+class RJobFunc {
+public:
+  template <typename F>
+  RJobFunc(const F &func) : object(&func), call(&Call<F>) {}
+
+  void operator()(int begin, int end, int chunk) const {
+    call(object, begin, end, chunk);
+  }
+
+private:
+  template <typename F>
+  static void Call(const void *object, int begin, int end, int chunk) {
+    (*(const F *)object)(begin, end, chunk);
+  }
+
+  const void *object;
+  void (*call)(const void *object, int begin, int end, int chunk);
+};
+
+typedef struct RJob {
+  const RJobFunc *func;
+  int begin;
+  int end;
+  int chunk;
+  std::atomic<int> *remaining;
+} RJob;
+
+// small work-stealing scheduler
+// every worker (plus whoever calls ParallelFor) owns a queue; it takes jobs
+// from the back of its own and steals from the front of everyone else's
+class RJobSystem {
+public:
+  // nWorkers < 0 picks one per spare core; 0 runs everything on the caller
+  RJobSystem(int nWorkers = -1);
+  ~RJobSystem();
+
+  int GetWorkerCount();
+
+  // chunk boundaries only depend on count and grain, never on the number of
+  // threads, so per-chunk results merged in chunk order are deterministic
+  static int GetChunkCount(int count, int grain);
+
+  // blocks until every chunk has run
+  void ParallelFor(int count, int grain, const RJobFunc &func);
+
+private:
+  // jobs[head] .. jobs.back() are waiting; a deque would hand blocks back
+  // and forth with the heap as jobs went in one end and out the other, this
+  // keeps its capacity once it has been as deep as it needs to be
+  typedef struct RJobQueue {
+    std::mutex mutex;
+    std::vector<RJob> jobs;
+    int head;
+  } RJobQueue;
+
+  void WorkerLoop(int queueIndex);
+
+  void Push(int queueIndex, RJob job);
+  bool Pop(int queueIndex, RJob *job);
+  bool Steal(int queueIndex, RJob *job);
+  void Run(RJob *job);
+
+  std::vector<std::thread> workers;
+
+  // one per worker, and the last one belongs to the caller
+  std::vector<RJobQueue *> queues;
+
+  std::atomic<int> queuedJobs;
+  std::atomic<bool> quitting;
+
+  std::mutex sleepMutex;
+  std::condition_variable wake;
+
+  // only one ParallelFor at a time
+  std::mutex callerMutex;
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef R_JSON_H
+#define R_JSON_H
+
+#include <string>
+#include <vector>
+
+typedef enum RJsonType {
+  J_NULL,
+  J_BOOL,
+  J_NUMBER,
+  J_STRING,
+  J_ARRAY,
+  J_OBJECT
+} RJsonType;
+
+// just enough json to read the map editor's files
+// the whole document is parsed into a tree of these; lookups that don't
+// match (wrong type, missing key, out of range) give NULL or the fallback
+// instead of failing, so callers only check what they care about
+class RJsonValue {
+public:
+  RJsonValue();
+
+  bool LoadFromFile(const char *path);
+
+  // length excludes any terminator; where names the text in error messages
+  bool Parse(const char *text, int length, const char *where = "json");
+
+  RJsonType GetType();
+
+  bool GetBool(bool fallback = false);
+  double GetNumber(double fallback = 0);
+  int GetInt(int fallback = 0);
+  std::string &GetString();
+
+  // items of an array, or members of an object
+  int GetSize();
+  RJsonValue *GetItem(int i);
+
+  // object members by name; the first one if it's there twice
+  RJsonValue *Get(const char *key);
+  std::string &GetKey(int i);
+
+private:
+  friend class RJsonParser;
+
+  RJsonType type;
+
+  bool boolean;
+  double number;
+  std::string string;
+
+  std::vector<RJsonValue> items;
+
+  // objects only, one per item
+  std::vector<std::string> keys;
+};
+
+#endif
@@ -0,0 +1,175 @@
+#ifndef R_LOCKSTEP_H
+#define R_LOCKSTEP_H
+
+#include "RCommand.hpp"
+#include "REntity.hpp"
+#include "RNet.hpp"
+#include <SDL_stdinc.h>
+#include <vector>
+
+// Lockstep multiplayer for two peers
+//
+// Only input goes over the wire. Whatever a peer does on tick t is applied
+// on tick t + inputDelay, on both machines, host's commands first; the sim is
+// deterministic, so the same commands on the same ticks from the same seed
+// give the same world everywhere. A peer can't run tick t until it has the
+// other's input for it, so the delay is how much latency gets hidden before
+// anyone has to wait.
+//
+// Every packet carries all of this peer's input the other side hasn't
+// acknowledged yet, so a lost packet costs nothing until the next one, and a
+// batch of ticks goes out together. Peers also trade a world hash every
+// NET_HASH_INTERVAL ticks; if they ever disagree the sims have split and
+// IsDesynced says since when.
+//
+// packets (little endian): "DTLS" u8 kind, then
+//   hello:   u8 protocol version, u8 fixed point, u64 wave schedule hash
+//   welcome: u32 seed, u8 input delay, u64 wave schedule hash,
+//            u8 tower policy, f32 retarget interval
+//   input:   varint next tick wanted, varint hash tick, u64 hash,
+//            varint first tick, u8 frames, then per frame
+//              u8 commands, then per command u8 type, zigzag varint a, b
+
+const int NET_PROTOCOL_VERSION = 4;
+
+const int NET_HASH_INTERVAL = 60;
+
+// hashes of ours kept around for when the other side's show up
+const int NET_HASH_SLOTS = 8;
+
+// input delay can't get near this; it's how far apart the peers can be
+const int NET_FRAME_WINDOW = 256;
+const int NET_MAX_INPUT_DELAY = 60;
+
+// per tick per peer; more than this waits for the next tick
+const int NET_MAX_COMMANDS = 32;
+
+typedef struct RNetStats {
+  Uint64 packetsSent;
+  Uint64 packetsReceived;
+  Uint64 bytesSent;
+  Uint64 bytesReceived;
+
+  // times IsReady had to say no
+  Uint64 stalls;
+} RNetStats;
+
+typedef struct RNetFrame {
+  Sint64 tick; // -1 if the slot's empty
+  std::vector<RCommand> commands;
+} RNetFrame;
+
+typedef struct RNetHash {
+  Sint64 tick;
+  Uint64 hash;
+} RNetHash;
+
+class RLockstep {
+public:
+  RLockstep();
+
+  // waits up to timeout seconds for someone to join; the seed, delay and
+  // tower targeting are handed to them
+  // waveHash is RWaveSchedule::Hash of this side's waves; only a peer with
+  // the same ones gets in, on either side
+  bool Host(int port, Uint32 seed, int inputDelay, RTargetPolicy towerPolicy,
+            float retargetInterval, Uint64 waveHash, float timeout);
+
+  // address is host:port, of the host or a relay in front of it
+  bool Join(const char *address, Uint64 waveHash, float timeout);
+
+  bool IsActive();
+  bool IsHost();
+
+  Uint32 GetSeed();
+  int GetInputDelay();
+
+  // what both sides pass to RWorld::SetTowerTargeting
+  RTargetPolicy GetTowerPolicy();
+  float GetRetargetInterval();
+
+  // reads everything waiting and sends if there's anything to send
+  // call often; at least once a tick
+  void Poll();
+
+  // whether everyone's input for tick is in; once the other side has gone
+  // quiet for too long it stops waiting for them
+  bool IsReady(Uint64 tick);
+
+  // commands are this peer's input for now, to be applied inputDelay ticks
+  // from now; they're replaced with everyone's input for tick, host first
+  // only call once IsReady(tick)
+  void Exchange(Uint64 tick, std::vector<RCommand> *commands);
+
+  // the world's hash after tick; call every NET_HASH_INTERVAL ticks
+  void RecordHash(Uint64 tick, Uint64 hash);
+
+  bool IsDesynced();
+  Uint64 GetDesyncTick();
+
+  bool IsPeerLost();
+
+  RNetStats GetStats();
+
+private:
+  void Start();
+
+  void HandlePacket(const RNetAddress &from, const Uint8 *data, int size);
+  void HandleInput(const Uint8 *data, int size);
+
+  void SendHello();
+  // to whoever said hello, who isn't necessarily the peer yet
+  void SendWelcome(const RNetAddress &to);
+  void SendInput();
+  void SendPacket(const Uint8 *data, int size);
+  void SendPacket(const RNetAddress &to, const Uint8 *data, int size);
+
+  void CheckHashes();
+
+  int GetLocalPeer();
+
+  RUdpSocket socket;
+  RNetAddress peer;
+
+  bool active;
+  bool host;
+  bool peerLost;
+
+  Uint32 seed;
+  int inputDelay;
+  RTargetPolicy towerPolicy;
+  float retargetInterval;
+  Uint64 waveHash;
+
+  // the host we tried to join has different waves
+  bool refused;
+
+  // indexed by tick % NET_FRAME_WINDOW, for both peers
+  std::vector<RNetFrame> frames[2];
+
+  // our input that's waiting for a tick with room in it
+  std::vector<RCommand> overflow;
+
+  // first tick of ours the other side doesn't have yet, and of theirs we
+  // don't have; everything before is in
+  Uint64 peerHas;
+  Uint64 weHave;
+
+  // first tick of ours with no input yet, and the tick the sim is on
+  Uint64 nextLocal;
+  Uint64 simTick;
+
+  RNetHash localHashes[NET_HASH_SLOTS];
+  RNetHash lastLocalHash;
+  RNetHash peerHash;
+
+  bool desynced;
+  Uint64 desyncTick;
+
+  Uint64 lastHeard;
+  Uint64 lastSent;
+
+  RNetStats stats;
+};
+
+#endif
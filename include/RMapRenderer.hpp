@@ -0,0 +1,88 @@
+#ifndef R_MAP_RENDERER_H
+#define R_MAP_RENDERER_H
+
+#include "RCamera.hpp"
+#include "RTileMap.hpp"
+#include <SDL.h>
+#include <vector>
+
+// draws a tile map a chunk at a time
+// each chunk (a square of tiles) is baked into its own render target the
+// first time it comes into view, so drawing the visible map is one copy per
+// chunk no matter how many tiles or layers it has. Baked chunks are kept
+// around until they'd put us over the vram budget, then the least recently
+// seen ones go first
+class RMapRenderer {
+public:
+  RMapRenderer();
+  ~RMapRenderer();
+
+  // drops anything baked for the old map
+  void SetMap(RTileMap *map);
+
+  // in tiles per side; also drops anything baked
+  void SetChunkTiles(int chunkTiles);
+
+  // in bytes, assuming 4 per px
+  void SetBudget(int bytes);
+
+  // chunk px per map px; no point baking finer than the screen gets drawn
+  // also drops anything baked
+  void SetBakeScale(float bakeScale);
+
+  // bakes whatever the camera is about to show
+  // switches render targets, which resets the renderer's scale; call it
+  // before the camera's Begin
+  void Prepare(SDL_Renderer *renderer, RCamera *camera);
+
+  // between the camera's Begin/End
+  void Render(SDL_Renderer *renderer, RCamera *camera);
+
+  // every baked chunk; after SDL_RENDER_TARGETS_RESET they're garbage
+  void Invalidate();
+
+  int GetCachedChunks();
+  int GetCachedBytes();
+
+private:
+  typedef struct RMapChunk {
+    SDL_Texture *texture;
+    int bytes;
+
+    // frame it was last on screen
+    Uint64 lastSeen;
+  } RMapChunk;
+
+  // chunk coords covering the camera's view
+  void GetVisibleChunks(RCamera *camera, int *minX, int *minY, int *maxX,
+                        int *maxY);
+  SDL_Rect GetChunkRect(int chunkX, int chunkY);
+
+  bool Bake(SDL_Renderer *renderer, int chunkX, int chunkY);
+
+  // frees least recently seen chunks until bytes more would fit; chunks on
+  // screen this frame are never evicted, even if that means going over
+  void MakeRoom(int bytes);
+
+  // what Render falls back to if a chunk couldn't be baked
+  void RenderTiles(SDL_Renderer *renderer, RCamera *camera, int chunkX,
+                   int chunkY);
+
+  RTileMap *map;
+
+  int chunkTiles;
+  int nChunksX;
+  int nChunksY;
+
+  std::vector<RMapChunk> chunks;
+
+  float bakeScale;
+
+  int budget;
+  int cachedBytes;
+  int cachedChunks;
+
+  Uint64 frame;
+};
+
+#endif
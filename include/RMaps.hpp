@@ -0,0 +1,12 @@
+#ifndef R_MAPS_H
+#define R_MAPS_H
+
+#include "RPath.hpp"
+
+// the paths tanks follow on each map; the game, the perf scenarios and the
+// net check all play on these, so they only live here
+
+// map0's road, in level pixels through the middle of each tile it turns on
+void MakeMap0Path(RPath *path);
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef R_MEMORY_H
+#define R_MEMORY_H
+
+#include <SDL_stdinc.h>
+#include <stdio.h>
+
+// what memory is for, so growth can be pinned on a subsystem
+typedef enum RMemTag {
+  MEM_OTHER,
+  MEM_WORLD,
+  MEM_ENTITY,
+  MEM_PROJECTILE,
+  MEM_TEXTURE,
+  MEM_MAP,
+  MEM_PARTICLE,
+  MEM_TAG_COUNT
+} RMemTag;
+
+typedef struct RMemStats {
+  Uint64 allocs;
+  Uint64 frees;
+  Sint64 bytes;
+  Sint64 peakBytes;
+} RMemStats;
+
+// memory telemetry
+// heap: with GAME_TRACK_ALLOCATIONS on, every new/delete is counted under
+// whatever tag the allocating thread has set (see RMemScope); memory that
+// doesn't come from new (like the projectile store's aligned arrays) is
+// reported by hand through Track
+// gpu: textures report what they take up on the card, as best we can tell
+// from their size and format
+class RMemory {
+public:
+  // whether new/delete are being counted in this build
+  static bool IsTrackingHeap();
+
+  static const char *GetTagName(RMemTag tag);
+
+  static RMemStats GetHeapStats(RMemTag tag);
+  static RMemStats GetGpuStats(RMemTag tag);
+
+  // summed over every tag; peaks are of the sum, not summed peaks
+  static RMemStats GetHeapTotal();
+  static RMemStats GetGpuTotal();
+
+  // bytes > 0 is an allocation, < 0 a free
+  static void Track(RMemTag tag, Sint64 bytes);
+  static void TrackGpu(RMemTag tag, Sint64 bytes);
+
+  // starts every peak over from what's in use right now
+  static void ResetPeaks();
+
+  // one line per tag
+  static void Dump(FILE *out);
+
+  // new calls made on the calling thread so far; always 0 unless tracking
+  static Uint64 GetThreadAllocs();
+
+  // tag for new allocations on this thread
+  static RMemTag GetTag();
+  static void SetTag(RMemTag tag);
+};
+
+// tags this thread's allocations until it goes out of scope
+class RMemScope {
+public:
+  RMemScope(RMemTag tag);
+  ~RMemScope();
+
+private:
+  RMemTag previous;
+};
+
+#endif
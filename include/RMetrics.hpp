@@ -0,0 +1,82 @@
+#ifndef R_METRICS_H
+#define R_METRICS_H
+
+#include "RHistogram.hpp"
+#include <SDL_stdinc.h>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef enum RMetricsFormat {
+  MF_PROMETHEUS, // text exposition format, as a summary per metric
+  MF_JSON_LINES  // one object per export with every metric in it
+} RMetricsFormat;
+
+// named histograms that get written out every so often for whatever's
+// watching the machine to pick up
+// percentiles cover what was recorded since the last export; count and sum
+// are since the start, like prometheus expects
+// Record can be called from any thread; exporting happens on a thread of its
+// own so a slow disk never shows up as a slow frame
+class RMetrics {
+public:
+  RMetrics();
+  ~RMetrics();
+
+  // values are recorded as integers in whatever unit suits them and
+  // multiplied by scale on the way out (1e-6 for microseconds -> seconds)
+  // returns the id to record with; add everything before Start
+  int Add(const char *name, const char *help, Uint64 maxValue,
+          double scale = 1);
+
+  void Record(int metric, Uint64 value);
+
+  // path is a file, or "unix:<path>" for a unix socket that gets a
+  // connection per export; prometheus files are replaced whole (through a
+  // rename, so a scrape never sees half of one), json lines are appended
+  bool Start(const char *path, RMetricsFormat format, float interval);
+
+  // writes once more and stops the thread
+  void Stop();
+
+  // formats and resets the current window
+  void Format(RMetricsFormat format, std::string *out);
+
+private:
+  typedef struct RMetric {
+    std::string name;
+    std::string help;
+    double scale;
+
+    RHistogram window;
+
+    Uint64 totalCount;
+    double totalSum;
+  } RMetric;
+
+  void ExportLoop();
+  bool Export();
+
+  bool WriteFile(const std::string &text);
+  bool WriteSocket(const std::string &text);
+
+  std::vector<RMetric> metrics;
+  std::mutex metricsMutex;
+
+  std::string path;
+  bool toSocket;
+  RMetricsFormat format;
+  float interval;
+
+  // only complain once about a target that's gone
+  bool failing;
+
+  std::thread exporter;
+  bool running;
+  std::mutex runMutex;
+  std::condition_variable stopped;
+};
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef R_NET_H
+#define R_NET_H
+
+#include "RRandom.hpp"
+#include <SDL_stdinc.h>
+#include <atomic>
+#include <vector>
+
+// big enough for any packet we send, small enough not to get fragmented
+const int NET_MAX_PACKET = 1200;
+
+typedef struct RNetAddress {
+  Uint32 host; // ipv4, host byte order
+  Uint16 port;
+} RNetAddress;
+
+// "host:port", where host is a name or dotted quad
+bool ResolveAddress(const char *text, RNetAddress *out);
+
+bool SameAddress(const RNetAddress &a, const RNetAddress &b);
+
+// steady ms clock for timeouts and resends; only differences mean anything
+Uint64 NetMilliseconds();
+
+// non-blocking udp socket; ipv4 only
+class RUdpSocket {
+public:
+  RUdpSocket();
+  ~RUdpSocket();
+
+  // port 0 lets the os pick one
+  bool Open(int port);
+  void Close();
+
+  bool IsOpen();
+  int GetPort();
+
+  bool Send(const RNetAddress &to, const Uint8 *data, int size);
+
+  // size of the packet read, or -1 if nothing's waiting
+  int Receive(RNetAddress *from, Uint8 *data, int capacity);
+
+private:
+  Sint64 fd;
+};
+
+// a packet sitting in the relay until it's due
+typedef struct RDelayedPacket {
+  Uint64 due; // NetMilliseconds
+  RNetAddress to;
+  int size;
+  Uint8 data[NET_MAX_PACKET];
+} RDelayedPacket;
+
+// sits between two peers on one machine and makes the link as bad as asked:
+// every packet is held for latency +- jitter ms (so they can arrive out of
+// order) and loss percent of them never arrive at all
+// everything from the host goes to whoever last sent from anywhere else, and
+// everything from anywhere else goes to the host, so the joining side just
+// joins the relay's port instead of the host's
+class RNetRelay {
+public:
+  RNetRelay();
+
+  bool Open(int port, const RNetAddress &host);
+  void SetConditions(int latency, int jitter, float loss);
+
+  // forwards whatever's due; never blocks
+  void Update();
+
+  // Update until stop is set
+  void Run(const std::atomic<bool> *stop);
+
+  int GetPort();
+
+  Uint64 GetForwarded();
+  Uint64 GetDropped();
+
+private:
+  RUdpSocket socket;
+
+  RNetAddress host;
+  RNetAddress guest;
+  bool hasGuest;
+
+  int latency;
+  int jitter;
+  float loss;
+
+  RRandom random;
+
+  std::vector<RDelayedPacket> queue;
+
+  Uint64 forwarded;
+  Uint64 dropped;
+};
+
+#endif
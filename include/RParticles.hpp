@@ -0,0 +1,71 @@
+#ifndef R_PARTICLES_H
+#define R_PARTICLES_H
+
+#include "RCamera.hpp"
+#include "RDrawList.hpp"
+#include "RRandom.hpp"
+#include "RTexture.hpp"
+#include <SDL.h>
+#include <vector>
+
+// explosions, sparks and the like; purely visual, so it lives on the
+// render side and never feeds back into the sim
+// every particle plays through the same sprite sheet over its life, so the
+// whole lot is drawn from one texture in one batch. Storage is one array
+// per field, allocated once up front; when it's full new particles are
+// simply dropped
+class RParticleSystem {
+public:
+  RParticleSystem(int capacity);
+
+  // frames laid out left to right
+  void SetSheet(RTexture *sheet, int frameWidth, int frameHeight,
+                int nFrames);
+
+  // size is in px, shrinking (or growing) from startSize to endSize
+  // velocity in px per second
+  void Spawn(float x, float y, float vx, float vy, float life,
+             float startSize, float endSize);
+
+  // turns what the sim reported into particles
+  void SpawnEffects(std::vector<REffect> &effects);
+
+  void Update(float dt);
+
+  // between the camera's Begin/End; skips what it can't see
+  void Render(SDL_Renderer *renderer, RCamera *camera);
+
+  int GetCount();
+  int GetCapacity();
+
+  // most effects that could still show up at once, going by the smallest;
+  // past this, more of them only get dropped
+  int GetEffectCapacity();
+
+private:
+  void Burst(float x, float y, int nSparks, float size, float speed);
+
+  int capacity;
+  int count;
+
+  std::vector<float> posX, posY;
+  std::vector<float> velX, velY;
+  std::vector<float> age, life;
+  std::vector<float> startSize, endSize;
+
+  RTexture *sheet;
+  int frameWidth;
+  int frameHeight;
+  int nFrames;
+
+  // looks only, so it doesn't have to be the sim's
+  RRandom random;
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+  // 4 vertices and 6 indices per particle; indices never change
+  std::vector<SDL_Vertex> vertices;
+  std::vector<int> indices;
+#endif
+};
+
+#endif
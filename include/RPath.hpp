@@ -0,0 +1,38 @@
+#ifndef R_PATH_H
+#define R_PATH_H
+
+#include "RFixed.hpp"
+#include <SDL_rect.h>
+#include <vector>
+
+// a path preprocessed into segments with their cumulative lengths and
+// directions, so anything following it only needs to keep one number: how far
+// along it is
+class RPath {
+public:
+  RPath();
+
+  // copies the points; all the sqrt-ing happens here, once
+  void SetPoints(SDL_Point *points, int nPoints);
+
+  int GetPointCount();
+  SDL_Point *GetPoint(int i);
+  RReal GetLength();
+
+  // position at the given distance along the path
+  // segment is the segment the caller was last on; it only ever needs to
+  // step forward, so keeping it makes this O(1) for anything moving forward
+  void GetPosition(RReal distance, int *segment, RReal *x, RReal *y);
+
+private:
+  std::vector<SDL_Point> points;
+
+  // distance from the start to each point
+  std::vector<RReal> cumulative;
+
+  // unit direction of each segment
+  std::vector<RReal> dirX;
+  std::vector<RReal> dirY;
+};
+
+#endif
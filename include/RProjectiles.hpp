@@ -0,0 +1,64 @@
+#ifndef R_PROJECTILES_H
+#define R_PROJECTILES_H
+
+#include "REntity.hpp"
+#include <SDL_stdinc.h>
+
+// every projectile in the world, stored as one array per field
+// the position/velocity arrays are 32 byte aligned and padded so the
+// integration kernel can stream through them with SSE2/AVX2
+class RProjectileStore {
+public:
+  RProjectileStore();
+  RProjectileStore(const RProjectileStore &other);
+  ~RProjectileStore();
+
+  RProjectileStore &operator=(const RProjectileStore &other);
+
+  int GetCount();
+
+  Sint32 *GetPosX();
+  Sint32 *GetPosY();
+  Sint32 *GetVelX();
+  Sint32 *GetVelY();
+  int *GetDamage();
+  REntityHandle *GetIssuer();
+  EntityKind *GetIssuerKind();
+
+  // nonzero marks a projectile for removal on the next Compact
+  Uint8 *GetDeadMask();
+
+  void Reserve(int capacity);
+  void Add(RProjectileSpawn *spawn);
+
+  // sets the count directly, e.g. before filling the arrays from a snapshot
+  // anything past the old count is left for the caller to fill in
+  void Resize(int count);
+  void Clear();
+
+  // moves projectiles [begin, end) by steps times their velocity and flags
+  // the ones that left the 0..width, 0..height box in the dead mask; returns
+  // how many did
+  // ranges starting on a multiple of 8 keep the vector loads aligned
+  int Integrate(int begin, int end, int width, int height, int steps);
+
+  // drops everything flagged in the dead mask, keeping the rest in order
+  void Compact();
+
+private:
+  void Free();
+
+  int count;
+  int capacity;
+
+  Sint32 *posX;
+  Sint32 *posY;
+  Sint32 *velX;
+  Sint32 *velY;
+  int *damage;
+  REntityHandle *issuer;
+  EntityKind *issuerKind;
+  Uint8 *dead;
+};
+
+#endif
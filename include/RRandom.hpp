@@ -0,0 +1,30 @@
+#ifndef R_RANDOM_H
+#define R_RANDOM_H
+
+#include <SDL_stdinc.h>
+
+// small seedable generator (xorshift64*)
+// unlike rand() its whole state is one number we own, so a sim seeded the
+// same way always rolls the same
+class RRandom {
+public:
+  RRandom(Uint64 seed = 1);
+
+  void Seed(Uint64 seed);
+
+  Uint64 GetState();
+  void SetState(Uint64 state);
+
+  Uint32 Next();
+
+  // 0 <= result < n
+  int Range(int n);
+
+  // 0 <= result < 1
+  float Float();
+
+private:
+  Uint64 state;
+};
+
+#endif
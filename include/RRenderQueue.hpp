@@ -0,0 +1,82 @@
+#ifndef R_RENDER_QUEUE_H
+#define R_RENDER_QUEUE_H
+
+#include "RTexture.hpp"
+#include <SDL.h>
+#include <vector>
+
+// back to front; inside a layer, things are grouped by texture/colour so the
+// renderer doesn't have to keep switching
+typedef enum RRenderLayer {
+  L_PROJECTILES,
+  L_TANK_BODIES,
+  L_TANK_WEAPONS,
+  L_TOWER_BASES,
+  L_TOWER_WEAPONS,
+  L_BAR_FRAMES,
+  L_BAR_FILLS
+} RRenderLayer;
+
+// either a (possibly rotated) piece of a texture or a filled rect
+typedef struct RRenderItem {
+  Uint32 material;
+  SDL_BlendMode blend;
+
+  // center of the texture, or the rect to fill
+  SDL_Rect dest;
+
+  SDL_Rect clip;
+  bool clipped;
+
+  double angle;
+} RRenderItem;
+
+// what an item is drawn with; a texture, or a colour if there isn't one
+typedef struct RMaterial {
+  RTexture *texture;
+  SDL_Color color;
+} RMaterial;
+
+// collects a frame's draws, then sorts them by (layer, blend, material) and
+// draws them in that order
+// the sort is stable, so items with the same key keep the order they were
+// submitted in
+class RRenderQueue {
+public:
+  RRenderQueue();
+
+  // clip may be NULL for the whole texture; x, y is where its center goes
+  void SubmitTexture(RRenderLayer layer, RTexture *texture, SDL_Rect *clip,
+                     int x, int y, double angle = 0,
+                     SDL_BlendMode blend = SDL_BLENDMODE_BLEND);
+  void SubmitFill(RRenderLayer layer, SDL_Color color, SDL_Rect *rect,
+                  SDL_BlendMode blend = SDL_BLENDMODE_NONE);
+
+  // draws everything submitted since the last flush and empties the queue
+  void Flush(SDL_Renderer *renderer);
+
+  int GetSize();
+
+  // how many times the last flush had to switch texture, colour or blend
+  int GetStateChanges();
+
+private:
+  Uint32 GetMaterial(RTexture *texture, SDL_Color color);
+  void Submit(RRenderLayer layer, SDL_BlendMode blend, RRenderItem *item);
+
+  // lsd radix sort on the top 32 bits of keys, one byte per pass
+  void Sort();
+
+  std::vector<RRenderItem> items;
+
+  // sort key in the top half, index into items in the bottom half
+  std::vector<Uint64> keys;
+  std::vector<Uint64> scratch;
+
+  // textures and colours live for the whole run, so ids are never reused
+  std::vector<RMaterial> materials;
+
+  int stateChanges;
+};
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef R_REPLAY_H
+#define R_REPLAY_H
+
+#include "RCommand.hpp"
+#include "RWorld.hpp"
+#include <SDL_stdinc.h>
+#include <stdio.h>
+#include <vector>
+
+// Replays are the seed plus every command with the tick it was applied on;
+// the sim is deterministic so that's all it takes to play a session again.
+//
+// file layout (little endian):
+//   "DTRP" u8 version u8 fixed point u32 seed u16 tick rate
+//   u64 wave schedule hash, u8 tower policy, f32 retarget interval
+//   records: u8 kind, varint ticks since previous record, then
+//     command: u8 type, zigzag varint a, zigzag varint b
+//     hash:    u64 world hash after that tick, to catch desyncs
+//     end:     nothing; its tick is the last one played
+
+const int REPLAY_VERSION = 4;
+
+// ticks between state hashes written while recording
+const int REPLAY_HASH_INTERVAL = 120;
+
+// ticks between keyframes kept while playing back
+const int REPLAY_KEYFRAME_INTERVAL = 600;
+
+typedef struct RReplayCommand {
+  Uint64 tick;
+  RCommand command;
+} RReplayCommand;
+
+typedef struct RReplayHash {
+  Uint64 tick;
+  Uint64 hash;
+} RReplayHash;
+
+typedef struct RKeyframe {
+  Uint64 tick;
+  std::vector<Uint8> snapshot;
+} RKeyframe;
+
+class RReplayRecorder {
+public:
+  RReplayRecorder();
+  ~RReplayRecorder();
+
+  // waveHash is RWaveSchedule::Hash of the waves the session started with;
+  // the tower targeting is what it was set up with, as for SetTowerTargeting
+  bool Open(const char *path, Uint32 seed, int tickRate, Uint64 waveHash,
+            RTargetPolicy towerPolicy, float retargetInterval);
+  bool IsOpen();
+
+  // tick is the one the command is applied before
+  void RecordCommand(Uint64 tick, RCommand *command);
+
+  // tick is the one the world just finished
+  void RecordHash(Uint64 tick, Uint64 hash);
+
+  void Close(Uint64 finalTick);
+
+private:
+  void WriteRecord(Uint8 kind, Uint64 tick);
+  void WriteByte(Uint8 value);
+  void WriteVarint(Uint64 value);
+
+  FILE *file;
+  Uint64 lastTick;
+};
+
+class RReplayPlayer {
+public:
+  RReplayPlayer();
+
+  bool Load(const char *path);
+
+  Uint32 GetSeed();
+  int GetTickRate();
+  Uint64 GetWaveHash();
+  RTargetPolicy GetTowerPolicy();
+  float GetRetargetInterval();
+  Uint64 GetEndTick();
+  bool IsDesynced();
+
+  // world must already be seeded with GetSeed and set up the way it was when
+  // recording started; that state becomes the first keyframe
+  void Begin(RWorld *world);
+
+  // applies this tick's commands and runs the tick
+  void Step(RWorld *world);
+
+  // jumps to the given tick from the closest keyframe before it
+  void Seek(RWorld *world, Uint64 tick);
+
+private:
+  void CaptureKeyframe(RWorld *world);
+  void CheckHash(RWorld *world);
+
+  Uint32 seed;
+  int tickRate;
+  Uint64 waveHash;
+  RTargetPolicy towerPolicy;
+  float retargetInterval;
+  Uint64 endTick;
+
+  std::vector<RReplayCommand> commands;
+  std::vector<RReplayHash> hashes;
+
+  // next command/hash not applied/checked yet
+  int commandCursor;
+  int hashCursor;
+
+  bool desynced;
+
+  std::vector<RKeyframe> keyframes;
+};
+
+#endif
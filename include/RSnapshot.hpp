@@ -0,0 +1,61 @@
+#ifndef R_SNAPSHOT_H
+#define R_SNAPSHOT_H
+
+#include <SDL_stdinc.h>
+#include <string.h>
+#include <vector>
+
+// World snapshots are flat byte buffers: fixed size fields copied as they sit
+// in memory, arrays copied whole, and anything that was a pointer written as
+// an index. Nothing in them needs fixing up beyond turning indices back into
+// pointers, so saving and restoring is mostly memcpy.
+//
+// header: "DTSN" u16 version u8 fixed point u32 byte order mark, then
+// whatever RWorld::Save wrote. Snapshots only load on a machine with the same
+// byte order, into a build with the same kind of sim numbers (see RFixed.hpp).
+
+const int SNAPSHOT_VERSION = 6;
+
+class RSnapshotWriter {
+public:
+  RSnapshotWriter(std::vector<Uint8> *out);
+
+  void WriteHeader();
+
+  template <typename T> void Write(const T &value) {
+    WriteBytes(&value, sizeof(T));
+  }
+
+  void WriteBytes(const void *data, int nBytes);
+
+private:
+  std::vector<Uint8> *out;
+};
+
+class RSnapshotReader {
+public:
+  RSnapshotReader(const Uint8 *data, int size);
+
+  // false if this isn't a snapshot we know how to read
+  bool ReadHeader();
+
+  // these all return false once the data runs out; after that every read
+  // fails, so checking IsOk at the end is enough
+  template <typename T> bool Read(T *value) {
+    return ReadBytes(value, sizeof(T));
+  }
+
+  bool ReadBytes(void *data, int nBytes);
+
+  // true if at least nBytes are left
+  bool HasBytes(Sint64 nBytes);
+  bool IsOk();
+
+private:
+  const Uint8 *data;
+  int size;
+  int at;
+  bool ok;
+};
+
+#endif
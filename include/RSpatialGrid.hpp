@@ -0,0 +1,75 @@
+#ifndef R_SPATIAL_GRID_H
+#define R_SPATIAL_GRID_H
+
+#include <SDL_rect.h>
+#include <vector>
+
+// uniform grid of ids bucketed by the cells their rects (or points) overlap
+// rebuilt from scratch every tick: Clear, Insert everything, then Build
+// ids come back out of a cell in the order they were inserted
+class RSpatialGrid {
+public:
+  RSpatialGrid();
+
+  void Resize(int width, int height, int cellSize);
+
+  void Clear();
+  void Insert(int id, SDL_Rect *rect);
+  void InsertPoint(int id, int x, int y);
+  void Build();
+
+  // ids of everything overlapping the cell containing (x, y)
+  int QueryPoint(int x, int y, const int **ids);
+
+  // appends ids from every cell touching the given box; anything inserted as
+  // a rect may show up more than once, points only ever show up once
+  void QueryRect(int minX, int minY, int maxX, int maxY, std::vector<int> &out);
+
+  // calls func(id) for everything QueryRect would append, in the same order,
+  // without needing somewhere to put them first
+  template <typename F>
+  void ForEachInRect(int minX, int minY, int maxX, int maxY, const F &func);
+
+private:
+  int CellIndex(int cellX, int cellY);
+  int ClampCellX(int x);
+  int ClampCellY(int y);
+
+  int cellSize;
+  int nCellsX;
+  int nCellsY;
+
+  // (cell, id) pairs in insertion order, waiting for Build
+  std::vector<int> stagedCells;
+  std::vector<int> stagedIds;
+
+  // cellStart[c] .. cellStart[c + 1] indexes into cellIds
+  std::vector<int> cellStart;
+  std::vector<int> cellIds;
+  std::vector<int> cellCursor;
+};
+
+template <typename F>
+void RSpatialGrid::ForEachInRect(int minX, int minY, int maxX, int maxY,
+                                 const F &func) {
+  if (nCellsX == 0 || nCellsY == 0) {
+    return;
+  }
+
+  int cellMinX = ClampCellX(minX);
+  int cellMaxX = ClampCellX(maxX);
+  int cellMinY = ClampCellY(minY);
+  int cellMaxY = ClampCellY(maxY);
+
+  for (int y = cellMinY; y <= cellMaxY; ++y) {
+    for (int x = cellMinX; x <= cellMaxX; ++x) {
+      int cell = CellIndex(x, y);
+
+      for (int i = cellStart[cell]; i < cellStart[cell + 1]; ++i) {
+        func(cellIds[i]);
+      }
+    }
+  }
+}
+
+#endif
@@ -16,10 +16,15 @@ public:
   bool GetMovedFrame();
   float GetFrameTimer();
   SDL_Rect *GetRect();
+  RTexture *GetSheet();
+  SDL_Rect *GetClip();
 
   void SetFPS(int fps);
   void SetFrame(int f);
 
+  // moves the animation along; true if it changed frame
+  bool Update(float dt);
+
   bool Render(SDL_Renderer *renderer, float dt, int x, int y, double angle = 0);
 
 private:
@@ -0,0 +1,39 @@
+#ifndef R_TARGETING_H
+#define R_TARGETING_H
+
+#include "REntity.hpp"
+#include "RSpatialGrid.hpp"
+#include <vector>
+
+// picks targets for towers
+// enemies are indexed by position once per tick so a tower only looks at the
+// ones in the grid cells its range covers instead of every enemy
+class RTargeting {
+public:
+  RTargeting();
+
+  void Resize(int width, int height, int cellSize);
+
+  // call once per tick, before any FindTarget
+  void Index(std::vector<REntity *> &enemies);
+
+  // best enemy in range of the tower by its policy, or NULL if none is
+  // scratch holds query results; give each thread its own
+  REntity *FindTarget(REntity *tower, std::vector<REntity *> &enemies,
+                      std::vector<int> &scratch);
+
+  static bool InRange(REntity *tower, REntity *target);
+
+private:
+  // true if a should be picked over b
+  static bool IsBetter(RTargetPolicy policy, REntity *tower, REntity *a,
+                       REntity *b);
+
+  // in whole pixels; squares across the level don't fit in a fixed point
+  // RReal, and this way there's nothing to round either
+  static Sint64 DistanceSquared(REntity *a, REntity *b);
+
+  RSpatialGrid grid;
+};
+
+#endif
@@ -18,6 +18,10 @@ public:
 
   bool LoadFromFile(SDL_Renderer *renderer, const char *path, Uint8 r = 0,
                     Uint8 g = 0, Uint8 b = 0);
+
+  // same, but from an image file that's already in memory
+  bool LoadFromMemory(SDL_Renderer *renderer, const void *data, int size,
+                      Uint8 r = 0, Uint8 g = 0, Uint8 b = 0);
   void Free();
   void SetBlendMode(SDL_BlendMode blendMode);
   void ModColor(Uint8 r, Uint8 g, Uint8 b);
@@ -30,20 +34,37 @@ public:
   void Render(SDL_Renderer *renderer, int x, int y, int w, int h,
               SDL_Rect *clip = NULL);
 
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+  // lots of quads in one go; tex coords are 0..1 over the whole texture
+  void RenderGeometry(SDL_Renderer *renderer, const SDL_Vertex *vertices,
+                      int nVertices, const int *indices, int nIndices);
+#endif
+
   int GetWidth();
   int GetHeight();
   int GetWidthUnscaled();
   int GetHeightUnscaled();
   SDL_Rect *GetRect();
+  int GetScale();
   void SetScale(int nScale);
 
+  // roughly what a texture takes up on the gpu
+  static Sint64 GetTextureBytes(SDL_Texture *texture);
+
 private:
+  // takes ownership of the surface
+  bool LoadFromSurface(SDL_Renderer *renderer, SDL_Surface *surface, Uint8 r,
+                       Uint8 g, Uint8 b);
+
   SDL_Texture *texture;
   SDL_Rect renderDest;
 
   int width;
   int height;
   int scale;
+
+  // what we reported to RMemory, so Free can take it back
+  Sint64 gpuBytes;
 };
 
 #endif
@@ -0,0 +1,46 @@
+#ifndef R_TILE_GRID_H
+#define R_TILE_GRID_H
+
+#include "REntity.hpp"
+#include <vector>
+
+// which entity (if any) sits on each tile of the level
+// unlike RSpatialGrid this isn't rebuilt every tick; things claim a tile
+// when they're placed and give it back when they go, so asking what's on a
+// tile is a single lookup no matter how many things there are
+class RTileGrid {
+public:
+  RTileGrid();
+
+  void Resize(int gridWidth, int gridHeight, int tileWidth, int tileHeight);
+  void Clear();
+
+  int GetGridWidth();
+  int GetGridHeight();
+
+  bool InBounds(int tileX, int tileY);
+
+  // tile under a point in level coords; false if it's off the grid
+  bool TileAt(int x, int y, int *tileX, int *tileY);
+
+  // NULL_HANDLE for free tiles and anything off the grid
+  REntityHandle Get(int tileX, int tileY);
+  bool IsFree(int tileX, int tileY);
+
+  // false if the tile is taken or off the grid
+  bool Claim(int tileX, int tileY, REntityHandle handle);
+
+  // only frees the tile if handle is what's on it
+  void Release(int tileX, int tileY, REntityHandle handle);
+
+private:
+  int gridWidth;
+  int gridHeight;
+  int tileWidth;
+  int tileHeight;
+
+  // row major, gridWidth * gridHeight
+  std::vector<REntityHandle> tiles;
+};
+
+#endif
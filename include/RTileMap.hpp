@@ -0,0 +1,59 @@
+#ifndef R_TILE_MAP_H
+#define R_TILE_MAP_H
+
+#include "RTexture.hpp"
+#include <SDL.h>
+#include <deque>
+#include <vector>
+
+// one cell of one layer; sheet -1 means nothing's there
+typedef struct RTile {
+  Sint16 sheet;
+  Sint16 index;
+  bool flip;
+} RTile;
+
+// a map as the map editor saves it (assets/editables/map_editables)
+// tiles are square, cut from sprite sheets left to right, top to bottom;
+// the sheets are embedded in the file as base64 pngs
+class RTileMap {
+public:
+  RTileMap();
+
+  bool LoadFromFile(SDL_Renderer *renderer, const char *path);
+  void Free();
+
+  int GetTileSize();
+  int GetGridWidth();
+  int GetGridHeight();
+
+  // in px
+  int GetWidth();
+  int GetHeight();
+
+  int GetLayerCount();
+
+  // NULL off the grid
+  RTile *GetTile(int layer, int tileX, int tileY);
+
+  SDL_Color GetBackgroundColor();
+
+  // x, y is where the tile's top left corner goes
+  void RenderTile(SDL_Renderer *renderer, RTile *tile, int x, int y);
+
+private:
+  int tileSize;
+  int gridWidth;
+  int gridHeight;
+
+  SDL_Color background;
+
+  // deque so the textures never move (they free themselves when destroyed)
+  std::deque<RTexture> sheets;
+  std::vector<int> sheetColumns;
+
+  // bottom layer first, gridWidth * gridHeight each, row major
+  std::vector<std::vector<RTile>> layers;
+};
+
+#endif
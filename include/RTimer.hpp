@@ -6,6 +6,7 @@ public:
   RTimer();
 
   float GetTime();
+  bool IsRunning();
   
   void Start();
   void Stop();
@@ -0,0 +1,75 @@
+#ifndef R_TIMING_WHEEL_H
+#define R_TIMING_WHEEL_H
+
+#include "REntity.hpp"
+#include "RSnapshot.hpp"
+#include <SDL_stdinc.h>
+#include <vector>
+
+// things the world wants done at some later step
+typedef enum REventType{
+  EV_FIRE,        // entity fires its weapon
+  EV_SPAWN_GROUP, // a is the world's spawn group index
+  EV_RETARGET     // tower looks for a better target; a is the schedule it's
+                  // part of, see RWorld::SetTowerTargeting
+} REventType;
+
+typedef struct REvent {
+  Uint64 due;
+  Uint64 seq;
+  REventType type;
+  REntityHandle entity;
+  int a;
+} REvent;
+
+const int WHEEL_LEVELS = 4;
+const int WHEEL_SLOT_BITS = 6;
+const int WHEEL_SLOTS = 1 << WHEEL_SLOT_BITS;
+
+// hierarchical timing wheel, in steps
+// level 0 has a slot per step for the next 64 steps, level 1 a slot per 64
+// steps for the next 64 * 64, and so on; when the clock rolls over into a
+// slot on a higher level its events are spread back down. Advancing only
+// looks at the slots it passes, so however many events are waiting, a step
+// costs the same unless something is due
+// anything further out than the top level goes in an overflow list that is
+// looked at once per top level rotation (~38 hours at 120 steps/s)
+class RTimingWheel {
+public:
+  RTimingWheel();
+
+  Uint64 GetNow();
+  int GetCount();
+
+  // anything due at or before now lands on the next step
+  void Schedule(REventType type, Uint64 due, REntityHandle entity, int a = 0);
+
+  // moves the clock forward and appends every event that came due, in due
+  // order; events due on the same step come out in the order they were
+  // scheduled, however they got shuffled between levels
+  void Advance(int steps, std::vector<REvent> &due);
+
+  // appends every event still waiting, in no particular order
+  void GetEvents(std::vector<REvent> &events);
+
+  void Clear();
+
+  void Save(RSnapshotWriter *out);
+  bool Load(RSnapshotReader *in);
+
+private:
+  void Insert(REvent *event);
+  void Cascade(int level);
+
+  Uint64 now;
+  Uint64 nextSeq;
+  int count;
+
+  std::vector<REvent> slots[WHEEL_LEVELS][WHEEL_SLOTS];
+  std::vector<REvent> overflow;
+
+  // events being moved down a level
+  std::vector<REvent> cascading;
+};
+
+#endif
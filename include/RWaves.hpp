@@ -0,0 +1,50 @@
+#ifndef R_WAVES_H
+#define R_WAVES_H
+
+#include "REntity.hpp"
+#include <vector>
+
+// Wave files are plain text, one command per line, # for comments:
+//
+//   wave <delay>
+//   <color> <count> <interval> <path>
+//
+// wave starts a new wave delay seconds after the previous one finished
+// spawning (or after the start, for the first). Each spawn line under it is
+// a group of count tanks of one color (red, green or yellow), interval
+// seconds apart, sent down the world's path with that index. Groups within
+// a wave all start together.
+
+typedef struct RSpawnGroup {
+  EnemyColor color;
+  int count;
+  float interval;
+  int path;
+} RSpawnGroup;
+
+typedef struct RWave {
+  float delay;
+  std::vector<RSpawnGroup> groups;
+} RWave;
+
+class RWaveSchedule {
+public:
+  RWaveSchedule();
+
+  bool LoadFromFile(const char *path);
+
+  std::vector<RWave> &GetWaves();
+
+  // tanks over every wave; what to reserve room for
+  int GetTankCount();
+
+  // fingerprint of every wave and group, for checking that a replay or the
+  // other side of a network game has the same ones; empty schedules hash the
+  // same too
+  Uint64 Hash();
+
+private:
+  std::vector<RWave> waves;
+};
+
+#endif
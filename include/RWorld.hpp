@@ -0,0 +1,225 @@
+#ifndef R_WORLD_H
+#define R_WORLD_H
+
+#include "RCommand.hpp"
+#include "RDrawList.hpp"
+#include "REntity.hpp"
+#include "REntityPool.hpp"
+#include "RJobSystem.hpp"
+#include "RProjectiles.hpp"
+#include "RRandom.hpp"
+#include "RSnapshot.hpp"
+#include "RSpatialGrid.hpp"
+#include "RTargeting.hpp"
+#include "RTileGrid.hpp"
+#include "RTimingWheel.hpp"
+#include "RWaves.hpp"
+#include <SDL_rect.h>
+#include <SDL_stdinc.h>
+#include <vector>
+
+const int TILE_WIDTH = 128;
+const int TILE_HEIGHT = 128;
+
+const int LEVEL_GRID_WIDTH = 12;
+const int LEVEL_GRID_HEIGHT = 12;
+
+const int LEVEL_WIDTH = TILE_WIDTH * LEVEL_GRID_WIDTH;
+const int LEVEL_HEIGHT = TILE_HEIGHT * LEVEL_GRID_HEIGHT;
+
+// a wave's spawn group once it's been scheduled
+typedef struct RActiveSpawn {
+  RSpawnGroup group;
+  Uint64 startStep;
+  int spawned;
+} RActiveSpawn;
+
+typedef struct RHit {
+  int projectile;
+  REntity *entity;
+
+  // how far along this tick's move it hit, 0 to 1
+  RReal t;
+} RHit;
+
+// the sim's base unit of time; projectile velocities are in px per step,
+// scheduled events land on steps, and a tick covers however many steps fit
+// in its dt
+const int STEPS_PER_SECOND = 120;
+
+// all gameplay state lives here and is only ever touched by the sim thread
+// the renderer gets to see it through the draw lists built each tick
+class RWorld {
+public:
+  RWorld();
+
+  // copies are deep; the copy keeps its own job system though
+  RWorld(const RWorld &other);
+
+  RWorld &operator=(const RWorld &other);
+
+  Uint64 GetTick();
+  int GetDefenderHealth();
+  int GetEnemyAmount(EnemyColor color);
+
+  // fingerprint of the gameplay state; equal worlds hash equal
+  Uint64 Hash();
+
+  // everything random in the sim comes from here, so the same seed and the
+  // same commands always play out the same
+  void Seed(Uint32 seed);
+
+  // flat snapshot of all gameplay state; see RSnapshot.hpp
+  // Restore needs the path set first and leaves the world alone if the data
+  // isn't a snapshot it can read
+  void Save(std::vector<Uint8> *out);
+  bool Restore(const Uint8 *data, int size);
+
+  bool SaveSnapshot(const char *path);
+  bool LoadSnapshot(const char *path);
+
+  // SetPath replaces every path with just this one (path 0)
+  void SetPath(RPath *path);
+  int AddPath(RPath *path);
+  void SetJobSystem(RJobSystem *jobs);
+
+  // how towers pick targets, and how often (in seconds) they reconsider
+  // applies to towers already placed too
+  void SetTowerTargeting(RTargetPolicy policy, float retargetInterval);
+  RTargetPolicy GetTowerPolicy();
+  float GetRetargetInterval();
+
+  void HandleCommand(RCommand *command);
+
+  // for the player; comes out of their budget for that color
+  void SpawnEnemy(EnemyColor color);
+  // false if the tile is off the grid or already taken
+  bool SpawnTower(int gridX, int gridY);
+  void SpawnTowers(int nTowers);
+
+  // schedules every wave, starting from now
+  void StartWaves(RWaveSchedule *schedule);
+  void SetEnemyTarget(int x, int y);
+
+  // tower on the tile under (x, y), if there is one
+  REntity *GetTowerAt(int x, int y);
+
+  void Tick(float dt);
+
+  void BuildDrawList(RDrawList *list);
+
+  // for ticks nobody is going to see, e.g. when fast forwarding
+  void DiscardEffects();
+
+private:
+  void ParallelFor(int count, int grain, const RJobFunc &func);
+  void PrepareChunks(int nChunks);
+
+  // grows each chunk's query scratch to hold at least most ids
+  void ReserveQueries(int nChunks, int most);
+
+  // steps between shots
+  Uint64 GetFireInterval(REntity *entity);
+
+  // fires now and schedules the next shot relative to due
+  void FireWeapon(REntity *entity, Uint64 due);
+
+  // steps between a tower's looks for a better target
+  Uint64 GetRetargetSteps();
+
+  // first look for a tower; index spreads towers over the interval so they
+  // don't all look on the same step
+  void ScheduleRetarget(REntity *tower, int index);
+
+  void SpawnTank(EnemyColor color, int pathId);
+
+  // steps from a group's start until its index-th tank
+  Uint64 GetSpawnOffset(RActiveSpawn *spawn, int index);
+  void SpawnGroup(int index);
+
+  // advances the scheduler and handles whatever came due
+  void RunEvents(int steps);
+
+  void CheckProjectileCollisions(int steps);
+  void RemoveDeadEntities(std::vector<REntity *> &list);
+  void AddEffect(REffectType type, int x, int y);
+
+  // towers only remember their tile through their position
+  void ReleaseTile(REntity *tower);
+  void RebuildTiles();
+
+  void ClearFinishedEnemies();
+
+  void UpdateProjectiles(int steps);
+  void UpdateEnemies(float dt);
+  void UpdateTowers();
+
+  Uint64 tick;
+
+  // owns every entity; the lists below point into it
+  REntityPool entities;
+
+  std::vector<REntity *> enemies;
+  std::vector<REntity *> towers;
+  RProjectileStore projectiles;
+
+  RJobSystem *jobs;
+
+  // broad phase for projectile hits; one per side so lookups never see
+  // friendlies
+  RSpatialGrid enemyGrid;
+  RSpatialGrid towerGrid;
+
+  // which tower sits on each tile; derived from the towers, so snapshots
+  // don't carry it
+  RTileGrid towerTiles;
+
+  RRandom random;
+
+  // weapon fire, timed spawns and anything else that happens later
+  RTimingWheel scheduler;
+  std::vector<REvent> dueEvents;
+
+  RTargeting targeting;
+  RTargetPolicy towerPolicy;
+  float retargetInterval;
+
+  // bumped whenever retargeting is rescheduled; events from before that
+  // carry an older one and are let go
+  int retargetGeneration;
+
+  // per-chunk outputs of parallel passes, merged in chunk order afterwards
+  // so results don't depend on how many threads ran them
+  std::vector<std::vector<RHit>> chunkHits;
+  std::vector<std::vector<REntity *>> chunkReady;
+  std::vector<std::vector<int>> chunkQueries;
+
+  // list entries turned into handles while saving, and pending events being
+  // checked on restore or hashed
+  std::vector<REntityHandle> snapshotHandles;
+  std::vector<REvent> snapshotEvents;
+
+  std::vector<RPath *> paths;
+
+  // every group StartWaves scheduled; events refer to them by index
+  std::vector<RActiveSpawn> spawnGroups;
+
+  int amtRed;
+  int amtGreen;
+  int amtYellow;
+
+  int enemyTargetX;
+  int enemyTargetY;
+
+  // tower the player clicked to send the enemies at, if it's still around
+  REntityHandle selectedTower;
+
+  int defenderMaxHealth;
+  int defenderHealth;
+
+  // sounds and effects triggered since the last draw list was built
+  std::vector<RSound> sounds;
+  std::vector<REffect> effects;
+};
+
+#endif
@@ -0,0 +1,397 @@
+#include "RJobSystem.hpp"
+#include "RLockstep.hpp"
+#include "RMaps.hpp"
+#include "RNet.hpp"
+#include "RPath.hpp"
+#include "RRandom.hpp"
+#include "RWaves.hpp"
+#include "RWorld.hpp"
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Loopback lockstep check
+//
+// Plays two games against each other in this process, the joining one going
+// through a relay that delays, jitters and drops packets, each with its own
+// world and scripted input and the joiner taking tower targeting from the
+// host. Passes if both end on the same world without ever disagreeing, then
+// plays again with one world nudged behind the other's back and passes if
+// that gets caught. Last, the joining side shows up with different waves and
+// has to be turned away before its timeout.
+//
+//   net_check [--ticks <n>] [--input-delay <ticks>] [--latency <ms>]
+//             [--jitter <ms>] [--loss <percent>] [--port <first port>]
+//
+// Two ports from --port up are used on localhost.
+
+const float NET_TICK_RATE = 120;
+
+const int DEFAULT_TICKS = NET_TICK_RATE * 5;
+const int DEFAULT_LATENCY = 40;
+const int DEFAULT_JITTER = 15;
+const float DEFAULT_LOSS = 10;
+const int DEFAULT_PORT = 27650;
+
+// how long the peers get to find each other
+const float JOIN_TIMEOUT = 5;
+
+// once done, how long a peer keeps answering so the other can finish too
+const int LINGER_MS = 500;
+
+// not the world's defaults, so the joining side only stays in sync if it
+// really takes the host's
+const RTargetPolicy HOST_TOWER_POLICY = T_CLOSEST;
+const float HOST_RETARGET_INTERVAL = 0.5f;
+
+typedef struct RPeerRun {
+  RLockstep *lockstep;
+  int ticks;
+
+  // tick to spawn a tank on without telling anyone, or -1
+  Sint64 tamperTick;
+
+  std::atomic<int> *finished;
+
+  Uint64 finalTick;
+  Uint64 finalHash;
+} RPeerRun;
+
+// what the sim thread does in a network game, with a script for a player
+void RunPeer(RPeerRun *run) {
+  RLockstep *lockstep = run->lockstep;
+
+  RJobSystem jobs(0);
+  RPath path;
+  MakeMap0Path(&path);
+
+  RWorld world;
+  world.SetPath(&path);
+  world.SetJobSystem(&jobs);
+  world.Seed(lockstep->GetSeed());
+  world.SpawnTowers(24);
+  world.SetTowerTargeting(lockstep->GetTowerPolicy(),
+                          lockstep->GetRetargetInterval());
+
+  // each side clicks around differently
+  RRandom player(lockstep->IsHost() ? 1 : 2);
+
+  std::vector<RCommand> commands;
+
+  auto tickDuration = std::chrono::duration_cast<
+      std::chrono::steady_clock::duration>(
+      std::chrono::duration<float>(1 / NET_TICK_RATE));
+
+  auto nextTickTime = std::chrono::steady_clock::now();
+
+  while (world.GetTick() < run->ticks) {
+    lockstep->Poll();
+
+    if (!lockstep->IsReady(world.GetTick())) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      continue;
+    }
+
+    commands.clear();
+
+    if (player.Range(20) == 0) {
+      RCommand spawn = {C_SPAWN_ENEMY, player.Range(3), 0};
+      commands.push_back(spawn);
+    }
+
+    if (player.Range(90) == 0) {
+      RCommand target = {C_SET_TARGET, player.Range(LEVEL_WIDTH),
+                         player.Range(LEVEL_HEIGHT)};
+      commands.push_back(target);
+    }
+
+    lockstep->Exchange(world.GetTick(), &commands);
+
+    for (int i = 0; i < commands.size(); ++i) {
+      world.HandleCommand(&commands[i]);
+    }
+
+    world.Tick(1 / NET_TICK_RATE);
+
+    if ((Sint64)world.GetTick() == run->tamperTick) {
+      world.SpawnEnemy(E_YELLOW);
+    }
+
+    if (world.GetTick() % NET_HASH_INTERVAL == 0) {
+      lockstep->RecordHash(world.GetTick(), world.Hash());
+    }
+
+    nextTickTime += tickDuration;
+
+    auto now = std::chrono::steady_clock::now();
+
+    if (now - nextTickTime > tickDuration * 4) {
+      nextTickTime = now;
+    }
+
+    std::this_thread::sleep_until(nextTickTime);
+  }
+
+  run->finalTick = world.GetTick();
+  run->finalHash = world.Hash();
+
+  // the other side may still need our last few ticks and acks
+  (*run->finished)++;
+
+  Uint64 lingerUntil = 0;
+
+  while (lingerUntil == 0 || NetMilliseconds() < lingerUntil) {
+    lockstep->Poll();
+
+    if (lingerUntil == 0 && *run->finished == 2) {
+      lingerUntil = NetMilliseconds() + LINGER_MS;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+typedef struct RMatch {
+  int ticks;
+  int inputDelay;
+  int latency;
+  int jitter;
+  float loss;
+  int port;
+
+  // on the joining side
+  Sint64 tamperTick;
+
+  // RWaveSchedule::Hash of each side's waves
+  Uint64 hostWaves;
+  Uint64 joinWaves;
+} RMatch;
+
+typedef struct RMatchResult {
+  bool connected;
+
+  // how long the joining side took to get in or give up
+  float joinSeconds;
+
+  RPeerRun runs[2];
+  bool desynced[2];
+  Uint64 desyncTick[2];
+  RNetStats stats[2];
+
+  Uint64 relayed;
+  Uint64 dropped;
+} RMatchResult;
+
+void HostPeer(RLockstep *lockstep, RMatch *match, RPeerRun *run,
+              bool *connected) {
+  *connected = lockstep->Host(match->port, 1234, match->inputDelay,
+                              HOST_TOWER_POLICY, HOST_RETARGET_INTERVAL,
+                              match->hostWaves, JOIN_TIMEOUT);
+
+  if (*connected) {
+    RunPeer(run);
+  } else {
+    (*run->finished)++;
+  }
+}
+
+void JoinPeer(RLockstep *lockstep, RMatch *match, RPeerRun *run,
+              bool *connected, float *seconds) {
+  std::string relay = "127.0.0.1:" + std::to_string(match->port + 1);
+
+  auto start = std::chrono::steady_clock::now();
+
+  *connected = lockstep->Join(relay.c_str(), match->joinWaves, JOIN_TIMEOUT);
+  *seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() -
+                                          start)
+                 .count();
+
+  if (*connected) {
+    RunPeer(run);
+  } else {
+    (*run->finished)++;
+  }
+}
+
+RMatchResult PlayMatch(RMatch *match) {
+  RMatchResult result;
+
+  RNetAddress hostAddress = {0x7F000001, (Uint16)match->port};
+
+  RNetRelay relay;
+  relay.Open(match->port + 1, hostAddress);
+  relay.SetConditions(match->latency, match->jitter, match->loss);
+
+  std::atomic<bool> relayStop(false);
+  std::thread relayThread(&RNetRelay::Run, &relay, &relayStop);
+
+  RLockstep lockstep[2];
+  std::atomic<int> finished(0);
+  bool connected[2] = {false, false};
+
+  for (int i = 0; i < 2; ++i) {
+    result.runs[i].lockstep = &lockstep[i];
+    result.runs[i].ticks = match->ticks;
+    result.runs[i].tamperTick = i == 1 ? match->tamperTick : -1;
+    result.runs[i].finished = &finished;
+    result.runs[i].finalTick = 0;
+    result.runs[i].finalHash = 0;
+  }
+
+  std::thread host(HostPeer, &lockstep[0], match, &result.runs[0],
+                   &connected[0]);
+  std::thread join(JoinPeer, &lockstep[1], match, &result.runs[1],
+                   &connected[1], &result.joinSeconds);
+
+  host.join();
+  join.join();
+
+  relayStop = true;
+  relayThread.join();
+
+  result.connected = connected[0] && connected[1];
+
+  for (int i = 0; i < 2; ++i) {
+    result.desynced[i] = lockstep[i].IsDesynced();
+    result.desyncTick[i] = lockstep[i].GetDesyncTick();
+    result.stats[i] = lockstep[i].GetStats();
+  }
+
+  result.relayed = relay.GetForwarded();
+  result.dropped = relay.GetDropped();
+
+  return result;
+}
+
+void PrintMatch(RMatchResult *result) {
+  const char *names[2] = {"host", "join"};
+
+  printf("  relay: %llu packets through, %llu dropped\n",
+         (unsigned long long)result->relayed,
+         (unsigned long long)result->dropped);
+
+  for (int i = 0; i < 2; ++i) {
+    RPeerRun *run = &result->runs[i];
+    RNetStats *stats = &result->stats[i];
+
+    double ticks = run->finalTick > 0 ? run->finalTick : 1;
+
+    printf("  %s: tick %llu hash %016llx, %.1f B/tick out, %.2f "
+           "packets/tick, waited %llu times%s\n",
+           names[i], (unsigned long long)run->finalTick,
+           (unsigned long long)run->finalHash, stats->bytesSent / ticks,
+           stats->packetsSent / ticks, (unsigned long long)stats->stalls,
+           result->desynced[i] ? ", desynced" : "");
+  }
+}
+
+int main(int argc, char *argv[]) {
+  RMatch match;
+
+  match.ticks = DEFAULT_TICKS;
+  match.inputDelay = 6;
+  match.latency = DEFAULT_LATENCY;
+  match.jitter = DEFAULT_JITTER;
+  match.loss = DEFAULT_LOSS;
+  match.port = DEFAULT_PORT;
+  match.tamperTick = -1;
+  match.hostWaves = RWaveSchedule().Hash();
+  match.joinWaves = match.hostWaves;
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+      match.ticks = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--input-delay") == 0 && i + 1 < argc) {
+      match.inputDelay = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--latency") == 0 && i + 1 < argc) {
+      match.latency = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--jitter") == 0 && i + 1 < argc) {
+      match.jitter = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--loss") == 0 && i + 1 < argc) {
+      match.loss = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+      match.port = atoi(argv[++i]);
+    } else {
+      printf("Unknown argument %s!\n", argv[i]);
+      return 2;
+    }
+  }
+
+  // long enough for a couple of hashes either side of the nudge
+  if (match.ticks < NET_HASH_INTERVAL * 4) {
+    printf("Need at least %d ticks!\n", NET_HASH_INTERVAL * 4);
+    return 2;
+  }
+
+  bool ok = true;
+
+  printf("in sync: %d ticks, input delay %d, %dms +-%dms, %g%% loss\n",
+         match.ticks, match.inputDelay, match.latency, match.jitter,
+         match.loss);
+
+  RMatchResult clean = PlayMatch(&match);
+  PrintMatch(&clean);
+
+  if (!clean.connected) {
+    printf("  FAIL: the peers never connected\n");
+    ok = false;
+  } else if (clean.desynced[0] || clean.desynced[1]) {
+    printf("  FAIL: desynced\n");
+    ok = false;
+  } else if (clean.runs[0].finalHash != clean.runs[1].finalHash) {
+    printf("  FAIL: worlds differ at the end\n");
+    ok = false;
+  } else {
+    printf("  ok\n");
+  }
+
+  match.tamperTick = match.ticks / 2;
+
+  printf("nudged: one extra tank on the joining side at tick %lld\n",
+         (long long)match.tamperTick);
+
+  RMatchResult nudged = PlayMatch(&match);
+  PrintMatch(&nudged);
+
+  bool caught = nudged.connected;
+
+  for (int i = 0; i < 2; ++i) {
+    caught = caught && nudged.desynced[i] &&
+             nudged.desyncTick[i] >= (Uint64)match.tamperTick;
+  }
+
+  if (!caught) {
+    printf("  FAIL: the desync wasn't caught on both sides\n");
+    ok = false;
+  } else {
+    printf("  ok; caught after tick %llu\n",
+           (unsigned long long)nudged.desyncTick[0]);
+  }
+
+  // stands in for a different wave file
+  match.tamperTick = -1;
+  match.joinWaves = match.hostWaves + 1;
+
+  printf("other waves: the joining side has a different wave schedule\n");
+
+  RMatchResult refused = PlayMatch(&match);
+
+  if (refused.connected) {
+    printf("  FAIL: they got to play anyway\n");
+    ok = false;
+  } else if (refused.joinSeconds >= JOIN_TIMEOUT) {
+    printf("  FAIL: the joining side only gave up at its timeout\n");
+    ok = false;
+  } else {
+    printf("  ok; turned away after %.2fs\n", refused.joinSeconds);
+  }
+
+  printf("\n%s\n", ok ? "net_check passed" : "net_check FAILED");
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,218 @@
+#include "RFixed.hpp"
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+// Fixed point math against floats
+//
+// Times each of the sim's math functions both ways over the same inputs and
+// says how far the fixed point answers are from the exact ones (worked out
+// in double). Nothing here passes or fails; it's for seeing what switching
+// GAME_FIXED_POINT on costs.
+//
+//   fixed_bench [--count <inputs>]
+
+const int DEFAULT_COUNT = 1 << 20;
+const int ROUNDS = 5;
+
+typedef enum RBenchFunc {
+  BF_SQRT,
+  BF_HYPOT,
+  BF_ATAN2,
+  BF_SIN,
+  BF_COS,
+  BF_COUNT
+} RBenchFunc;
+
+static const char *FUNC_NAMES[BF_COUNT] = {"sqrt", "hypot", "atan2", "sin",
+                                           "cos"};
+
+// the kind of numbers the sim feeds them: positions and offsets across the
+// level, angles from a few turns either way
+typedef struct RBenchInputs {
+  std::vector<float> a;
+  std::vector<float> b;
+  std::vector<RFixed> fixedA;
+  std::vector<RFixed> fixedB;
+} RBenchInputs;
+
+static float Sign(Uint32 bits) { return bits & 1 ? -1.0f : 1.0f; }
+
+RBenchInputs MakeInputs(RBenchFunc func, int count) {
+  RBenchInputs inputs;
+
+  // xorshift, so the inputs are the same every run and everywhere
+  Uint32 state = 2463534242u;
+
+  for (int i = 0; i < count; ++i) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+
+    float u = (state >> 8) / (float)(1 << 24);
+    float v = ((state * 2654435761u) >> 8) / (float)(1 << 24);
+
+    float a, b;
+
+    switch (func) {
+    case BF_SQRT:
+      a = u * 2000;
+      b = 0;
+      break;
+    case BF_SIN:
+    case BF_COS:
+      a = (u - 0.5f) * 40;
+      b = 0;
+      break;
+    default:
+      a = u * 1536 * Sign(state >> 3);
+      b = v * 1536 * Sign(state >> 5);
+      break;
+    }
+
+    inputs.fixedA.push_back(RFixed(a));
+    inputs.fixedB.push_back(RFixed(b));
+
+    // the floats get exactly what the fixed points hold, so both are
+    // answering the same question
+    inputs.a.push_back((float)inputs.fixedA.back());
+    inputs.b.push_back((float)inputs.fixedB.back());
+  }
+
+  return inputs;
+}
+
+static float RunFloat(RBenchFunc func, float a, float b) {
+  switch (func) {
+  case BF_SQRT:
+    return RealSqrt(a);
+  case BF_HYPOT:
+    return RealHypot(a, b);
+  case BF_ATAN2:
+    return RealAtan2(a, b);
+  case BF_SIN:
+    return RealSin(a);
+  default:
+    return RealCos(a);
+  }
+}
+
+static RFixed RunFixed(RBenchFunc func, RFixed a, RFixed b) {
+  switch (func) {
+  case BF_SQRT:
+    return RealSqrt(a);
+  case BF_HYPOT:
+    return RealHypot(a, b);
+  case BF_ATAN2:
+    return RealAtan2(a, b);
+  case BF_SIN:
+    return RealSin(a);
+  default:
+    return RealCos(a);
+  }
+}
+
+static double RunExact(RBenchFunc func, double a, double b) {
+  switch (func) {
+  case BF_SQRT:
+    return sqrt(a);
+  case BF_HYPOT:
+    return hypot(a, b);
+  case BF_ATAN2:
+    return atan2(a, b);
+  case BF_SIN:
+    return sin(a);
+  default:
+    return cos(a);
+  }
+}
+
+// best of a few rounds, in ns per call
+template <typename F> double TimeCalls(int count, F call) {
+  double best = 0;
+
+  for (int round = 0; round < ROUNDS; ++round) {
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < count; ++i) {
+      call(i);
+    }
+
+    double ns = std::chrono::duration<double, std::nano>(
+                    std::chrono::steady_clock::now() - start)
+                    .count() /
+                count;
+
+    if (round == 0 || ns < best) {
+      best = ns;
+    }
+  }
+
+  return best;
+}
+
+int main(int argc, char *argv[]) {
+  int count = DEFAULT_COUNT;
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+      count = atoi(argv[++i]);
+    } else {
+      printf("Unknown argument %s!\n", argv[i]);
+      return 2;
+    }
+  }
+
+  if (count <= 0) {
+    printf("Need at least one input!\n");
+    return 2;
+  }
+
+  // builds the tables so the first timing doesn't pay for them
+  FixedSin(0);
+
+  printf("%d inputs, best of %d\n\n", count, ROUNDS);
+  printf("%-6s %10s %10s %9s %14s %14s\n", "func", "float ns", "fixed ns",
+         "ratio", "float error", "fixed error");
+
+  // written to so the calls can't be thrown away
+  volatile float floatSink = 0;
+  volatile Sint32 fixedSink = 0;
+
+  for (int f = 0; f < BF_COUNT; ++f) {
+    RBenchFunc func = (RBenchFunc)f;
+    RBenchInputs in = MakeInputs(func, count);
+
+    double floatNs = TimeCalls(count, [&](int i) {
+      floatSink = RunFloat(func, in.a[i], in.b[i]);
+    });
+
+    double fixedNs = TimeCalls(count, [&](int i) {
+      fixedSink = RunFixed(func, in.fixedA[i], in.fixedB[i]).GetRaw();
+    });
+
+    double floatError = 0;
+    double fixedError = 0;
+
+    for (int i = 0; i < count; ++i) {
+      double exact = RunExact(func, in.a[i], in.b[i]);
+      double viaFloat = RunFloat(func, in.a[i], in.b[i]);
+      double viaFixed = (float)RunFixed(func, in.fixedA[i], in.fixedB[i]);
+
+      floatError = fmax(floatError, fabs(viaFloat - exact));
+      fixedError = fmax(fixedError, fabs(viaFixed - exact));
+    }
+
+    printf("%-6s %10.2f %10.2f %8.2fx %14.3g %14.3g\n", FUNC_NAMES[f],
+           floatNs, fixedNs, fixedNs / floatNs, floatError, fixedError);
+  }
+
+  printf("\nerrors are the worst absolute difference from double; a fixed "
+         "point step is %.3g\n",
+         1.0 / FIXED_ONE);
+
+  return 0;
+}
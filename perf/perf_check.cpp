@@ -0,0 +1,519 @@
+#include "RHistogram.hpp"
+#include "RJobSystem.hpp"
+#include "RMaps.hpp"
+#include "RMemory.hpp"
+#include "RPath.hpp"
+#include "RWaves.hpp"
+#include "RWorld.hpp"
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// Headless performance gate
+//
+// Runs a few fixed scenarios on map0's path with no window, times every tick
+// and compares against a baseline file; exits with 1 and a table of what got
+// worse if anything went past its tolerance.
+//
+//   perf_check [--baseline <file>] [--write-baseline <file>]
+//              [--ticks <n>] [--runs <n>] [--workers <n>]
+//
+// Every run starts by timing a fixed bit of integer work, the calibration
+// loop. Each run's times are scaled by how long that took against the
+// median over all runs, and the baseline's by how long it took when the
+// baseline was written, so a machine that's busy or clocked down for a
+// while doesn't read as a regression. The median run is kept, so a one-off
+// hiccup either way doesn't either. Peak heap and allocations don't depend
+// on the machine; they keep the worst run and their limits stay strict.
+//
+// Baseline files are plain text, one scenario per line, # for comments:
+//
+//   <scenario> <ticks/s> <p99 tick us> <peak heap KB> <allocs after warm up>
+//              <calibration us>
+//
+// Calibration takes out how fast the machine is running, not which machine
+// it is or how the build was made, so regenerate the baseline with
+// --write-baseline when either changes (and say so in the commit).
+
+typedef struct RScenario {
+  const char *name;
+  int nTowers;
+  int nTanks;
+
+  // the whole lot comes out over this long, all during warm up
+  float spawnSeconds;
+} RScenario;
+
+static const RScenario SCENARIOS[] = {
+    {"tanks_1k", 24, 1000, 1},
+    {"tanks_5k", 24, 5000, 1},
+    {"tanks_20k", 24, 20000, 1},
+};
+
+static const int N_SCENARIOS = sizeof(SCENARIOS) / sizeof(SCENARIOS[0]);
+
+typedef enum RPerfMetric {
+  PM_TICKS_PER_SECOND,
+  PM_P99_TICK,
+  PM_PEAK_HEAP,
+  PM_ALLOCS,
+  PM_COUNT
+} RPerfMetric;
+
+typedef struct RPerfMetricInfo {
+  const char *name;
+
+  // how far it may move the wrong way, in percent of the baseline; higher
+  // is better for ticks/s, lower for the rest
+  double tolerance;
+  bool higherIsBetter;
+
+  // only measurable with heap tracking compiled in
+  bool needsTracking;
+
+  // anything above 0 fails, whatever the baseline says
+  bool mustBeZero;
+
+  // scaled by the calibration loop; the rest are counted, not timed
+  bool isTime;
+} RPerfMetricInfo;
+
+// ticks/s is an average over the run so it's steady; p99 isn't, so it gets
+// more room. Both still move a few percent between runs that calibrate the
+// same, which the limits leave room for
+// a tick after warm up shouldn't allocate at all; every scratch buffer is
+// either sized for the most it could ever hold or has seen its high water
+// mark by then, so a single allocation is already a regression
+static const RPerfMetricInfo METRICS[PM_COUNT] = {
+    {"ticks/s", 15, true, false, false, true},
+    {"p99 tick us", 40, false, false, false, true},
+    {"peak heap KB", 10, false, true, false, false},
+    {"allocs", 0, false, true, true, false},
+};
+
+typedef struct RPerfResult {
+  std::string scenario;
+  double values[PM_COUNT];
+
+  // how long the calibration loop took before the run
+  double calibrationUs;
+} RPerfResult;
+
+const Uint32 PERF_SEED = 1;
+const float PERF_TICK_RATE = 120;
+
+// long enough for every tank to be out and to have fired a few times, so the
+// pools and the timing wheel's slots have been as full as they get
+const int WARMUP_TICKS = PERF_TICK_RATE * 3;
+const int DEFAULT_TICKS = PERF_TICK_RATE * 10;
+const int DEFAULT_RUNS = 5;
+
+const Uint64 MAX_TICK_US = 10 * 1000000;
+
+// the calibration loop; a few milliseconds of hashing into a table about
+// the size of a big fight's entities, best of a few goes
+const int CALIBRATION_WORDS = 1 << 18;
+const int CALIBRATION_STEPS = 1 << 22;
+const int CALIBRATION_ROUNDS = 3;
+
+// written to so the calibration loop can't be thrown away
+static volatile Uint32 calibrationSink = 0;
+
+double Calibrate() {
+  std::vector<Uint32> table(CALIBRATION_WORDS, 0);
+  double best = 0;
+
+  for (int round = 0; round < CALIBRATION_ROUNDS; ++round) {
+    auto start = std::chrono::steady_clock::now();
+
+    // xorshift, so it's the same work every time and everywhere
+    Uint32 state = 2463534242u;
+    Uint32 sum = 0;
+
+    for (int i = 0; i < CALIBRATION_STEPS; ++i) {
+      state ^= state << 13;
+      state ^= state >> 17;
+      state ^= state << 5;
+
+      Uint32 &word = table[state & (CALIBRATION_WORDS - 1)];
+      word += state;
+      sum += word;
+    }
+
+    calibrationSink = sum;
+
+    double us = std::chrono::duration<double, std::micro>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+
+    if (round == 0 || us < best) {
+      best = us;
+    }
+  }
+
+  return best;
+}
+
+double Median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+
+  int middle = values.size() / 2;
+
+  if (values.size() % 2 == 0) {
+    return (values[middle - 1] + values[middle]) / 2;
+  }
+
+  return values[middle];
+}
+
+// a time measured while the calibration loop took calibrationUs, as it would
+// have come out if it had taken targetUs instead
+double ScaleTime(const RPerfMetricInfo *info, double value,
+                 double calibrationUs, double targetUs) {
+  double slower = targetUs / calibrationUs;
+
+  return info->higherIsBetter ? value / slower : value * slower;
+}
+
+RPerfResult RunScenario(const RScenario *scenario, RJobSystem *jobs,
+                        int nTicks) {
+  RPath path;
+  MakeMap0Path(&path);
+
+  RWaveSchedule schedule;
+
+  RWave wave;
+  wave.delay = 0;
+
+  RSpawnGroup group;
+  group.color = E_RED;
+  group.count = scenario->nTanks;
+  group.interval = scenario->spawnSeconds / scenario->nTanks;
+  group.path = 0;
+
+  wave.groups.push_back(group);
+  schedule.GetWaves().push_back(wave);
+
+  RHistogram tickTimes(MAX_TICK_US);
+
+  // before the heap is looked at; its table is gone again by then
+  double calibrationUs = Calibrate();
+
+  Sint64 heapBefore = RMemory::GetHeapTotal().bytes;
+  RMemory::ResetPeaks();
+
+  Uint64 allocsBefore = 0;
+  double seconds = 0;
+
+  {
+    RWorld world;
+    RDrawList list;
+
+    world.SetPath(&path);
+    world.SetJobSystem(jobs);
+    world.Seed(PERF_SEED);
+    world.SpawnTowers(scenario->nTowers);
+    world.StartWaves(&schedule);
+
+    for (int i = 0; i < WARMUP_TICKS + nTicks; ++i) {
+      if (i == WARMUP_TICKS) {
+        allocsBefore = RMemory::GetHeapTotal().allocs;
+      }
+
+      auto tickStart = std::chrono::steady_clock::now();
+
+      // what the sim thread does every tick
+      world.Tick(1 / PERF_TICK_RATE);
+      world.BuildDrawList(&list);
+
+      double tickSeconds = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - tickStart)
+                               .count();
+
+      if (i >= WARMUP_TICKS) {
+        tickTimes.Record(tickSeconds * 1000000);
+        seconds += tickSeconds;
+      }
+    }
+  }
+
+  RMemStats heap = RMemory::GetHeapTotal();
+
+  RPerfResult result;
+
+  result.scenario = scenario->name;
+  result.values[PM_TICKS_PER_SECOND] = seconds > 0 ? nTicks / seconds : 0;
+  result.values[PM_P99_TICK] = tickTimes.GetPercentile(99);
+  result.values[PM_PEAK_HEAP] = (heap.peakBytes - heapBefore) / 1024.0;
+  result.values[PM_ALLOCS] = heap.allocs - allocsBefore;
+  result.calibrationUs = calibrationUs;
+
+  return result;
+}
+
+// median times, each run's scaled to the median calibration first; worst
+// heap and allocations
+RPerfResult Summarise(std::vector<RPerfResult> &runs) {
+  std::vector<double> calibrations;
+
+  for (int i = 0; i < runs.size(); ++i) {
+    calibrations.push_back(runs[i].calibrationUs);
+  }
+
+  RPerfResult summary = runs[0];
+  summary.calibrationUs = Median(calibrations);
+
+  for (int m = 0; m < PM_COUNT; ++m) {
+    const RPerfMetricInfo *info = &METRICS[m];
+    std::vector<double> values;
+
+    for (int i = 0; i < runs.size(); ++i) {
+      double value = runs[i].values[m];
+
+      if (info->isTime) {
+        value = ScaleTime(info, value, runs[i].calibrationUs,
+                          summary.calibrationUs);
+      }
+
+      values.push_back(value);
+    }
+
+    if (info->isTime) {
+      summary.values[m] = Median(values);
+    } else {
+      summary.values[m] = *std::max_element(values.begin(), values.end());
+    }
+  }
+
+  return summary;
+}
+
+bool LoadBaseline(const char *path, std::vector<RPerfResult> *out) {
+  FILE *file = fopen(path, "r");
+
+  if (file == NULL) {
+    printf("Could not open baseline %s!\n", path);
+    return false;
+  }
+
+  char line[256];
+  int lineNumber = 0;
+
+  while (fgets(line, sizeof(line), file) != NULL) {
+    lineNumber++;
+
+    char name[64];
+    RPerfResult result;
+
+    if (line[0] == '#' || sscanf(line, "%63s", name) != 1) {
+      continue;
+    }
+
+    if (sscanf(line, "%63s %lf %lf %lf %lf %lf", name, &result.values[0],
+               &result.values[1], &result.values[2], &result.values[3],
+               &result.calibrationUs) != 2 + PM_COUNT) {
+      printf("%s:%d: expected a name and %d numbers!\n", path, lineNumber,
+             PM_COUNT + 1);
+      fclose(file);
+      return false;
+    }
+
+    if (result.calibrationUs <= 0) {
+      printf("%s:%d: calibration has to be above 0!\n", path, lineNumber);
+      fclose(file);
+      return false;
+    }
+
+    result.scenario = name;
+    out->push_back(result);
+  }
+
+  fclose(file);
+
+  return true;
+}
+
+bool WriteBaseline(const char *path, std::vector<RPerfResult> &results) {
+  FILE *file = fopen(path, "w");
+
+  if (file == NULL) {
+    printf("Could not write baseline %s!\n", path);
+    return false;
+  }
+
+  fprintf(file, "# perf_check baseline; regenerate with --write-baseline\n");
+  fprintf(file, "# <scenario> <ticks/s> <p99 tick us> <peak heap KB> "
+                "<allocs after warm up> <calibration us>\n");
+
+  for (int i = 0; i < results.size(); ++i) {
+    double *values = results[i].values;
+
+    fprintf(file, "%s %.1f %.0f %.0f %.0f %.0f\n",
+            results[i].scenario.c_str(), values[PM_TICKS_PER_SECOND],
+            values[PM_P99_TICK], values[PM_PEAK_HEAP], values[PM_ALLOCS],
+            results[i].calibrationUs);
+  }
+
+  return fclose(file) == 0;
+}
+
+// prints a row per metric; true if everything's within tolerance
+bool Compare(RPerfResult *now, RPerfResult *baseline) {
+  bool ok = true;
+
+  for (int i = 0; i < PM_COUNT; ++i) {
+    const RPerfMetricInfo *info = &METRICS[i];
+
+    if (info->needsTracking && !RMemory::IsTrackingHeap()) {
+      continue;
+    }
+
+    double was = baseline->values[i];
+    double is = now->values[i];
+
+    // what the baseline would have timed at the speed we're running at
+    if (info->isTime) {
+      was = ScaleTime(info, was, baseline->calibrationUs, now->calibrationUs);
+    }
+
+    // worse is positive whichever way worse is
+    double worse = info->higherIsBetter ? was - is : is - was;
+    double change = was != 0 ? (is - was) / was * 100 : 0;
+
+    // from a baseline of 0 there's no percentage; anything worse fails
+    bool failed = false;
+
+    if (info->mustBeZero) {
+      failed = is > 0;
+    } else if (worse > 0) {
+      failed = was == 0 || worse / was * 100 > info->tolerance;
+    }
+
+    char limit[16];
+
+    if (info->mustBeZero) {
+      snprintf(limit, sizeof(limit), "0");
+    } else {
+      snprintf(limit, sizeof(limit), "%s%g%%",
+               info->higherIsBetter ? "-" : "+", info->tolerance);
+    }
+
+    printf("%-10s %-13s %12.1f %12.1f %+8.1f%% %8s  %s\n",
+           now->scenario.c_str(), info->name, was, is, change, limit,
+           failed ? "FAIL" : "ok");
+
+    ok = ok && !failed;
+  }
+
+  return ok;
+}
+
+int main(int argc, char *argv[]) {
+  const char *baselinePath = NULL;
+  const char *writePath = NULL;
+  int nTicks = DEFAULT_TICKS;
+  int nRuns = DEFAULT_RUNS;
+  int nWorkers = -1;
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+      baselinePath = argv[++i];
+    } else if (strcmp(argv[i], "--write-baseline") == 0 && i + 1 < argc) {
+      writePath = argv[++i];
+    } else if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+      nTicks = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+      nRuns = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+      nWorkers = atoi(argv[++i]);
+    } else {
+      printf("Unknown argument %s!\n", argv[i]);
+      return 2;
+    }
+  }
+
+  if (nTicks <= 0 || nRuns <= 0) {
+    printf("Need at least one tick and one run!\n");
+    return 2;
+  }
+
+  if (!RMemory::IsTrackingHeap()) {
+    printf("Heap tracking is off; only comparing times.\n");
+  }
+
+  printf("Sim math is %s.\n", SIM_FIXED_POINT ? "fixed point" : "float");
+
+  std::vector<RPerfResult> baseline;
+
+  if (baselinePath != NULL && !LoadBaseline(baselinePath, &baseline)) {
+    return 2;
+  }
+
+  RJobSystem jobs(nWorkers);
+
+  std::vector<RPerfResult> results;
+
+  for (int i = 0; i < N_SCENARIOS; ++i) {
+    const RScenario *scenario = &SCENARIOS[i];
+
+    printf("running %s: %d towers, %d tanks, %d ticks x %d\n",
+           scenario->name, scenario->nTowers, scenario->nTanks, nTicks, nRuns);
+
+    std::vector<RPerfResult> runs;
+
+    for (int run = 0; run < nRuns; ++run) {
+      runs.push_back(RunScenario(scenario, &jobs, nTicks));
+    }
+
+    RPerfResult summary = Summarise(runs);
+    results.push_back(summary);
+
+    double *values = summary.values;
+
+    printf("  %.1f ticks/s, p99 %.0f us, peak heap %.0f KB, %.0f allocs, "
+           "calibration %.0f us\n",
+           values[PM_TICKS_PER_SECOND], values[PM_P99_TICK],
+           values[PM_PEAK_HEAP], values[PM_ALLOCS], summary.calibrationUs);
+  }
+
+  if (writePath != NULL && !WriteBaseline(writePath, results)) {
+    return 2;
+  }
+
+  if (baselinePath == NULL) {
+    return 0;
+  }
+
+  printf("\nbaseline times are scaled to this run's calibration\n");
+  printf("%-10s %-13s %12s %12s %9s %8s\n", "scenario", "metric",
+         "baseline", "now", "change", "limit");
+
+  bool ok = true;
+
+  for (int i = 0; i < results.size(); ++i) {
+    RPerfResult *match = NULL;
+
+    for (int j = 0; j < baseline.size() && match == NULL; ++j) {
+      if (baseline[j].scenario == results[i].scenario) {
+        match = &baseline[j];
+      }
+    }
+
+    if (match == NULL) {
+      printf("%-10s not in the baseline; skipped\n",
+             results[i].scenario.c_str());
+      continue;
+    }
+
+    ok = Compare(&results[i], match) && ok;
+  }
+
+  printf("\n%s\n", ok ? "perf_check passed"
+                      : "perf_check FAILED: regressions against the baseline");
+
+  return ok ? 0 : 1;
+}
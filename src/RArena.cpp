@@ -0,0 +1,110 @@
+#include "RArena.hpp"
+
+#include <stdint.h>
+
+// new hands out memory aligned for anything, so offsets from it only need
+// rounding up
+static size_t AlignUp(size_t value, size_t align) {
+  return (value + align - 1) / align * align;
+}
+
+RArena::RArena(size_t capacity) {
+  this->capacity = capacity > 0 ? capacity : 1;
+
+  base = new char[this->capacity];
+  used = 0;
+
+  spill = NULL;
+  spillTop = NULL;
+  spillLeft = 0;
+  spillUsed = 0;
+
+  growCount = 0;
+}
+
+RArena::~RArena() {
+  Reset();
+
+  delete[] base;
+}
+
+void *RArena::Allocate(size_t bytes, size_t align) {
+  if (spill == NULL) {
+    size_t offset = AlignUp(used, align);
+
+    if (offset + bytes <= capacity) {
+      used = offset + bytes;
+      return base + offset;
+    }
+  }
+
+  // out of room; everything else this frame goes in spill blocks
+  size_t pad = AlignUp((uintptr_t)spillTop, align) - (uintptr_t)spillTop;
+
+  if (spill == NULL || pad + bytes > spillLeft) {
+    size_t size = bytes + align > capacity ? bytes + align : capacity;
+
+    RArenaBlock *block = NewBlock(size);
+    block->next = spill;
+    spill = block;
+
+    spillTop = (char *)(block + 1);
+    spillLeft = size;
+
+    pad = AlignUp((uintptr_t)spillTop, align) - (uintptr_t)spillTop;
+  }
+
+  char *allocation = spillTop + pad;
+
+  spillTop = allocation + bytes;
+  spillLeft -= pad + bytes;
+  spillUsed += pad + bytes;
+
+  return allocation;
+}
+
+void RArena::Reset() {
+  if (spill != NULL) {
+    size_t needed = used + spillUsed;
+
+    while (spill != NULL) {
+      RArenaBlock *next = spill->next;
+      delete[] (char *)spill;
+      spill = next;
+    }
+
+    // room for a frame like this one and then some
+    if (needed > capacity) {
+      delete[] base;
+
+      capacity = needed + needed / 2;
+      base = new char[capacity];
+
+      growCount++;
+    }
+
+    spillTop = NULL;
+    spillLeft = 0;
+    spillUsed = 0;
+  }
+
+  used = 0;
+}
+
+size_t RArena::GetUsed() { return used + spillUsed; }
+
+size_t RArena::GetCapacity() { return capacity; }
+
+int RArena::GetGrowCount() { return growCount; }
+
+RArena::RArenaBlock *RArena::NewBlock(size_t size) {
+  RArenaBlock *block =
+      (RArenaBlock *)new char[sizeof(RArenaBlock) + size];
+
+  block->next = NULL;
+  block->size = size;
+
+  growCount++;
+
+  return block;
+}
@@ -0,0 +1,151 @@
+#include "RCamera.hpp"
+
+#include <SDL_stdinc.h>
+
+RCamera::RCamera() {
+  x = 0;
+  y = 0;
+  zoom = 1;
+
+  minZoom = 0.25;
+  maxZoom = 4;
+
+  pixelScale = 1;
+
+  // nothing to keep inside until SetBounds
+  viewportWidth = 1;
+  viewportHeight = 1;
+  boundsWidth = 0;
+  boundsHeight = 0;
+}
+
+void RCamera::SetViewport(int width, int height) {
+  viewportWidth = width;
+  viewportHeight = height;
+
+  Clamp();
+}
+
+void RCamera::SetBounds(int width, int height) {
+  boundsWidth = width;
+  boundsHeight = height;
+
+  Clamp();
+}
+
+void RCamera::SetZoomLimits(float minZoom, float maxZoom) {
+  this->minZoom = minZoom;
+  this->maxZoom = maxZoom;
+
+  Clamp();
+}
+
+void RCamera::SetPixelScale(float pixelScale) {
+  this->pixelScale = pixelScale;
+}
+
+float RCamera::GetX() { return x; }
+
+float RCamera::GetY() { return y; }
+
+float RCamera::GetZoom() { return zoom; }
+
+SDL_Rect RCamera::GetView() {
+  SDL_Rect view;
+
+  view.x = SDL_floorf(x);
+  view.y = SDL_floorf(y);
+  view.w = SDL_ceilf(x + viewportWidth / zoom) - view.x;
+  view.h = SDL_ceilf(y + viewportHeight / zoom) - view.y;
+
+  return view;
+}
+
+void RCamera::Pan(float dx, float dy) {
+  x += dx / zoom;
+  y += dy / zoom;
+
+  Clamp();
+}
+
+void RCamera::ZoomAt(float factor, int screenX, int screenY) {
+  // world point under the cursor before and after should match
+  float worldX = x + screenX / zoom;
+  float worldY = y + screenY / zoom;
+
+  zoom *= factor;
+
+  if (zoom < minZoom) {
+    zoom = minZoom;
+  }
+
+  if (zoom > maxZoom) {
+    zoom = maxZoom;
+  }
+
+  x = worldX - screenX / zoom;
+  y = worldY - screenY / zoom;
+
+  Clamp();
+}
+
+void RCamera::ScreenToWorld(int screenX, int screenY, int *worldX,
+                            int *worldY) {
+  // drawing snaps the camera to whole px, so this has to as well
+  *worldX = SDL_floorf(x) + SDL_floorf(screenX / zoom);
+  *worldY = SDL_floorf(y) + SDL_floorf(screenY / zoom);
+}
+
+void RCamera::WorldToView(int worldX, int worldY, int *viewX, int *viewY) {
+  *viewX = worldX - (int)SDL_floorf(x);
+  *viewY = worldY - (int)SDL_floorf(y);
+}
+
+bool RCamera::IsVisible(SDL_Rect *worldRect) {
+  SDL_Rect view = GetView();
+
+  return worldRect->x < view.x + view.w && worldRect->x + worldRect->w > view.x &&
+         worldRect->y < view.y + view.h && worldRect->y + worldRect->h > view.y;
+}
+
+bool RCamera::IsVisible(int worldX, int worldY, int halfWidth,
+                        int halfHeight) {
+  SDL_Rect rect = {worldX - halfWidth, worldY - halfHeight, halfWidth * 2,
+                   halfHeight * 2};
+
+  return IsVisible(&rect);
+}
+
+void RCamera::Begin(SDL_Renderer *renderer) {
+  SDL_RenderSetScale(renderer, zoom * pixelScale, zoom * pixelScale);
+
+  // clip rects are given in scaled coords
+  SDL_Rect clip = {0, 0, (int)SDL_ceilf(viewportWidth / zoom),
+                   (int)SDL_ceilf(viewportHeight / zoom)};
+
+  SDL_RenderSetClipRect(renderer, &clip);
+}
+
+void RCamera::End(SDL_Renderer *renderer) {
+  SDL_RenderSetClipRect(renderer, NULL);
+  SDL_RenderSetScale(renderer, pixelScale, pixelScale);
+}
+
+void RCamera::Clamp() {
+  if (boundsWidth <= 0 || boundsHeight <= 0) {
+    return;
+  }
+
+  // can't zoom out past seeing the whole level
+  float fitZoom = SDL_min((float)viewportWidth / boundsWidth,
+                          (float)viewportHeight / boundsHeight);
+
+  zoom = SDL_max(zoom, SDL_min(fitZoom, maxZoom));
+
+  float viewWidth = viewportWidth / zoom;
+  float viewHeight = viewportHeight / zoom;
+
+  // a level smaller than the view sits in the corner, like it always has
+  x = SDL_max(0.0f, SDL_min(x, boundsWidth - viewWidth));
+  y = SDL_max(0.0f, SDL_min(y, boundsHeight - viewHeight));
+}
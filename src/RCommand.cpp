@@ -0,0 +1,19 @@
+#include "RCommand.hpp"
+
+void RCommandQueue::Push(RCommandType type, int a, int b) {
+  RCommand command;
+
+  command.type = type;
+  command.a = a;
+  command.b = b;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  pending.push_back(command);
+}
+
+void RCommandQueue::Drain(std::vector<RCommand> &out) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  out.insert(out.end(), pending.begin(), pending.end());
+  pending.clear();
+}
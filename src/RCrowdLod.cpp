@@ -0,0 +1,208 @@
+#include "RCrowdLod.hpp"
+
+// a level is only dropped once the crowd is this far under its threshold
+const float LOD_HYSTERESIS = 0.8;
+
+RCrowdLod::RCrowdLod() {
+  for (int i = 0; i <= CD_IMPOSTORS; ++i) {
+    countThresholds[i] = 0;
+    zoomThresholds[i] = 0;
+  }
+
+  cellSize = 512;
+  minClusterUnits = 8;
+  unitHalfSize = 0;
+
+  enabled = true;
+  detail = CD_FULL;
+
+  gridArea.x = 0;
+  gridArea.y = 0;
+  gridArea.w = 0;
+  gridArea.h = 0;
+  gridCols = 0;
+  gridRows = 0;
+}
+
+void RCrowdLod::SetCountThreshold(RCrowdDetail detail, int visible) {
+  if (detail == CD_FULL || visible < 0) {
+    printf("Could not set LOD threshold! Out of bounds.\n");
+    return;
+  }
+
+  countThresholds[detail] = visible;
+}
+
+void RCrowdLod::SetZoomThreshold(RCrowdDetail detail, float zoom) {
+  if (detail == CD_FULL || zoom < 0) {
+    printf("Could not set LOD threshold! Out of bounds.\n");
+    return;
+  }
+
+  zoomThresholds[detail] = zoom;
+}
+
+void RCrowdLod::SetClusterSize(int cellSize, int minUnits) {
+  if (cellSize <= 0 || minUnits <= 0) {
+    printf("Could not set cluster size! Out of bounds.\n");
+    return;
+  }
+
+  this->cellSize = cellSize;
+  this->minClusterUnits = minUnits;
+}
+
+void RCrowdLod::SetEnabled(bool enabled) {
+  this->enabled = enabled;
+
+  if (!enabled) {
+    detail = CD_FULL;
+  }
+}
+
+RCrowdDetail RCrowdLod::Update(int visible, float zoom) {
+  if (!enabled) {
+    return detail;
+  }
+
+  int wanted = CD_FULL;
+
+  for (int i = CD_IMPOSTORS; i > CD_FULL; --i) {
+    bool byCount = countThresholds[i] > 0 && visible >= countThresholds[i];
+    bool byZoom = zoomThresholds[i] > 0 && zoom <= zoomThresholds[i];
+
+    if (byCount || byZoom) {
+      wanted = i;
+      break;
+    }
+  }
+
+  // going down, stay put while still close to the current level's threshold
+  while (wanted < detail) {
+    bool byCount =
+        countThresholds[detail] > 0 &&
+        visible >= countThresholds[detail] * LOD_HYSTERESIS;
+    bool byZoom = zoomThresholds[detail] > 0 &&
+                  zoom <= zoomThresholds[detail] / LOD_HYSTERESIS;
+
+    if (byCount || byZoom) {
+      break;
+    }
+
+    detail = (RCrowdDetail)(detail - 1);
+  }
+
+  if (wanted > detail) {
+    detail = (RCrowdDetail)wanted;
+  }
+
+  return detail;
+}
+
+RCrowdDetail RCrowdLod::GetDetail() { return detail; }
+
+int RCrowdLod::Cluster(std::vector<REntityDrawItem> &units, RCamera *camera,
+                       int halfSize) {
+  unitHalfSize = halfSize;
+
+  gridArea = camera->GetView();
+  gridCols = gridArea.w / cellSize + 1;
+  gridRows = gridArea.h / cellSize + 1;
+
+  // only ever grows, so a steady view doesn't allocate
+  cells.resize(SDL_max((int)cells.size(), gridCols * gridRows));
+  unitCells.resize(SDL_max(unitCells.size(), units.size()));
+
+  for (int i = 0; i < gridCols * gridRows; ++i) {
+    RCrowdCell *cell = &cells[i];
+
+    cell->count = 0;
+    cell->colors[E_RED] = 0;
+    cell->colors[E_GREEN] = 0;
+    cell->colors[E_YELLOW] = 0;
+  }
+
+  int visible = 0;
+
+  for (int i = 0; i < units.size(); ++i) {
+    REntityDrawItem *unit = &units[i];
+
+    if (!camera->IsVisible(unit->posX, unit->posY, halfSize, halfSize)) {
+      unitCells[i] = -1;
+      continue;
+    }
+
+    visible++;
+
+    int col = SDL_max(0, SDL_min(gridCols - 1,
+                                 (unit->posX - gridArea.x) / cellSize));
+    int row = SDL_max(0, SDL_min(gridRows - 1,
+                                 (unit->posY - gridArea.y) / cellSize));
+
+    int c = row * gridCols + col;
+    RCrowdCell *cell = &cells[c];
+
+    if (cell->count == 0) {
+      cell->minX = unit->posX;
+      cell->maxX = unit->posX;
+      cell->minY = unit->posY;
+      cell->maxY = unit->posY;
+    } else {
+      cell->minX = SDL_min(cell->minX, unit->posX);
+      cell->maxX = SDL_max(cell->maxX, unit->posX);
+      cell->minY = SDL_min(cell->minY, unit->posY);
+      cell->maxY = SDL_max(cell->maxY, unit->posY);
+    }
+
+    cell->count++;
+    cell->colors[unit->color]++;
+
+    unitCells[i] = c;
+  }
+
+  return visible;
+}
+
+bool RCrowdLod::IsClustered(int unit) {
+  int c = unitCells[unit];
+
+  return c >= 0 && cells[c].count >= minClusterUnits;
+}
+
+void RCrowdLod::SubmitClusters(RRenderQueue *queue, RCamera *camera) {
+  for (int i = 0; i < gridCols * gridRows; ++i) {
+    RCrowdCell *cell = &cells[i];
+
+    if (cell->count < minClusterUnits) {
+      continue;
+    }
+
+    // whichever colour there's most of
+    SDL_Color color = {190, 40, 40, 210};
+
+    if (cell->colors[E_GREEN] > cell->colors[E_RED] &&
+        cell->colors[E_GREEN] >= cell->colors[E_YELLOW]) {
+      color.r = 40;
+      color.g = 160;
+      color.b = 40;
+    } else if (cell->colors[E_YELLOW] > cell->colors[E_RED] &&
+               cell->colors[E_YELLOW] > cell->colors[E_GREEN]) {
+      color.r = 200;
+      color.g = 180;
+      color.b = 40;
+    }
+
+    int x, y;
+    camera->WorldToView(cell->minX - unitHalfSize, cell->minY - unitHalfSize,
+                        &x, &y);
+
+    SDL_Rect blob;
+
+    blob.x = x;
+    blob.y = y;
+    blob.w = cell->maxX - cell->minX + 2 * unitHalfSize;
+    blob.h = cell->maxY - cell->minY + 2 * unitHalfSize;
+
+    queue->SubmitFill(L_TANK_BODIES, color, &blob, SDL_BLENDMODE_BLEND);
+  }
+}
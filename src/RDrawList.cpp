@@ -0,0 +1,236 @@
+#include "RDrawList.hpp"
+
+#include <SDL_render.h>
+#include <chrono>
+
+const double PI = 3.14159265358979323846;
+
+// health bar frame size; it hangs off the bottom of the body
+const int HEALTH_BAR_WIDTH = 120;
+const int HEALTH_BAR_HEIGHT = 15;
+
+RDrawList::RDrawList() {
+  tick = 0;
+
+  enemyTargetX = -1;
+  enemyTargetY = -1;
+
+  defenderHealth = 0;
+
+  amtRed = 0;
+  amtGreen = 0;
+  amtYellow = 0;
+}
+
+void RDrawList::Clear() {
+  projectiles.clear();
+  enemies.clear();
+  towers.clear();
+  sounds.clear();
+  effects.clear();
+}
+
+bool RDrawList::SubmitProjectile(RRenderQueue *queue,
+                                 RProjectileDrawItem *item, RTexture *texture,
+                                 RCamera *camera) {
+  if (!camera->IsVisible(item->posX, item->posY, texture->GetWidth() / 2,
+                         texture->GetHeight() / 2)) {
+    return false;
+  }
+
+  int x, y;
+  camera->WorldToView(item->posX, item->posY, &x, &y);
+
+  queue->SubmitTexture(L_PROJECTILES, texture, NULL, x, y);
+
+  return true;
+}
+
+bool RDrawList::SubmitEntity(RRenderQueue *queue, REntityDrawItem *item,
+                             RSprite *bodySprite, RSprite *weaponSprite,
+                             RCamera *camera, RCrowdDetail detail) {
+  // the weapon can stick out past the body when it turns, and the health bar
+  // is usually the widest part
+  int halfWidth = SDL_max(bodySprite->GetWidth(), weaponSprite->GetWidth());
+  int halfHeight = SDL_max(bodySprite->GetHeight(), weaponSprite->GetHeight());
+
+  halfWidth = SDL_max(halfWidth, HEALTH_BAR_WIDTH) / 2;
+  halfHeight = halfHeight / 2;
+
+  if (!camera->IsVisible(item->posX, item->posY, halfWidth, halfHeight)) {
+    return false;
+  }
+
+  int x, y;
+  camera->WorldToView(item->posX, item->posY, &x, &y);
+
+  RRenderLayer bodyLayer = L_TANK_BODIES;
+  RRenderLayer weaponLayer = L_TANK_WEAPONS;
+
+  if (item->kind == TOWER) {
+    bodyLayer = L_TOWER_BASES;
+    weaponLayer = L_TOWER_WEAPONS;
+  }
+
+  queue->SubmitTexture(bodyLayer, bodySprite->GetSheet(),
+                       bodySprite->GetClip(), x, y);
+
+  // rotated copies are the slow kind
+  if (detail < CD_FIXED_TURRETS) {
+    // 90 accounts for initial rotation
+    queue->SubmitTexture(weaponLayer, weaponSprite->GetSheet(),
+                         weaponSprite->GetClip(), x, y,
+                         item->weaponAngle * (180 / PI) + 90);
+  } else if (detail == CD_FIXED_TURRETS) {
+    queue->SubmitTexture(weaponLayer, weaponSprite->GetSheet(),
+                         weaponSprite->GetClip(), x, y);
+  }
+
+  // draw the healthbar
+  if (detail < CD_HURT_BARS || item->health < item->maxHealth) {
+    SubmitHealthBar(queue, item, x, y, bodySprite->GetHeight());
+  }
+
+  return true;
+}
+
+void RDrawList::SubmitHealthBar(RRenderQueue *queue, REntityDrawItem *item,
+                                int x, int y, int bodyHeight) {
+  SDL_Color frameColor;
+
+  frameColor.r = 18;
+  frameColor.g = 18;
+  frameColor.b = 18;
+  frameColor.a = 255;
+
+  SDL_Color fillColor;
+
+  fillColor.a = 255;
+
+  switch (item->kind) {
+  case TANK:
+    fillColor.r = 255;
+    fillColor.g = 0;
+    fillColor.b = 0;
+    break;
+  case TOWER:
+    fillColor.r = 0;
+    fillColor.g = 0;
+    fillColor.b = 255;
+    break;
+  default:
+    fillColor.r = 255;
+    fillColor.g = 255;
+    fillColor.b = 255;
+    break;
+  }
+
+  int barPad = 3;
+  int yCenterOffset = (float)bodyHeight / 2 - 15;
+
+  SDL_Rect frame;
+
+  frame.w = HEALTH_BAR_WIDTH;
+  frame.h = HEALTH_BAR_HEIGHT;
+  frame.x = x - (float)frame.w / 2;
+  frame.y = y + yCenterOffset;
+
+  SDL_Rect bar;
+
+  int maxBarWidth = frame.w - 2 * barPad;
+  int currBarWidth = maxBarWidth * ((float)item->health / item->maxHealth);
+
+  bar.x = frame.x + barPad;
+  bar.y = frame.y + barPad;
+  bar.w = currBarWidth;
+  bar.h = frame.h - 2 * barPad;
+
+  queue->SubmitFill(L_BAR_FRAMES, frameColor, &frame);
+  queue->SubmitFill(L_BAR_FILLS, fillColor, &bar);
+}
+
+RDrawListBuffer::RDrawListBuffer() {
+  writeIndex = 0;
+  readyIndex = 1;
+  readIndex = 2;
+
+  fresh = false;
+
+  maxCarriedSounds = 0;
+  maxCarriedEffects = 0;
+}
+
+// appends the newest of what was dropped, but only as much as fits in the
+// room current already has, so this never allocates under the lock
+// a list's own items come first and anything it carried after, so the
+// newest are at the front
+template <typename T>
+static void CarryOver(const std::vector<T> &dropped, std::vector<T> *current,
+                      int limit) {
+  size_t n = dropped.size();
+  size_t room = current->capacity() - current->size();
+
+  if (n > (size_t)limit) {
+    n = limit;
+  }
+
+  if (n > room) {
+    n = room;
+  }
+
+  current->insert(current->end(), dropped.begin(), dropped.begin() + n);
+}
+
+RDrawList *RDrawListBuffer::GetWriteList() { return &lists[writeIndex]; }
+
+void RDrawListBuffer::Publish() {
+  RDrawList *current = &lists[writeIndex];
+
+  // still ours, so any growing happens out here
+  current->sounds.reserve(current->sounds.size() + maxCarriedSounds);
+  current->effects.reserve(current->effects.size() + maxCarriedEffects);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // renderer never saw the last one; don't lose the sounds and effects
+    // it carried
+    if (fresh) {
+      CarryOver(lists[readyIndex].sounds, &current->sounds, maxCarriedSounds);
+      CarryOver(lists[readyIndex].effects, &current->effects,
+                maxCarriedEffects);
+    }
+
+    int swap = readyIndex;
+    readyIndex = writeIndex;
+    writeIndex = swap;
+
+    fresh = true;
+  }
+
+  published.notify_one();
+}
+
+void RDrawListBuffer::SetCarryLimits(int maxSounds, int maxEffects) {
+  maxCarriedSounds = maxSounds;
+  maxCarriedEffects = maxEffects;
+}
+
+RDrawList *RDrawListBuffer::Acquire(int timeoutMs, bool *isNew) {
+  std::unique_lock<std::mutex> lock(mutex);
+
+  published.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                     [this] { return fresh; });
+
+  *isNew = fresh;
+
+  if (fresh) {
+    int swap = readIndex;
+    readIndex = readyIndex;
+    readyIndex = swap;
+
+    fresh = false;
+  }
+
+  return &lists[readIndex];
+}
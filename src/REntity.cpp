@@ -1,55 +1,12 @@
 #include "REntity.hpp"
 
-#include <SDL_mixer.h>
-#include <SDL_render.h>
 #include <SDL_stdinc.h>
-#include <time.h>
+#include <stdio.h>
 
-const double PI = 3.14159265358979323846;
-
-RProjectile::RProjectile(REntity *issuer, RTexture *projectileTexture) {
-  posX = 0;
-  posY = 0;
-  velX = 0;
-  velY = 0;
-
-  texture = projectileTexture;
-
-  this->issuer = issuer;
-}
-
-int RProjectile::GetPosX() { return posX; }
-
-int RProjectile::GetPosY() { return posY; }
-
-REntity *RProjectile::GetIssuer() { return issuer; }
-
-void RProjectile::SetPos(int x, int y) {
-  posX = x;
-  posY = y;
-}
-
-void RProjectile::SetVel(int vx, int vy) {
-  velX = vx;
-  velY = vy;
-}
-
-void RProjectile::Move() {
-  posX += velX;
-  posY += velY;
-}
-
-void RProjectile::Render(SDL_Renderer *renderer) {
-  texture->Render(renderer, posX, posY, NULL, true);
-}
-
-REntity::REntity(EntityKind kind, RSprite *bodySprite, RSprite *weaponSprite,
-                 Mix_Chunk *shootSound) {
+REntity::REntity(EntityKind kind) {
   this->kind = kind;
-
-  this->bodySprite = bodySprite;
-  this->weaponSprite = weaponSprite;
-  this->shootSound = shootSound;
+  this->color = E_RED;
+  this->handle = NULL_HANDLE;
 
   posX = 0;
   posY = 0;
@@ -60,55 +17,88 @@ REntity::REntity(EntityKind kind, RSprite *bodySprite, RSprite *weaponSprite,
   targetX = -1;
   targetY = -1;
 
-  speed = 2;
+  speed = 240;
 
   projectileSpeed = 20;
   projectileDamage = 1;
 
   path = NULL;
-  pathLength = -1;
-  nextPathPoint = -1;
+  pathId = -1;
+  pathDistance = 0;
+  pathSegment = 0;
 
   weaponAngle = 0;
   fireRate = 2;
 
-  // start shoot timer right away
-  shootTimer.Start();
+  weaponReady = false;
 
   // start at full health
   maxHealth = 100;
   health = maxHealth;
+
+  // towers get theirs when they're placed
+  range = 0;
+  targetPolicy = T_FIRST;
+  lockedTarget = NULL_HANDLE;
+  retargetDue = false;
+
+  // every sprite we have is a single 128px tile
+  width = 128;
+  height = 128;
+
+  UpdateRect();
 }
 
-bool REntity::IsAtEndOfPath() { return nextPathPoint >= pathLength; }
+bool REntity::IsAtEndOfPath() {
+  return path != NULL && pathDistance >= path->GetLength();
+}
 
-int REntity::GetPosX() { return posX; }
+int REntity::GetPosX() { return (int)posX; }
 
-int REntity::GetPosY() { return posY; }
+int REntity::GetPosY() { return (int)posY; }
 
 int REntity::GetProjectileDamage() { return projectileDamage; }
 
 int REntity::GetHealth() { return health; }
 
+int REntity::GetMaxHealth() { return maxHealth; }
+
 float REntity::GetFireRate() { return fireRate; }
 
+RReal REntity::GetWeaponAngle() { return weaponAngle; }
+
+RReal REntity::GetPathProgress() { return pathDistance; }
+
+RReal REntity::GetRange() { return range; }
+
+RTargetPolicy REntity::GetTargetPolicy() { return targetPolicy; }
+
+REntityHandle REntity::GetLockedTarget() { return lockedTarget; }
+
+REntityHandle REntity::GetHandle() { return handle; }
+
+
+EntityKind REntity::GetKind() { return kind; }
+
+EnemyColor REntity::GetColor() { return color; }
+
 SDL_Rect *REntity::GetRect() {
-  // use body sprite draw rect for now
+  // body sized rect for now
   // probably going to use something else as collider in the future
   return &rect;
 }
 
-void REntity::SetPos(float x, float y) {
+void REntity::SetPos(RReal x, RReal y) {
   posX = x;
   posY = y;
 }
 
-void REntity::SetVel(float vx, float vy) {
+void REntity::SetVel(RReal vx, RReal vy) {
   velX = vx;
   velY = vy;
 }
 
-void REntity::SetTarget(float x, float y) {
+void REntity::SetTarget(RReal x, RReal y) {
   targetX = x;
   targetY = y;
 }
@@ -117,17 +107,49 @@ void REntity::SetProjectileSpeed(int speed) { projectileSpeed = speed; }
 
 void REntity::SetFireRate(int rate) { fireRate = rate; }
 
-void REntity::AddToShootTimer(float amt) { shootTimer.AddOffset(amt); }
 
-void REntity::SetPath(SDL_Point *path, int pathLength) {
+void REntity::SetPath(RPath *path, int pathId) {
   this->path = path;
-  this->pathLength = pathLength;
+  this->pathId = pathId;
 
-  // target the next point in the path
-  nextPathPoint = 0;
+  // start at the beginning
+  pathDistance = 0;
+  pathSegment = 0;
+
+  path->GetPosition(pathDistance, &pathSegment, &posX, &posY);
+}
+
+void REntity::SetSpeed(RReal speed) { this->speed = speed; }
+
+void REntity::SetMaxHealth(int health) {
+  maxHealth = health;
+  this->health = health;
+}
+
+void REntity::SetSize(int w, int h) {
+  width = w;
+  height = h;
+
+  UpdateRect();
 }
 
-void REntity::SetSpeed(int speed) { this->speed = speed; }
+void REntity::SetColor(EnemyColor color) { this->color = color; }
+
+void REntity::SetRange(RReal range) { this->range = range; }
+
+void REntity::SetTargetPolicy(RTargetPolicy policy) { targetPolicy = policy; }
+
+void REntity::SetLockedTarget(REntityHandle target) { lockedTarget = target; }
+
+void REntity::SetHandle(REntityHandle handle) { this->handle = handle; }
+
+bool REntity::IsWeaponReady() { return weaponReady; }
+
+void REntity::SetWeaponReady(bool ready) { weaponReady = ready; }
+
+bool REntity::IsRetargetDue() { return retargetDue; }
+
+void REntity::SetRetargetDue(bool due) { retargetDue = due; }
 
 void REntity::TakeDamage(int amt) {
   if (health - amt < 0) {
@@ -149,32 +171,15 @@ void REntity::Heal(int amt) {
   }
 }
 
-void REntity::MoveAlongPath() {
-  if (path == NULL || IsAtEndOfPath()) {
+void REntity::MoveAlongPath(float dt) {
+  if (path == NULL) {
     printf("No path defined!\n");
     return;
   }
 
-  float dx = path[nextPathPoint].x - posX;
-  float dy = path[nextPathPoint].y - posY;
-
-  // manual distance calc; use our new function!
-  float d = SDL_sqrtf(SDL_powf(dx, 2) + SDL_powf(dy, 2));
+  pathDistance += speed * (RReal)dt;
 
-  // if distance is very small, snap pos to node and target next node
-  // that 5 is picked arbitrarily
-  if (d < 5) {
-    SetPos(path[nextPathPoint].x, path[nextPathPoint].y);
-
-    nextPathPoint++;
-
-    return;
-  }
-
-  SetVel(dx / d, dy / d);
-
-  posX += (velX * speed);
-  posY += (velY * speed);
+  path->GetPosition(pathDistance, &pathSegment, &posX, &posY);
 }
 
 bool REntity::CheckCollision(SDL_Rect *a, SDL_Rect *b) {
@@ -243,130 +248,201 @@ bool REntity::CheckCollision(SDL_Rect *a, int x, int y) {
   return true;
 }
 
-float REntity::Distance(int x1, int y1, int x2, int y2){
-  return SDL_sqrtf(SDL_powf(x2 - x1, 2) + SDL_powf(y2 - y1, 2));
-}
+// narrows [tMin, tMax] to where p + t * d lies within lo..hi on one axis
+static bool ClipAxis(RReal p, RReal d, RReal lo, RReal hi, RReal *tMin,
+                     RReal *tMax) {
+  // parallel to this axis; either always inside or never
+  if (d == 0) {
+    return p >= lo && p <= hi;
+  }
 
-void REntity::Shoot(RTexture *projectileTexture,
-                    std::vector<RProjectile *> &gProjectiles, float dt) {
+  RReal t0 = (lo - p) / d;
+  RReal t1 = (hi - p) / d;
 
-  // this is the shoot timer
-  shootTimer.Tick(dt);
+  if (t0 > t1) {
+    RReal swap = t0;
+    t0 = t1;
+    t1 = swap;
+  }
 
-  // fire on set interval
-  if (shootTimer.GetTime() > 1 / fireRate) {
-    // don't forget to handle this dynamic mem!
-    RProjectile *n = new RProjectile(this, projectileTexture);
+  if (t0 > *tMin) {
+    *tMin = t0;
+  }
 
-    // calculate target using weapon angle
-    n->SetVel((int)(SDL_cosf(weaponAngle) * projectileSpeed),
-              (int)(SDL_sinf(weaponAngle) * projectileSpeed));
+  if (t1 < *tMax) {
+    *tMax = t1;
+  }
 
-    n->SetPos(this->posX, this->posY);
+  return *tMin <= *tMax;
+}
 
-    // add this projectile to registry
-    gProjectiles.push_back(n);
+bool REntity::SweepCollision(SDL_Rect *a, int x0, int y0, int x1, int y1,
+                             RReal *t) {
+  // slab test; edges count as inside, same as the point check
+  RReal tMin = 0;
+  RReal tMax = 1;
 
-    // play shoot sound
-    Mix_PlayChannel(0, shootSound, 0);
+  if (!ClipAxis((RReal)x0, (RReal)(x1 - x0), (RReal)a->x,
+                (RReal)(a->x + a->w), &tMin, &tMax)) {
+    return false;
+  }
 
-    shootTimer.Reset();
+  if (!ClipAxis((RReal)y0, (RReal)(y1 - y0), (RReal)a->y,
+                (RReal)(a->y + a->h), &tMin, &tMax)) {
+    return false;
   }
+
+  *t = tMin;
+
+  return true;
 }
 
-void REntity::Render(SDL_Renderer *renderer, float dt) {
-  // round float pos to integer coords before rendering
-  int rPosX = (int)SDL_roundf(posX);
-  int rPosY = (int)SDL_roundf(posY);
+RReal REntity::Distance(int x1, int y1, int x2, int y2){
+  return RealHypot((RReal)(x2 - x1), (RReal)(y2 - y1));
+}
 
+void REntity::Aim() {
   // point weapon to target if latter is ok (coords must be positive)
   if (targetX >= 0 && targetY >= 0) {
-    double dx = targetX - posX;
-    double dy = targetY - posY;
+    RReal dx = targetX - posX;
+    RReal dy = targetY - posY;
 
     // keep in radians, convert to deg when needed
-    weaponAngle = SDL_atan2(dy, dx);
+    weaponAngle = RealAtan2(dy, dx);
   }
+}
+
+void REntity::UpdateRect() {
+  // move the rect w/the entity
+  rect.w = width;
+  rect.h = height;
+  rect.x = (int)(posX - (RReal)rect.w / 2);
+  rect.y = (int)(posY - (RReal)rect.h / 2);
+}
+
+void REntity::Fire(RProjectileSpawn *fired) {
+  fired->issuer = handle;
+  fired->issuerKind = kind;
+  fired->damage = projectileDamage;
+
+  // calculate target using weapon angle
+  fired->velX = (int)(RealCos(weaponAngle) * (RReal)projectileSpeed);
+  fired->velY = (int)(RealSin(weaponAngle) * (RReal)projectileSpeed);
+
+  fired->posX = (int)this->posX;
+  fired->posY = (int)this->posY;
+}
+
+void REntity::Save(RSnapshotWriter *out) {
+  out->Write((Uint8)kind);
+  out->Write((Uint8)color);
+  out->Write((Uint8)targetPolicy);
+
+  out->Write(posX);
+  out->Write(posY);
+  out->Write(velX);
+  out->Write(velY);
+  out->Write(targetX);
+  out->Write(targetY);
+  out->Write(speed);
 
-  bodySprite->Render(renderer, dt, rPosX, rPosY, 0);
+  out->Write(projectileSpeed);
+  out->Write(projectileDamage);
 
-  // 90 accounts for initial rotation
-  weaponSprite->Render(renderer, dt, rPosX, rPosY,
-                       weaponAngle * (180 / PI) + 90);
+  out->Write((Sint32)(path != NULL ? pathId : -1));
+  out->Write(pathDistance);
+  out->Write(pathSegment);
 
-  // draw the healthbar
-  RenderHealthBar(renderer);
+  out->Write(weaponAngle);
+  out->Write((Uint8)weaponReady);
+  out->Write(fireRate);
 
-  // probably shouldn't be here, but move the rect w/the entity
-  rect.w = bodySprite->GetRect()->w;
-  rect.h = bodySprite->GetRect()->h;
-  rect.x = posX - (float)rect.w / 2;
-  rect.y = posY - (float)rect.h / 2;
+  out->Write(maxHealth);
+  out->Write(health);
+
+  out->Write(range);
+  out->Write((Uint8)retargetDue);
+
+  out->Write(width);
+  out->Write(height);
+
+  out->Write(handle);
+  out->Write(lockedTarget);
 }
 
-void REntity::RenderHealthBar(SDL_Renderer *renderer) {
-  SDL_Color frameColor;
-
-  frameColor.r = 18;
-  frameColor.g = 18;
-  frameColor.b = 18;
-  frameColor.a = 255;
-
-  SDL_Color fillColor;
-
-  fillColor.a = 255;
-  
-  switch (kind) {
-  case TANK:
-    fillColor.r = 255;
-    fillColor.g = 0;
-    fillColor.b = 0;
-    break;
-  case TOWER:
-    fillColor.r = 0;
-    fillColor.g = 0;
-    fillColor.b = 255;
-    break;
-  default:
-    fillColor.r = 255;
-    fillColor.g = 255;
-    fillColor.b = 255;
-    break;
+bool REntity::Load(RSnapshotReader *in, const std::vector<RPath *> &paths) {
+  Uint8 kind = 0, color = 0, targetPolicy = 0;
+
+  in->Read(&kind);
+  in->Read(&color);
+  in->Read(&targetPolicy);
+
+  // anything else means the snapshot is corrupt
+  if (kind > TOWER || !IsEnemyColor(color) || targetPolicy > T_STRONGEST) {
+    return false;
+  }
+
+  this->kind = (EntityKind)kind;
+  this->color = (EnemyColor)color;
+  this->targetPolicy = (RTargetPolicy)targetPolicy;
+
+  in->Read(&posX);
+  in->Read(&posY);
+  in->Read(&velX);
+  in->Read(&velY);
+  in->Read(&targetX);
+  in->Read(&targetY);
+  in->Read(&speed);
+
+  in->Read(&projectileSpeed);
+  in->Read(&projectileDamage);
+
+  Sint32 id = -1;
+
+  in->Read(&id);
+  in->Read(&pathDistance);
+  in->Read(&pathSegment);
+
+  // a path the world doesn't have means the snapshot isn't for this world
+  if (id < -1 || id >= (Sint32)paths.size()) {
+    return false;
+  }
+
+  // the end of the path counts as a segment of its own
+  int nSegments = id >= 0 ? paths[id]->GetPointCount() : 1;
+
+  if (pathSegment < 0 || pathSegment >= nSegments) {
+    return false;
   }
 
-  int barPad = 3;
-  int yCenterOffset = (float)bodySprite->GetHeight() / 2 - 15;
+  pathId = id;
+  path = id >= 0 ? paths[id] : NULL;
 
-  SDL_Rect frame;
+  Uint8 ready = 0;
 
-  frame.w = 120;
-  frame.h = 15;
-  frame.x = posX - (float)frame.w / 2;
-  frame.y = posY + yCenterOffset;
+  in->Read(&weaponAngle);
+  in->Read(&ready);
 
-  SDL_Rect bar;
+  weaponReady = ready;
+  in->Read(&fireRate);
 
-  int maxBarWidth = frame.w - 2 * barPad;
-  int currBarWidth = maxBarWidth * ((float)health / maxHealth);
+  in->Read(&maxHealth);
+  in->Read(&health);
 
-  bar.x = frame.x + barPad;
-  bar.y = frame.y + barPad;
-  bar.w = currBarWidth;
-  bar.h = frame.h - 2 * barPad;
+  Uint8 due = 0;
 
-  SDL_SetRenderDrawColor(renderer, frameColor.r, frameColor.g, frameColor.b,
-                         frameColor.a);
+  in->Read(&range);
+  in->Read(&due);
 
-  SDL_RenderFillRect(renderer, &frame);
+  retargetDue = due;
 
-  SDL_SetRenderDrawColor(renderer, fillColor.r, fillColor.g, fillColor.b,
-                         fillColor.a);
+  in->Read(&width);
+  in->Read(&height);
 
-  SDL_RenderFillRect(renderer, &bar);
+  in->Read(&handle);
+  in->Read(&lockedTarget);
 
-  // DEBUG
-  // draw render dest
-  // SDL_RenderDrawRect(renderer, this->GetRect()); 
+  UpdateRect();
 
-  SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+  return in->IsOk();
 }
@@ -0,0 +1,162 @@
+#include "REntityPool.hpp"
+
+#include "RMemory.hpp"
+
+REntityPool::REntityPool() {}
+
+REntityHandle REntityPool::Create(EntityKind kind) {
+  RMemScope scope(MEM_ENTITY);
+
+  REntityHandle handle;
+
+  if (!freeSlots.empty()) {
+    handle.index = freeSlots.back();
+    freeSlots.pop_back();
+
+    slots[handle.index] = REntity(kind);
+  } else {
+    handle.index = slots.size();
+
+    slots.emplace_back(kind);
+
+    // generation 0 is what null handles carry, so no slot ever uses it
+    generations.push_back(1);
+  }
+
+  handle.generation = generations[handle.index];
+
+  slots[handle.index].SetHandle(handle);
+
+  return handle;
+}
+
+void REntityPool::Destroy(REntityHandle handle) {
+  if (!IsValid(handle)) {
+    return;
+  }
+
+  // wraps after 4 billion reuses of one slot; skip the null generation
+  if (++generations[handle.index] == 0) {
+    generations[handle.index] = 1;
+  }
+
+  freeSlots.push_back(handle.index);
+}
+
+void REntityPool::Clear() {
+  slots.clear();
+  generations.clear();
+  freeSlots.clear();
+}
+
+REntity *REntityPool::Get(REntityHandle handle) {
+  return IsValid(handle) ? &slots[handle.index] : NULL;
+}
+
+void REntityPool::Reserve(int capacity) {
+  RMemScope scope(MEM_ENTITY);
+
+  int first = slots.size();
+
+  if (capacity <= first) {
+    return;
+  }
+
+  for (int i = first; i < capacity; ++i) {
+    slots.emplace_back(TANK);
+    generations.push_back(1);
+  }
+
+  // free slots are taken from the back, so put the lowest index there
+  for (int i = capacity - 1; i >= first; --i) {
+    freeSlots.push_back(i);
+  }
+}
+
+bool REntityPool::IsValid(REntityHandle handle) {
+  return handle.generation != 0 && handle.index < generations.size() &&
+         generations[handle.index] == handle.generation;
+}
+
+int REntityPool::GetCount() { return slots.size() - freeSlots.size(); }
+
+int REntityPool::GetCapacity() { return slots.size(); }
+
+const std::vector<Uint32> &REntityPool::GetFreeSlots() { return freeSlots; }
+
+void REntityPool::Save(RSnapshotWriter *out) {
+  out->Write((Sint32)slots.size());
+
+  for (int i = 0; i < slots.size(); ++i) {
+    slots[i].Save(out);
+  }
+
+  out->WriteBytes(generations.data(), generations.size() * sizeof(Uint32));
+
+  out->Write((Sint32)freeSlots.size());
+  out->WriteBytes(freeSlots.data(), freeSlots.size() * sizeof(Uint32));
+}
+
+bool REntityPool::Load(RSnapshotReader *in,
+                       const std::vector<RPath *> &paths) {
+  RMemScope scope(MEM_ENTITY);
+
+  Sint32 nSlots = 0;
+
+  // every entity takes more than a byte, so this also catches counts that
+  // are obviously garbage before we allocate for them
+  if (!in->Read(&nSlots) || !in->HasBytes(nSlots)) {
+    return false;
+  }
+
+  Clear();
+
+  for (int i = 0; i < nSlots; ++i) {
+    slots.emplace_back(TANK);
+
+    if (!slots.back().Load(in, paths)) {
+      return false;
+    }
+  }
+
+  generations.resize(nSlots);
+
+  if (!in->ReadBytes(generations.data(), nSlots * sizeof(Uint32))) {
+    return false;
+  }
+
+  Sint32 nFree = 0;
+
+  if (!in->Read(&nFree) || nFree < 0 || nFree > nSlots) {
+    return false;
+  }
+
+  freeSlots.resize(nFree);
+
+  if (!in->ReadBytes(freeSlots.data(), nFree * sizeof(Uint32))) {
+    return false;
+  }
+
+  // a slot freed twice would be handed out twice
+  std::vector<Uint8> isFree(nSlots, 0);
+
+  for (int i = 0; i < nFree; ++i) {
+    if (freeSlots[i] >= nSlots || isFree[freeSlots[i]]) {
+      return false;
+    }
+
+    isFree[freeSlots[i]] = 1;
+  }
+
+  // whoever is in a slot has to be the one its handles resolve to
+  for (int i = 0; i < nSlots; ++i) {
+    REntityHandle expected = {(Uint32)i, generations[i]};
+
+    if (generations[i] == 0 ||
+        (!isFree[i] && slots[i].GetHandle() != expected)) {
+      return false;
+    }
+  }
+
+  return true;
+}
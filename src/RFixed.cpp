@@ -0,0 +1,214 @@
+#include "RFixed.hpp"
+
+#include "RBits.hpp"
+
+// table steps per quarter turn; linear in between is good to a few
+// millionths, well under a fixed point step
+const int SIN_STEPS = 256;
+const int TURN_STEPS = SIN_STEPS * 4;
+
+// atan over ratios 0..1
+const int ATAN_STEPS = 256;
+
+// the tables are built in 2.30 fixed point and rounded down to 16.16 at the
+// end; the constants are the only numbers that didn't come from integers
+const int Q30_SHIFT = 30;
+const Sint64 Q30_ONE = (Sint64)1 << Q30_SHIFT;
+const Sint64 Q30_HALF_PI = 1686629713;
+
+// 2 pi in 12.20, for turning radians into table steps; finer than
+// FIXED_PI * 2 so big angles don't drift
+const int TWO_PI_SHIFT = 20;
+const Sint64 TWO_PI_Q20 = 6588397;
+
+static Uint64 SqrtU64(Uint64 x) {
+  if (x == 0) {
+    return 0;
+  }
+
+  // one bit of the result at a time, from the highest one x can have
+  Uint64 result = 0;
+  Uint64 bit = (Uint64)1 << (HighestBit(x) & ~1);
+
+  // branch free; which way each bit goes is a coin toss to the predictor
+  while (bit != 0) {
+    Uint64 trial = result + bit;
+    Uint64 take = -(Uint64)(x >= trial);
+
+    x -= trial & take;
+    result = (result >> 1) + (bit & take);
+    bit >>= 2;
+  }
+
+  return result;
+}
+
+static Sint64 MulQ30(Sint64 a, Sint64 b) { return (a * b) >> Q30_SHIFT; }
+
+static Sint32 Q30ToRaw(Sint64 x) {
+  Sint64 half = (Sint64)1 << (Q30_SHIFT - FIXED_SHIFT - 1);
+
+  return (Sint32)((x + half) >> (Q30_SHIFT - FIXED_SHIFT));
+}
+
+// taylor series; only ever asked for 0..pi/2, where it's done well before
+// running out of terms
+static Sint64 SinQ30(Sint64 x) {
+  Sint64 x2 = MulQ30(x, x);
+  Sint64 term = x;
+  Sint64 sum = x;
+
+  for (int n = 1; n < 12; ++n) {
+    term = MulQ30(term, x2) / ((2 * n) * (2 * n + 1));
+    sum += n % 2 == 1 ? -term : term;
+  }
+
+  return sum;
+}
+
+// same again for x in 0..tan(pi/8), where the series shrinks fast enough
+static Sint64 AtanSmallQ30(Sint64 x) {
+  Sint64 x2 = MulQ30(x, x);
+  Sint64 power = x;
+  Sint64 sum = x;
+
+  for (int n = 1; n < 24; ++n) {
+    power = MulQ30(power, x2);
+    Sint64 term = power / (2 * n + 1);
+    sum += n % 2 == 1 ? -term : term;
+  }
+
+  return sum;
+}
+
+// x in 0..1; halves the angle first:
+// atan(x) = 2 atan(x / (1 + sqrt(1 + x^2)))
+static Sint64 AtanQ30(Sint64 x) {
+  Sint64 root = SqrtU64((Uint64)(Q30_ONE + MulQ30(x, x)) << Q30_SHIFT);
+
+  return 2 * AtanSmallQ30((x << Q30_SHIFT) / (Q30_ONE + root));
+}
+
+typedef struct RFixedTables {
+  Sint32 sin[SIN_STEPS + 1];
+  Sint32 atan[ATAN_STEPS + 1];
+} RFixedTables;
+
+static RFixedTables BuildTables() {
+  RFixedTables tables;
+
+  for (int i = 0; i <= SIN_STEPS; ++i) {
+    tables.sin[i] = Q30ToRaw(SinQ30(Q30_HALF_PI * i / SIN_STEPS));
+  }
+
+  for (int i = 0; i <= ATAN_STEPS; ++i) {
+    tables.atan[i] = Q30ToRaw(AtanQ30(Q30_ONE * i / ATAN_STEPS));
+  }
+
+  return tables;
+}
+
+static const RFixedTables &GetTables() {
+  // built on first use, once, whichever thread gets there first
+  static const RFixedTables tables = BuildTables();
+
+  return tables;
+}
+
+// sin at a whole table step, any step
+static Sint32 SinAtStep(const Sint32 *table, int step) {
+  step &= TURN_STEPS - 1;
+
+  int quadrant = step / SIN_STEPS;
+  int i = step % SIN_STEPS;
+
+  switch (quadrant) {
+  case 0:
+    return table[i];
+  case 1:
+    return table[SIN_STEPS - i];
+  case 2:
+    return -table[i];
+  default:
+    return -table[SIN_STEPS - i];
+  }
+}
+
+// offset is in table steps; a quarter turn makes it cos
+static RFixed SinWithOffset(RFixed angle, int offset) {
+  const Sint32 *table = GetTables().sin;
+
+  // position in table steps, 16.16
+  Sint64 position = (Sint64)angle.GetRaw() *
+                    ((Sint64)TURN_STEPS << TWO_PI_SHIFT) / TWO_PI_Q20;
+
+  // the shift floors negatives too, so the fraction always counts forward
+  int step = (int)(position >> FIXED_SHIFT) + offset;
+  Sint64 fraction = position & (FIXED_ONE - 1);
+
+  Sint64 a = SinAtStep(table, step);
+  Sint64 b = SinAtStep(table, step + 1);
+
+  return RFixed::FromRaw((Sint32)(a + (((b - a) * fraction) >> FIXED_SHIFT)));
+}
+
+RFixed FixedSqrt(RFixed x) {
+  if (x.GetRaw() <= 0) {
+    return 0;
+  }
+
+  return RFixed::FromRaw((Sint32)SqrtU64((Uint64)x.GetRaw() << FIXED_SHIFT));
+}
+
+RFixed FixedHypot(RFixed dx, RFixed dy) {
+  Sint64 x = dx.GetRaw();
+  Sint64 y = dy.GetRaw();
+
+  // squares of 16.16 are 32.32, and the root of that is 16.16 again
+  Uint64 sum = (Uint64)(x * x) + (Uint64)(y * y);
+
+  return RFixed::FromRaw((Sint32)SqrtU64(sum));
+}
+
+RFixed FixedAtan2(RFixed y, RFixed x) {
+  Sint64 ax = x.GetRaw() < 0 ? -(Sint64)x.GetRaw() : x.GetRaw();
+  Sint64 ay = y.GetRaw() < 0 ? -(Sint64)y.GetRaw() : y.GetRaw();
+
+  if (ax == 0 && ay == 0) {
+    return 0;
+  }
+
+  const Sint32 *table = GetTables().atan;
+
+  // fold everything into the first octant, where the ratio is 0..1
+  bool steep = ay > ax;
+  Sint64 ratio = steep ? (ax << FIXED_SHIFT) / ay : (ay << FIXED_SHIFT) / ax;
+
+  Sint64 position = ratio * ATAN_STEPS;
+  int step = (int)(position >> FIXED_SHIFT);
+  Sint64 fraction = position & (FIXED_ONE - 1);
+
+  Sint64 angle = table[step];
+
+  if (step < ATAN_STEPS) {
+    angle += ((table[step + 1] - angle) * fraction) >> FIXED_SHIFT;
+  }
+
+  if (steep) {
+    angle = FIXED_HALF_PI.GetRaw() - angle;
+  }
+
+  if (x.GetRaw() < 0) {
+    angle = FIXED_PI.GetRaw() - angle;
+  }
+
+  if (y.GetRaw() < 0) {
+    angle = -angle;
+  }
+
+  return RFixed::FromRaw((Sint32)angle);
+}
+
+RFixed FixedSin(RFixed angle) { return SinWithOffset(angle, 0); }
+
+RFixed FixedCos(RFixed angle) { return SinWithOffset(angle, SIN_STEPS); }
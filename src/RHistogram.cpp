@@ -0,0 +1,146 @@
+#include "RHistogram.hpp"
+
+#include "RBits.hpp"
+#include <stdio.h>
+
+RHistogram::RHistogram(Uint64 maxValue, int subBucketBits) {
+  if (subBucketBits < 1 || subBucketBits > 16) {
+    printf("Histogram precision out of bounds! Using 7 bits.\n");
+    subBucketBits = 7;
+  }
+
+  this->subBucketBits = subBucketBits;
+  this->subBucketHalf = 1 << (subBucketBits - 1);
+  this->maxValue = maxValue > 0 ? maxValue : 1;
+
+  counts.assign(GetIndex(this->maxValue) + 1, 0);
+
+  count = 0;
+  min = 0;
+  max = 0;
+  sum = 0;
+}
+
+// the first 2^subBucketBits values get a bucket each; after that every
+// doubling of the value gets half that many, each twice as wide as the last
+int RHistogram::GetIndex(Uint64 value) const {
+  Uint64 mask = ((Uint64)1 << subBucketBits) - 1;
+
+  int shift = HighestBit(value | mask) - (subBucketBits - 1);
+
+  return shift * subBucketHalf + (int)(value >> shift);
+}
+
+Uint64 RHistogram::GetBucketTop(int index) const {
+  int subBucketCount = subBucketHalf * 2;
+
+  int shift = 0;
+
+  if (index >= subBucketCount) {
+    shift = (index - subBucketCount) / subBucketHalf + 1;
+  }
+
+  Uint64 sub = index - shift * subBucketHalf;
+
+  return ((sub + 1) << shift) - 1;
+}
+
+void RHistogram::Record(Uint64 value) {
+  if (value > maxValue) {
+    value = maxValue;
+  }
+
+  counts[GetIndex(value)]++;
+
+  if (count == 0 || value < min) {
+    min = value;
+  }
+
+  if (count == 0 || value > max) {
+    max = value;
+  }
+
+  count++;
+  sum += value;
+}
+
+void RHistogram::Merge(const RHistogram &other) {
+  if (other.counts.size() != counts.size() ||
+      other.subBucketBits != subBucketBits) {
+    printf("Could not merge histograms! Different layouts.\n");
+    return;
+  }
+
+  if (other.count == 0) {
+    return;
+  }
+
+  for (int i = 0; i < counts.size(); ++i) {
+    counts[i] += other.counts[i];
+  }
+
+  if (count == 0 || other.min < min) {
+    min = other.min;
+  }
+
+  if (count == 0 || other.max > max) {
+    max = other.max;
+  }
+
+  count += other.count;
+  sum += other.sum;
+}
+
+void RHistogram::Reset() {
+  for (int i = 0; i < counts.size(); ++i) {
+    counts[i] = 0;
+  }
+
+  count = 0;
+  min = 0;
+  max = 0;
+  sum = 0;
+}
+
+Uint64 RHistogram::GetCount() const { return count; }
+
+Uint64 RHistogram::GetMin() const { return min; }
+
+Uint64 RHistogram::GetMax() const { return max; }
+
+double RHistogram::GetMean() const { return count > 0 ? sum / count : 0; }
+
+Uint64 RHistogram::GetPercentile(double p) const {
+  if (count == 0) {
+    return 0;
+  }
+
+  if (p < 0) {
+    p = 0;
+  }
+
+  if (p > 100) {
+    p = 100;
+  }
+
+  // rank of the value we're after, counting from 1
+  Uint64 rank = (Uint64)(p / 100 * count + 0.5);
+
+  if (rank < 1) {
+    rank = 1;
+  }
+
+  Uint64 seen = 0;
+
+  for (int i = 0; i < counts.size(); ++i) {
+    seen += counts[i];
+
+    if (seen >= rank) {
+      // the bucket's top can overshoot what was actually recorded
+      Uint64 top = GetBucketTop(i);
+      return top < max ? top : max;
+    }
+  }
+
+  return max;
+}
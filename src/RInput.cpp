@@ -0,0 +1,89 @@
+#include "RInput.hpp"
+
+RInput::RInput() {
+  mouseX = 0;
+  mouseY = 0;
+  leftDown = false;
+
+  dragX = 0;
+  dragY = 0;
+
+  pending = false;
+  pendingSince = 0;
+}
+
+void RInput::HandleEvent(const SDL_Event *e) {
+  switch (e->type) {
+  case SDL_MOUSEMOTION:
+    mouseX = e->motion.x;
+    mouseY = e->motion.y;
+
+    if (e->motion.state & SDL_BUTTON_MMASK) {
+      dragX += e->motion.xrel;
+      dragY += e->motion.yrel;
+    }
+
+    Stamp(e->motion.timestamp);
+    break;
+
+  // clicks carry where they happened, which is what matters for them even
+  // if the mouse has moved on since
+  case SDL_MOUSEBUTTONDOWN:
+  case SDL_MOUSEBUTTONUP:
+    mouseX = e->button.x;
+    mouseY = e->button.y;
+
+    if (e->button.button == SDL_BUTTON_LEFT) {
+      leftDown = e->type == SDL_MOUSEBUTTONDOWN;
+    }
+
+    Stamp(e->button.timestamp);
+    break;
+
+  case SDL_MOUSEWHEEL:
+  case SDL_KEYDOWN:
+  case SDL_KEYUP:
+    Stamp(e->common.timestamp);
+    break;
+
+  default:
+    break;
+  }
+}
+
+void RInput::Stamp(Uint32 timestamp) {
+  if (!pending) {
+    pending = true;
+    pendingSince = timestamp;
+  }
+}
+
+void RInput::Latch() {
+  SDL_PumpEvents();
+  SDL_GetMouseState(&mouseX, &mouseY);
+}
+
+int RInput::GetMouseX() const { return mouseX; }
+
+int RInput::GetMouseY() const { return mouseY; }
+
+bool RInput::IsLeftDown() const { return leftDown; }
+
+void RInput::TakeDrag(int *dx, int *dy) {
+  *dx = dragX;
+  *dy = dragY;
+
+  dragX = 0;
+  dragY = 0;
+}
+
+int RInput::Presented() {
+  if (!pending) {
+    return -1;
+  }
+
+  pending = false;
+
+  // event timestamps are sdl ticks; unsigned so the 49 day wrap is fine
+  return (int)(Uint32)(SDL_GetTicks() - pendingSince);
+}
@@ -0,0 +1,201 @@
+#include "RJobSystem.hpp"
+
+RJobSystem::RJobSystem(int nWorkers) {
+  if (nWorkers < 0) {
+    // leave a core for the render thread and one for the caller
+    nWorkers = (int)std::thread::hardware_concurrency() - 2;
+
+    if (nWorkers < 0) {
+      nWorkers = 0;
+    }
+  }
+
+  queuedJobs = 0;
+  quitting = false;
+
+  for (int i = 0; i < nWorkers + 1; ++i) {
+    queues.push_back(new RJobQueue());
+    queues.back()->head = 0;
+  }
+
+  for (int i = 0; i < nWorkers; ++i) {
+    workers.push_back(std::thread(&RJobSystem::WorkerLoop, this, i));
+  }
+}
+
+RJobSystem::~RJobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    quitting = true;
+  }
+
+  wake.notify_all();
+
+  for (int i = 0; i < workers.size(); ++i) {
+    workers[i].join();
+  }
+
+  for (int i = 0; i < queues.size(); ++i) {
+    delete queues[i];
+  }
+}
+
+int RJobSystem::GetWorkerCount() { return workers.size(); }
+
+int RJobSystem::GetChunkCount(int count, int grain) {
+  if (count <= 0) {
+    return 0;
+  }
+
+  if (grain < 1) {
+    grain = 1;
+  }
+
+  return (count + grain - 1) / grain;
+}
+
+void RJobSystem::ParallelFor(int count, int grain, const RJobFunc &func) {
+  int nChunks = GetChunkCount(count, grain);
+
+  if (nChunks == 0) {
+    return;
+  }
+
+  if (grain < 1) {
+    grain = 1;
+  }
+
+  // nobody to share with, don't bother with the queues
+  if (workers.empty() || nChunks == 1) {
+    for (int i = 0; i < nChunks; ++i) {
+      int begin = i * grain;
+      int end = begin + grain < count ? begin + grain : count;
+
+      func(begin, end, i);
+    }
+
+    return;
+  }
+
+  std::lock_guard<std::mutex> callerLock(callerMutex);
+
+  std::atomic<int> remaining(nChunks);
+
+  // deal chunks out round robin; stealing evens out whatever is left uneven
+  for (int i = 0; i < nChunks; ++i) {
+    RJob job;
+
+    job.func = &func;
+    job.begin = i * grain;
+    job.end = job.begin + grain < count ? job.begin + grain : count;
+    job.chunk = i;
+    job.remaining = &remaining;
+
+    Push(i % queues.size(), job);
+  }
+
+  {
+    // lock so a worker can't miss the wakeup between checking and sleeping
+    std::lock_guard<std::mutex> lock(sleepMutex);
+  }
+
+  wake.notify_all();
+
+  // help out until everything is done
+  int callerQueue = queues.size() - 1;
+
+  while (remaining > 0) {
+    RJob job;
+
+    if (Pop(callerQueue, &job) || Steal(callerQueue, &job)) {
+      Run(&job);
+    }
+
+    else {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void RJobSystem::WorkerLoop(int queueIndex) {
+  while (true) {
+    RJob job;
+
+    if (Pop(queueIndex, &job) || Steal(queueIndex, &job)) {
+      Run(&job);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleepMutex);
+
+    wake.wait(lock, [this] { return quitting || queuedJobs > 0; });
+
+    if (quitting) {
+      return;
+    }
+  }
+}
+
+void RJobSystem::Push(int queueIndex, RJob job) {
+  RJobQueue *queue = queues[queueIndex];
+
+  std::lock_guard<std::mutex> lock(queue->mutex);
+
+  queue->jobs.push_back(job);
+  queuedJobs++;
+}
+
+bool RJobSystem::Pop(int queueIndex, RJob *job) {
+  RJobQueue *queue = queues[queueIndex];
+
+  std::lock_guard<std::mutex> lock(queue->mutex);
+
+  if (queue->head == queue->jobs.size()) {
+    return false;
+  }
+
+  // newest first off our own queue
+  *job = queue->jobs.back();
+  queue->jobs.pop_back();
+  queuedJobs--;
+
+  if (queue->head == queue->jobs.size()) {
+    queue->jobs.clear();
+    queue->head = 0;
+  }
+
+  return true;
+}
+
+bool RJobSystem::Steal(int queueIndex, RJob *job) {
+  int nQueues = queues.size();
+
+  for (int i = 1; i < nQueues; ++i) {
+    RJobQueue *victim = queues[(queueIndex + i) % nQueues];
+
+    std::lock_guard<std::mutex> lock(victim->mutex);
+
+    if (victim->head == victim->jobs.size()) {
+      continue;
+    }
+
+    // oldest first off someone else's
+    *job = victim->jobs[victim->head++];
+    queuedJobs--;
+
+    if (victim->head == victim->jobs.size()) {
+      victim->jobs.clear();
+      victim->head = 0;
+    }
+
+    return true;
+  }
+
+  return false;
+}
+
+void RJobSystem::Run(RJob *job) {
+  (*job->func)(job->begin, job->end, job->chunk);
+
+  (*job->remaining)--;
+}
@@ -0,0 +1,395 @@
+#include "RJson.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// nesting deeper than this is refused rather than risking the stack
+const int MAX_DEPTH = 64;
+
+// recursive descent over the text; stops at the first error
+class RJsonParser {
+public:
+  RJsonParser(const char *text, int length, const char *where) {
+    this->text = text;
+    this->length = length;
+    this->where = where;
+
+    pos = 0;
+    failed = false;
+  }
+
+  bool ParseDocument(RJsonValue *out) {
+    ParseValue(out, 0);
+    SkipSpace();
+
+    if (!failed && pos != length) {
+      Fail("trailing characters");
+    }
+
+    return !failed;
+  }
+
+private:
+  void Fail(const char *what) {
+    if (failed) {
+      return;
+    }
+
+    // line number is much more useful than an offset into a big file
+    int line = 1;
+
+    for (int i = 0; i < pos && i < length; ++i) {
+      if (text[i] == '\n') {
+        line++;
+      }
+    }
+
+    printf("%s:%d: %s\n", where, line, what);
+    failed = true;
+  }
+
+  void SkipSpace() {
+    while (pos < length && (text[pos] == ' ' || text[pos] == '\t' ||
+                            text[pos] == '\n' || text[pos] == '\r')) {
+      pos++;
+    }
+  }
+
+  bool Match(const char *word) {
+    int n = strlen(word);
+
+    if (pos + n > length || strncmp(text + pos, word, n) != 0) {
+      return false;
+    }
+
+    pos += n;
+    return true;
+  }
+
+  void ParseValue(RJsonValue *out, int depth) {
+    if (depth > MAX_DEPTH) {
+      Fail("nested too deep");
+      return;
+    }
+
+    SkipSpace();
+
+    if (pos >= length) {
+      Fail("unexpected end");
+      return;
+    }
+
+    char c = text[pos];
+
+    if (c == '{') {
+      ParseObject(out, depth);
+    } else if (c == '[') {
+      ParseArray(out, depth);
+    } else if (c == '"') {
+      out->type = J_STRING;
+      ParseString(&out->string);
+    } else if (Match("true")) {
+      out->type = J_BOOL;
+      out->boolean = true;
+    } else if (Match("false")) {
+      out->type = J_BOOL;
+      out->boolean = false;
+    } else if (Match("null")) {
+      out->type = J_NULL;
+    } else {
+      ParseNumber(out);
+    }
+  }
+
+  void ParseObject(RJsonValue *out, int depth) {
+    out->type = J_OBJECT;
+
+    // skip {
+    pos++;
+    SkipSpace();
+
+    if (pos < length && text[pos] == '}') {
+      pos++;
+      return;
+    }
+
+    while (!failed) {
+      SkipSpace();
+
+      if (pos >= length || text[pos] != '"') {
+        Fail("expected a key");
+        return;
+      }
+
+      out->keys.emplace_back();
+      ParseString(&out->keys.back());
+
+      SkipSpace();
+
+      if (pos >= length || text[pos] != ':') {
+        Fail("expected :");
+        return;
+      }
+
+      pos++;
+
+      out->items.emplace_back();
+      ParseValue(&out->items.back(), depth + 1);
+
+      SkipSpace();
+
+      if (pos < length && text[pos] == ',') {
+        pos++;
+      } else if (pos < length && text[pos] == '}') {
+        pos++;
+        return;
+      } else {
+        Fail("expected , or }");
+      }
+    }
+  }
+
+  void ParseArray(RJsonValue *out, int depth) {
+    out->type = J_ARRAY;
+
+    // skip [
+    pos++;
+    SkipSpace();
+
+    if (pos < length && text[pos] == ']') {
+      pos++;
+      return;
+    }
+
+    while (!failed) {
+      out->items.emplace_back();
+      ParseValue(&out->items.back(), depth + 1);
+
+      SkipSpace();
+
+      if (pos < length && text[pos] == ',') {
+        pos++;
+      } else if (pos < length && text[pos] == ']') {
+        pos++;
+        return;
+      } else {
+        Fail("expected , or ]");
+      }
+    }
+  }
+
+  void ParseString(std::string *out) {
+    // skip the opening quote
+    pos++;
+
+    // most strings have no escapes; copy runs of plain characters at once
+    while (pos < length) {
+      int start = pos;
+
+      while (pos < length && text[pos] != '"' && text[pos] != '\\') {
+        pos++;
+      }
+
+      out->append(text + start, pos - start);
+
+      if (pos >= length) {
+        break;
+      }
+
+      if (text[pos] == '"') {
+        pos++;
+        return;
+      }
+
+      // escape
+      pos++;
+
+      if (pos >= length) {
+        break;
+      }
+
+      char c = text[pos++];
+
+      switch (c) {
+      case '"':
+      case '\\':
+      case '/':
+        out->push_back(c);
+        break;
+      case 'b':
+        out->push_back('\b');
+        break;
+      case 'f':
+        out->push_back('\f');
+        break;
+      case 'n':
+        out->push_back('\n');
+        break;
+      case 'r':
+        out->push_back('\r');
+        break;
+      case 't':
+        out->push_back('\t');
+        break;
+      case 'u':
+        ParseCodepoint(out);
+        break;
+      default:
+        Fail("bad escape in string");
+        return;
+      }
+    }
+
+    Fail("unterminated string");
+  }
+
+  void ParseCodepoint(std::string *out) {
+    if (pos + 4 > length) {
+      Fail("bad \\u escape");
+      return;
+    }
+
+    char hex[5] = {0};
+    memcpy(hex, text + pos, 4);
+
+    char *end;
+    unsigned long code = strtoul(hex, &end, 16);
+
+    if (end != hex + 4) {
+      Fail("bad \\u escape");
+      return;
+    }
+
+    pos += 4;
+
+    // surrogate pairs aren't worth it here; they come out as two codepoints
+    if (code < 0x80) {
+      out->push_back(code);
+    } else if (code < 0x800) {
+      out->push_back(0xC0 | (code >> 6));
+      out->push_back(0x80 | (code & 0x3F));
+    } else {
+      out->push_back(0xE0 | (code >> 12));
+      out->push_back(0x80 | ((code >> 6) & 0x3F));
+      out->push_back(0x80 | (code & 0x3F));
+    }
+  }
+
+  void ParseNumber(RJsonValue *out) {
+    // strtod wants a terminated string and the text might not be
+    char buffer[64];
+    int n = 0;
+
+    while (pos + n < length && n < (int)sizeof(buffer) - 1 &&
+           strchr("+-0123456789.eE", text[pos + n]) != NULL) {
+      buffer[n] = text[pos + n];
+      n++;
+    }
+
+    buffer[n] = '\0';
+
+    char *end;
+    double value = strtod(buffer, &end);
+
+    if (n == 0 || end != buffer + n) {
+      Fail("unexpected character");
+      return;
+    }
+
+    out->type = J_NUMBER;
+    out->number = value;
+
+    pos += n;
+  }
+
+  const char *text;
+  int length;
+  const char *where;
+
+  int pos;
+  bool failed;
+};
+
+RJsonValue::RJsonValue() {
+  type = J_NULL;
+  boolean = false;
+  number = 0;
+}
+
+bool RJsonValue::LoadFromFile(const char *path) {
+  FILE *file = fopen(path, "rb");
+
+  if (file == NULL) {
+    printf("Could not open %s!\n", path);
+    return false;
+  }
+
+  std::vector<char> text;
+  char buffer[4096];
+  size_t n;
+
+  while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    text.insert(text.end(), buffer, buffer + n);
+  }
+
+  fclose(file);
+
+  return Parse(text.data(), text.size(), path);
+}
+
+bool RJsonValue::Parse(const char *text, int length, const char *where) {
+  RJsonValue parsed;
+  RJsonParser parser(text, length, where);
+
+  if (!parser.ParseDocument(&parsed)) {
+    return false;
+  }
+
+  *this = std::move(parsed);
+  return true;
+}
+
+RJsonType RJsonValue::GetType() { return type; }
+
+bool RJsonValue::GetBool(bool fallback) {
+  return type == J_BOOL ? boolean : fallback;
+}
+
+double RJsonValue::GetNumber(double fallback) {
+  // the map editor writes some numbers as strings (tile ids)
+  if (type == J_STRING) {
+    char *end;
+    double value = strtod(string.c_str(), &end);
+
+    return end != string.c_str() && *end == '\0' ? value : fallback;
+  }
+
+  return type == J_NUMBER ? number : fallback;
+}
+
+int RJsonValue::GetInt(int fallback) { return GetNumber(fallback); }
+
+std::string &RJsonValue::GetString() { return string; }
+
+int RJsonValue::GetSize() { return items.size(); }
+
+RJsonValue *RJsonValue::GetItem(int i) {
+  if (i < 0 || i >= items.size()) {
+    return NULL;
+  }
+
+  return &items[i];
+}
+
+RJsonValue *RJsonValue::Get(const char *key) {
+  for (int i = 0; i < keys.size(); ++i) {
+    if (keys[i] == key) {
+      return &items[i];
+    }
+  }
+
+  return NULL;
+}
+
+std::string &RJsonValue::GetKey(int i) { return keys[i]; }
@@ -0,0 +1,674 @@
+#include "RLockstep.hpp"
+
+#include "RFixed.hpp"
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+const Uint8 PACKET_HELLO = 0;
+const Uint8 PACKET_WELCOME = 1;
+const Uint8 PACKET_INPUT = 2;
+
+const char *PACKET_MAGIC = "DTLS";
+const int PACKET_MAGIC_SIZE = 4;
+
+// input goes out every this many ticks, a couple of ticks to a packet; the
+// input delay covers the wait
+const int NET_SEND_TICKS = 2;
+
+// resend anything unacknowledged this often, and say something at least
+// this often even with nothing to say, so acks and hashes keep flowing
+const int NET_RESEND_MS = 20;
+const int NET_KEEPALIVE_MS = 100;
+
+// how often hellos go out while joining
+const int NET_HELLO_MS = 200;
+
+// nothing from the other side for this long and they're gone
+const int NET_TIMEOUT_MS = 5000;
+
+const int NET_WAIT_MS = 1;
+
+static Uint64 ZigZag(Sint64 value) {
+  return ((Uint64)value << 1) ^ (Uint64)(value >> 63);
+}
+
+static Sint64 UnZigZag(Uint64 value) {
+  return (Sint64)(value >> 1) ^ -(Sint64)(value & 1);
+}
+
+// packets are built into a fixed buffer; writing past the end marks it full
+// instead of overrunning
+typedef struct RPacketWriter {
+  Uint8 data[NET_MAX_PACKET];
+  int size;
+  bool full;
+} RPacketWriter;
+
+typedef struct RPacketReader {
+  const Uint8 *data;
+  int size;
+  int offset;
+  bool failed;
+} RPacketReader;
+
+static void BeginPacket(RPacketWriter *writer, Uint8 kind) {
+  memcpy(writer->data, PACKET_MAGIC, PACKET_MAGIC_SIZE);
+  writer->data[PACKET_MAGIC_SIZE] = kind;
+
+  writer->size = PACKET_MAGIC_SIZE + 1;
+  writer->full = false;
+}
+
+static void WriteByte(RPacketWriter *writer, Uint8 value) {
+  if (writer->size >= NET_MAX_PACKET) {
+    writer->full = true;
+    return;
+  }
+
+  writer->data[writer->size++] = value;
+}
+
+static void WriteFixed(RPacketWriter *writer, Uint64 value, int nBytes) {
+  for (int i = 0; i < nBytes; ++i) {
+    WriteByte(writer, (value >> (8 * i)) & 0xFF);
+  }
+}
+
+static void WriteVarint(RPacketWriter *writer, Uint64 value) {
+  while (value >= 0x80) {
+    WriteByte(writer, (value & 0x7F) | 0x80);
+    value >>= 7;
+  }
+
+  WriteByte(writer, value);
+}
+
+static Uint8 ReadByte(RPacketReader *reader) {
+  if (reader->offset >= reader->size) {
+    reader->failed = true;
+    return 0;
+  }
+
+  return reader->data[reader->offset++];
+}
+
+static Uint64 ReadFixed(RPacketReader *reader, int nBytes) {
+  Uint64 value = 0;
+
+  for (int i = 0; i < nBytes; ++i) {
+    value |= (Uint64)ReadByte(reader) << (8 * i);
+  }
+
+  return value;
+}
+
+static Uint64 ReadVarint(RPacketReader *reader) {
+  Uint64 value = 0;
+
+  for (int shift = 0; shift < 64; shift += 7) {
+    Uint8 byte = ReadByte(reader);
+
+    value |= (Uint64)(byte & 0x7F) << shift;
+
+    if (!(byte & 0x80)) {
+      break;
+    }
+  }
+
+  return value;
+}
+
+RLockstep::RLockstep() {
+  peer.host = 0;
+  peer.port = 0;
+
+  active = false;
+  host = false;
+
+  seed = 0;
+  inputDelay = 0;
+  towerPolicy = T_FIRST;
+  retargetInterval = 0;
+  waveHash = 0;
+  refused = false;
+
+  memset(&stats, 0, sizeof(stats));
+
+  for (int i = 0; i < 2; ++i) {
+    frames[i].resize(NET_FRAME_WINDOW);
+  }
+
+  Start();
+  active = false;
+}
+
+void RLockstep::Start() {
+  for (int i = 0; i < 2; ++i) {
+    for (int j = 0; j < NET_FRAME_WINDOW; ++j) {
+      frames[i][j].tick = -1;
+      frames[i][j].commands.clear();
+    }
+  }
+
+  overflow.clear();
+
+  // the first inputDelay ticks have no input from anyone, so they're in
+  // already
+  peerHas = inputDelay;
+  weHave = inputDelay;
+  nextLocal = inputDelay;
+  simTick = 0;
+
+  for (int i = 0; i < NET_HASH_SLOTS; ++i) {
+    localHashes[i].tick = -1;
+    localHashes[i].hash = 0;
+  }
+
+  lastLocalHash = localHashes[0];
+  peerHash = localHashes[0];
+
+  desynced = false;
+  desyncTick = 0;
+
+  peerLost = false;
+  lastHeard = NetMilliseconds();
+  lastSent = 0;
+
+  active = true;
+}
+
+bool RLockstep::Host(int port, Uint32 seed, int inputDelay,
+                     RTargetPolicy towerPolicy, float retargetInterval,
+                     Uint64 waveHash, float timeout) {
+  if (inputDelay < 0 || inputDelay > NET_MAX_INPUT_DELAY) {
+    printf("Input delay has to be 0 to %d ticks!\n", NET_MAX_INPUT_DELAY);
+    return false;
+  }
+
+  // the joining side would turn them down
+  if (!IsTargetPolicy(towerPolicy) || !IsEventSeconds(retargetInterval)) {
+    printf("Can't host with that tower targeting!\n");
+    return false;
+  }
+
+  if (!socket.Open(port)) {
+    return false;
+  }
+
+  host = true;
+  active = false;
+
+  this->seed = seed;
+  this->inputDelay = inputDelay;
+  this->towerPolicy = towerPolicy;
+  this->retargetInterval = retargetInterval;
+  this->waveHash = waveHash;
+
+  printf("Waiting for someone to join on port %d...\n", socket.GetPort());
+
+  Uint64 start = NetMilliseconds();
+
+  // the hello that comes in starts us
+  while (!active) {
+    Poll();
+
+    if (timeout > 0 && NetMilliseconds() - start > timeout * 1000) {
+      printf("Nobody joined!\n");
+      socket.Close();
+      return false;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(NET_WAIT_MS));
+  }
+
+  return true;
+}
+
+bool RLockstep::Join(const char *address, Uint64 waveHash, float timeout) {
+  if (!ResolveAddress(address, &peer) || !socket.Open(0)) {
+    return false;
+  }
+
+  host = false;
+  active = false;
+  refused = false;
+
+  this->waveHash = waveHash;
+
+  printf("Joining %s...\n", address);
+
+  Uint64 start = NetMilliseconds();
+  Uint64 lastHello = 0;
+
+  // keep saying hello until the welcome makes it back
+  while (!active) {
+    Uint64 now = NetMilliseconds();
+
+    if (lastHello == 0 || now - lastHello >= NET_HELLO_MS) {
+      SendHello();
+      lastHello = now;
+    }
+
+    Poll();
+
+    if (refused) {
+      socket.Close();
+      return false;
+    }
+
+    if (timeout > 0 && now - start > timeout * 1000) {
+      printf("Nobody answered at %s!\n", address);
+      socket.Close();
+      return false;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(NET_WAIT_MS));
+  }
+
+  return true;
+}
+
+bool RLockstep::IsActive() { return active; }
+
+bool RLockstep::IsHost() { return host; }
+
+Uint32 RLockstep::GetSeed() { return seed; }
+
+int RLockstep::GetInputDelay() { return inputDelay; }
+
+RTargetPolicy RLockstep::GetTowerPolicy() { return towerPolicy; }
+
+float RLockstep::GetRetargetInterval() { return retargetInterval; }
+
+int RLockstep::GetLocalPeer() { return host ? 0 : 1; }
+
+void RLockstep::Poll() {
+  if (!socket.IsOpen()) {
+    return;
+  }
+
+  Uint8 data[NET_MAX_PACKET];
+  RNetAddress from;
+  int size;
+
+  while ((size = socket.Receive(&from, data, NET_MAX_PACKET)) >= 0) {
+    HandlePacket(from, data, size);
+  }
+
+  if (!active || peerLost) {
+    return;
+  }
+
+  Uint64 now = NetMilliseconds();
+
+  if (now - lastHeard > NET_TIMEOUT_MS) {
+    printf("Lost the other player; carrying on alone.\n");
+    peerLost = true;
+    return;
+  }
+
+  bool unacked = peerHas < nextLocal;
+
+  if ((unacked && now - lastSent >= NET_RESEND_MS) ||
+      now - lastSent >= NET_KEEPALIVE_MS) {
+    SendInput();
+  }
+}
+
+bool RLockstep::IsReady(Uint64 tick) {
+  if (!active || peerLost) {
+    return true;
+  }
+
+  // their input for tick has to be in, and the input this tick makes has to
+  // fit next to what they haven't acknowledged yet
+  bool ready = tick < weHave && nextLocal + 1 - peerHas <= NET_FRAME_WINDOW;
+
+  if (!ready) {
+    stats.stalls++;
+  }
+
+  return ready;
+}
+
+void RLockstep::Exchange(Uint64 tick, std::vector<RCommand> *commands) {
+  if (!active) {
+    return;
+  }
+
+  int local = GetLocalPeer();
+
+  // ours, for later
+  Uint64 target = tick + inputDelay;
+  RNetFrame *frame = &frames[local][target % NET_FRAME_WINDOW];
+
+  overflow.insert(overflow.end(), commands->begin(), commands->end());
+
+  int n = overflow.size() < NET_MAX_COMMANDS ? overflow.size()
+                                             : NET_MAX_COMMANDS;
+
+  frame->tick = target;
+  frame->commands.assign(overflow.begin(), overflow.begin() + n);
+  overflow.erase(overflow.begin(), overflow.begin() + n);
+
+  nextLocal = target + 1;
+  simTick = tick + 1;
+
+  if (!peerLost && nextLocal % NET_SEND_TICKS == 0) {
+    SendInput();
+  }
+
+  // everyone's, for now
+  commands->clear();
+
+  for (int i = 0; i < 2; ++i) {
+    RNetFrame *now = &frames[i][tick % NET_FRAME_WINDOW];
+
+    if (now->tick == (Sint64)tick) {
+      commands->insert(commands->end(), now->commands.begin(),
+                       now->commands.end());
+    }
+  }
+}
+
+void RLockstep::RecordHash(Uint64 tick, Uint64 hash) {
+  RNetHash *slot = &localHashes[(tick / NET_HASH_INTERVAL) % NET_HASH_SLOTS];
+
+  slot->tick = tick;
+  slot->hash = hash;
+
+  lastLocalHash = *slot;
+
+  CheckHashes();
+}
+
+void RLockstep::CheckHashes() {
+  if (desynced || peerHash.tick < 0) {
+    return;
+  }
+
+  RNetHash *ours =
+      &localHashes[(peerHash.tick / NET_HASH_INTERVAL) % NET_HASH_SLOTS];
+
+  // whoever's behind checks once they get there
+  if (ours->tick != peerHash.tick) {
+    return;
+  }
+
+  if (ours->hash != peerHash.hash) {
+    desynced = true;
+    desyncTick = ours->tick;
+
+    printf("Desync! The two worlds differ after tick %llu.\n",
+           (unsigned long long)desyncTick);
+  }
+}
+
+bool RLockstep::IsDesynced() { return desynced; }
+
+Uint64 RLockstep::GetDesyncTick() { return desyncTick; }
+
+bool RLockstep::IsPeerLost() { return peerLost; }
+
+RNetStats RLockstep::GetStats() { return stats; }
+
+void RLockstep::HandlePacket(const RNetAddress &from, const Uint8 *data,
+                             int size) {
+  if (size <= PACKET_MAGIC_SIZE ||
+      memcmp(data, PACKET_MAGIC, PACKET_MAGIC_SIZE) != 0) {
+    return;
+  }
+
+  Uint8 kind = data[PACKET_MAGIC_SIZE];
+
+  // a host that's still waiting takes a hello from anyone; otherwise only
+  // the peer gets a say
+  bool waiting = host && !active;
+
+  if (!waiting && !SameAddress(from, peer)) {
+    return;
+  }
+
+  stats.packetsReceived++;
+  stats.bytesReceived += size;
+
+  RPacketReader reader = {data, size, PACKET_MAGIC_SIZE + 1, false};
+
+  if (kind == PACKET_HELLO && host) {
+    int version = ReadByte(&reader);
+
+    if (reader.failed || version != NET_PROTOCOL_VERSION) {
+      printf("Someone tried to join with protocol version %d, we're on %d!\n",
+             version, NET_PROTOCOL_VERSION);
+      return;
+    }
+
+    // a float build and a fixed point one can't keep each other in step
+    int fixedPoint = ReadByte(&reader);
+
+    if (reader.failed || fixedPoint != SIM_FIXED_POINT) {
+      printf("Someone tried to join from a %s build, this one is %s!\n",
+             fixedPoint ? "fixed point" : "float",
+             SIM_FIXED_POINT ? "fixed point" : "float");
+      return;
+    }
+
+    // tanks would turn up on one side only; they hear about it from the
+    // welcome, which has ours, instead of waiting out their timeout
+    Uint64 peerWaves = ReadFixed(&reader, 8);
+
+    if (reader.failed || peerWaves != waveHash) {
+      printf("Someone tried to join with different waves!\n");
+      SendWelcome(from);
+      return;
+    }
+
+    if (waiting) {
+      peer = from;
+      Start();
+    }
+
+    // again if they're still saying hello; the last welcome got lost
+    SendWelcome(peer);
+  }
+
+  else if (kind == PACKET_WELCOME && !host && !active) {
+    Uint32 newSeed = ReadFixed(&reader, 4);
+    int newDelay = ReadByte(&reader);
+    Uint64 hostWaves = ReadFixed(&reader, 8);
+    int newPolicy = ReadByte(&reader);
+    Uint32 intervalBits = ReadFixed(&reader, 4);
+
+    float newInterval = 0;
+    memcpy(&newInterval, &intervalBits, sizeof(newInterval));
+
+    if (reader.failed || newDelay > NET_MAX_INPUT_DELAY ||
+        !IsTargetPolicy(newPolicy) || !IsEventSeconds(newInterval)) {
+      return;
+    }
+
+    if (hostWaves != waveHash) {
+      printf("The host is playing different waves!\n");
+      refused = true;
+      return;
+    }
+
+    seed = newSeed;
+    inputDelay = newDelay;
+    towerPolicy = (RTargetPolicy)newPolicy;
+    retargetInterval = newInterval;
+
+    Start();
+  }
+
+  else if (kind == PACKET_INPUT && active) {
+    HandleInput(data, size);
+  }
+
+  if (active) {
+    lastHeard = NetMilliseconds();
+  }
+}
+
+void RLockstep::HandleInput(const Uint8 *data, int size) {
+  RPacketReader reader = {data, size, PACKET_MAGIC_SIZE + 1, false};
+
+  Uint64 wanted = ReadVarint(&reader);
+  Uint64 hashTick = ReadVarint(&reader);
+  Uint64 hash = ReadFixed(&reader, 8);
+  Uint64 first = ReadVarint(&reader);
+  int nFrames = ReadByte(&reader);
+
+  if (reader.failed) {
+    return;
+  }
+
+  // acks and hashes can come out of order; only ever move forward
+  if (wanted > peerHas && wanted <= nextLocal) {
+    peerHas = wanted;
+  }
+
+  // hash ticks go out one up, so 0 can mean none yet
+  if (hashTick > 0 && (Sint64)hashTick - 1 > peerHash.tick) {
+    peerHash.tick = hashTick - 1;
+    peerHash.hash = hash;
+  }
+
+  std::vector<RNetFrame> &theirs = frames[1 - GetLocalPeer()];
+
+  for (int i = 0; i < nFrames; ++i) {
+    Uint64 tick = first + i;
+    int nCommands = ReadByte(&reader);
+
+    if (nCommands > NET_MAX_COMMANDS) {
+      return;
+    }
+
+    RNetFrame *frame = &theirs[tick % NET_FRAME_WINDOW];
+
+    // anything we've already got, or that would land on a slot still in use,
+    // is read past
+    bool keep = tick >= weHave && tick < simTick + NET_FRAME_WINDOW &&
+                frame->tick != (Sint64)tick;
+
+    if (keep) {
+      frame->tick = -1;
+      frame->commands.clear();
+    }
+
+    for (int j = 0; j < nCommands; ++j) {
+      RCommand command;
+
+      command.type = (RCommandType)ReadByte(&reader);
+      command.a = UnZigZag(ReadVarint(&reader));
+      command.b = UnZigZag(ReadVarint(&reader));
+
+      if (keep) {
+        frame->commands.push_back(command);
+      }
+    }
+
+    if (reader.failed) {
+      return;
+    }
+
+    if (keep) {
+      frame->tick = tick;
+    }
+  }
+
+  while (theirs[weHave % NET_FRAME_WINDOW].tick == (Sint64)weHave) {
+    weHave++;
+  }
+
+  CheckHashes();
+}
+
+void RLockstep::SendHello() {
+  RPacketWriter writer;
+
+  BeginPacket(&writer, PACKET_HELLO);
+  WriteByte(&writer, NET_PROTOCOL_VERSION);
+  WriteByte(&writer, SIM_FIXED_POINT);
+  WriteFixed(&writer, waveHash, 8);
+
+  SendPacket(writer.data, writer.size);
+}
+
+void RLockstep::SendWelcome(const RNetAddress &to) {
+  RPacketWriter writer;
+
+  BeginPacket(&writer, PACKET_WELCOME);
+  WriteFixed(&writer, seed, 4);
+  WriteByte(&writer, inputDelay);
+  WriteFixed(&writer, waveHash, 8);
+  WriteByte(&writer, towerPolicy);
+
+  // the float's bits, so both sides have exactly the same one
+  Uint32 intervalBits = 0;
+  memcpy(&intervalBits, &retargetInterval, sizeof(intervalBits));
+  WriteFixed(&writer, intervalBits, 4);
+
+  SendPacket(to, writer.data, writer.size);
+}
+
+void RLockstep::SendInput() {
+  RPacketWriter writer;
+
+  BeginPacket(&writer, PACKET_INPUT);
+  WriteVarint(&writer, weHave);
+  WriteVarint(&writer, lastLocalHash.tick + 1);
+  WriteFixed(&writer, lastLocalHash.hash, 8);
+  WriteVarint(&writer, peerHas);
+
+  int countAt = writer.size;
+  WriteByte(&writer, 0);
+
+  std::vector<RNetFrame> &ours = frames[GetLocalPeer()];
+
+  // everything they haven't acknowledged, as much as fits
+  int nFrames = 0;
+
+  for (Uint64 tick = peerHas; tick < nextLocal && nFrames < 255; ++tick) {
+    RNetFrame *frame = &ours[tick % NET_FRAME_WINDOW];
+
+    int frameAt = writer.size;
+
+    WriteByte(&writer, frame->commands.size());
+
+    for (int i = 0; i < frame->commands.size(); ++i) {
+      RCommand *command = &frame->commands[i];
+
+      WriteByte(&writer, command->type);
+      WriteVarint(&writer, ZigZag(command->a));
+      WriteVarint(&writer, ZigZag(command->b));
+    }
+
+    if (writer.full) {
+      writer.size = frameAt;
+      break;
+    }
+
+    nFrames++;
+  }
+
+  writer.data[countAt] = nFrames;
+
+  SendPacket(writer.data, writer.size);
+}
+
+void RLockstep::SendPacket(const Uint8 *data, int size) {
+  SendPacket(peer, data, size);
+}
+
+void RLockstep::SendPacket(const RNetAddress &to, const Uint8 *data,
+                           int size) {
+  if (socket.Send(to, data, size)) {
+    stats.packetsSent++;
+    stats.bytesSent += size;
+  }
+
+  lastSent = NetMilliseconds();
+}
@@ -0,0 +1,265 @@
+#include "RMapRenderer.hpp"
+
+#include "RMemory.hpp"
+#include <SDL_render.h>
+#include <stdio.h>
+
+RMapRenderer::RMapRenderer() {
+  map = NULL;
+
+  chunkTiles = 8;
+  nChunksX = 0;
+  nChunksY = 0;
+
+  bakeScale = 1;
+
+  // 16 full 8x8 chunks of 128px tiles
+  budget = 64 * 1024 * 1024;
+  cachedBytes = 0;
+  cachedChunks = 0;
+
+  frame = 0;
+}
+
+RMapRenderer::~RMapRenderer() { Invalidate(); }
+
+void RMapRenderer::SetMap(RTileMap *map) {
+  RMemScope scope(MEM_MAP);
+
+  Invalidate();
+
+  this->map = map;
+
+  nChunksX = (map->GetGridWidth() + chunkTiles - 1) / chunkTiles;
+  nChunksY = (map->GetGridHeight() + chunkTiles - 1) / chunkTiles;
+
+  RMapChunk empty = {NULL, 0, 0};
+  chunks.assign(nChunksX * nChunksY, empty);
+}
+
+void RMapRenderer::SetChunkTiles(int chunkTiles) {
+  this->chunkTiles = chunkTiles;
+
+  if (map != NULL) {
+    SetMap(map);
+  }
+}
+
+void RMapRenderer::SetBudget(int bytes) { budget = bytes; }
+
+void RMapRenderer::SetBakeScale(float bakeScale) {
+  Invalidate();
+
+  this->bakeScale = bakeScale;
+}
+
+void RMapRenderer::Prepare(SDL_Renderer *renderer, RCamera *camera) {
+  if (map == NULL) {
+    return;
+  }
+
+  frame++;
+
+  int minX, minY, maxX, maxY;
+  GetVisibleChunks(camera, &minX, &minY, &maxX, &maxY);
+
+  // mark everything visible first, so baking one can't evict another
+  for (int y = minY; y <= maxY; ++y) {
+    for (int x = minX; x <= maxX; ++x) {
+      chunks[y * nChunksX + x].lastSeen = frame;
+    }
+  }
+
+  for (int y = minY; y <= maxY; ++y) {
+    for (int x = minX; x <= maxX; ++x) {
+      if (chunks[y * nChunksX + x].texture == NULL) {
+        Bake(renderer, x, y);
+      }
+    }
+  }
+}
+
+void RMapRenderer::Render(SDL_Renderer *renderer, RCamera *camera) {
+  if (map == NULL) {
+    return;
+  }
+
+  int minX, minY, maxX, maxY;
+  GetVisibleChunks(camera, &minX, &minY, &maxX, &maxY);
+
+  for (int y = minY; y <= maxY; ++y) {
+    for (int x = minX; x <= maxX; ++x) {
+      RMapChunk *chunk = &chunks[y * nChunksX + x];
+
+      if (chunk->texture == NULL) {
+        RenderTiles(renderer, camera, x, y);
+        continue;
+      }
+
+      SDL_Rect dest = GetChunkRect(x, y);
+      camera->WorldToView(dest.x, dest.y, &dest.x, &dest.y);
+
+      SDL_RenderCopy(renderer, chunk->texture, NULL, &dest);
+    }
+  }
+}
+
+void RMapRenderer::Invalidate() {
+  for (int i = 0; i < chunks.size(); ++i) {
+    if (chunks[i].texture != NULL) {
+      SDL_DestroyTexture(chunks[i].texture);
+      chunks[i].texture = NULL;
+    }
+  }
+
+  RMemory::TrackGpu(MEM_MAP, -cachedBytes);
+
+  cachedBytes = 0;
+  cachedChunks = 0;
+}
+
+int RMapRenderer::GetCachedChunks() { return cachedChunks; }
+
+int RMapRenderer::GetCachedBytes() { return cachedBytes; }
+
+void RMapRenderer::GetVisibleChunks(RCamera *camera, int *minX, int *minY,
+                                    int *maxX, int *maxY) {
+  SDL_Rect view = camera->GetView();
+
+  int chunkSize = chunkTiles * map->GetTileSize();
+
+  *minX = SDL_max(0, view.x / chunkSize);
+  *minY = SDL_max(0, view.y / chunkSize);
+  *maxX = SDL_min(nChunksX - 1, (view.x + view.w - 1) / chunkSize);
+  *maxY = SDL_min(nChunksY - 1, (view.y + view.h - 1) / chunkSize);
+}
+
+SDL_Rect RMapRenderer::GetChunkRect(int chunkX, int chunkY) {
+  int tileSize = map->GetTileSize();
+
+  // edge chunks only cover what's left of the map
+  int tilesX = SDL_min(chunkTiles, map->GetGridWidth() - chunkX * chunkTiles);
+  int tilesY = SDL_min(chunkTiles, map->GetGridHeight() - chunkY * chunkTiles);
+
+  SDL_Rect rect = {chunkX * chunkTiles * tileSize,
+                   chunkY * chunkTiles * tileSize, tilesX * tileSize,
+                   tilesY * tileSize};
+
+  return rect;
+}
+
+bool RMapRenderer::Bake(SDL_Renderer *renderer, int chunkX, int chunkY) {
+  if (!SDL_RenderTargetSupported(renderer)) {
+    return false;
+  }
+
+  SDL_Rect rect = GetChunkRect(chunkX, chunkY);
+
+  int width = SDL_ceilf(rect.w * bakeScale);
+  int height = SDL_ceilf(rect.h * bakeScale);
+  int bytes = width * height * 4;
+
+  MakeRoom(bytes);
+
+  SDL_Texture *texture =
+      SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
+                        SDL_TEXTUREACCESS_TARGET, width, height);
+
+  if (texture == NULL) {
+    printf("Could not make a map chunk: %s\n", SDL_GetError());
+    return false;
+  }
+
+  // the map is opaque; no point blending it
+  SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_NONE);
+
+  SDL_Texture *oldTarget = SDL_GetRenderTarget(renderer);
+  SDL_SetRenderTarget(renderer, texture);
+
+  // switching targets resets the scale; tiles are drawn in map px
+  SDL_RenderSetScale(renderer, bakeScale, bakeScale);
+
+  SDL_Color background = map->GetBackgroundColor();
+
+  SDL_SetRenderDrawColor(renderer, background.r, background.g, background.b,
+                         255);
+  SDL_RenderClear(renderer);
+
+  int tileSize = map->GetTileSize();
+  int firstX = chunkX * chunkTiles;
+  int firstY = chunkY * chunkTiles;
+
+  for (int layer = 0; layer < map->GetLayerCount(); ++layer) {
+    for (int y = 0; y < rect.h / tileSize; ++y) {
+      for (int x = 0; x < rect.w / tileSize; ++x) {
+        map->RenderTile(renderer, map->GetTile(layer, firstX + x, firstY + y),
+                        x * tileSize, y * tileSize);
+      }
+    }
+  }
+
+  SDL_SetRenderTarget(renderer, oldTarget);
+  SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+
+  RMapChunk *chunk = &chunks[chunkY * nChunksX + chunkX];
+
+  chunk->texture = texture;
+  chunk->bytes = bytes;
+
+  cachedBytes += bytes;
+  RMemory::TrackGpu(MEM_MAP, bytes);
+  cachedChunks++;
+
+  return true;
+}
+
+void RMapRenderer::MakeRoom(int bytes) {
+  while (cachedBytes + bytes > budget) {
+    RMapChunk *oldest = NULL;
+
+    for (int i = 0; i < chunks.size(); ++i) {
+      RMapChunk *chunk = &chunks[i];
+
+      if (chunk->texture == NULL || chunk->lastSeen == frame) {
+        continue;
+      }
+
+      if (oldest == NULL || chunk->lastSeen < oldest->lastSeen) {
+        oldest = chunk;
+      }
+    }
+
+    if (oldest == NULL) {
+      return;
+    }
+
+    SDL_DestroyTexture(oldest->texture);
+    oldest->texture = NULL;
+
+    cachedBytes -= oldest->bytes;
+    RMemory::TrackGpu(MEM_MAP, -oldest->bytes);
+    cachedChunks--;
+  }
+}
+
+void RMapRenderer::RenderTiles(SDL_Renderer *renderer, RCamera *camera,
+                               int chunkX, int chunkY) {
+  SDL_Rect rect = GetChunkRect(chunkX, chunkY);
+
+  int tileSize = map->GetTileSize();
+  int firstX = chunkX * chunkTiles;
+  int firstY = chunkY * chunkTiles;
+
+  for (int layer = 0; layer < map->GetLayerCount(); ++layer) {
+    for (int y = 0; y < rect.h / tileSize; ++y) {
+      for (int x = 0; x < rect.w / tileSize; ++x) {
+        int viewX, viewY;
+        camera->WorldToView(rect.x + x * tileSize, rect.y + y * tileSize,
+                            &viewX, &viewY);
+
+        map->RenderTile(renderer, map->GetTile(layer, firstX + x, firstY + y),
+                        viewX, viewY);
+      }
+    }
+  }
+}
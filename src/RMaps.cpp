@@ -0,0 +1,22 @@
+#include "RMaps.hpp"
+
+#include "RWorld.hpp"
+
+// corners of the road in tiles (e.g. 10, 7 is 10 tiles across, 7 down)
+const int MAP_0_PATH_LENGTH = 13;
+const int MAP_0_TILES[MAP_0_PATH_LENGTH][2] = {
+    {0, 5}, {8, 5},  {8, 2},   {6, 2},   {6, 10},  {4, 10}, {4, 7},
+    {9, 7}, {9, 6}, {11, 6}, {11, 10}, {8, 10}, {8, 12}};
+
+void MakeMap0Path(RPath *path) {
+  SDL_Point points[MAP_0_PATH_LENGTH];
+
+  for (int i = 0; i < MAP_0_PATH_LENGTH; ++i) {
+    // scaled up to level pixels, then back half a tile so each point is the
+    // center of its tile; it's easier to position entities that way
+    points[i].x = MAP_0_TILES[i][0] * TILE_WIDTH - TILE_WIDTH / 2;
+    points[i].y = MAP_0_TILES[i][1] * TILE_HEIGHT - TILE_HEIGHT / 2;
+  }
+
+  path->SetPoints(points, MAP_0_PATH_LENGTH);
+}
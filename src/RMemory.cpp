@@ -0,0 +1,225 @@
+#include "RMemory.hpp"
+
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+
+// one set per tag plus a running total; all static, so they're zeroed before
+// anything can allocate
+typedef struct RMemCounters {
+  std::atomic<Uint64> allocs;
+  std::atomic<Uint64> frees;
+  std::atomic<Sint64> bytes;
+  std::atomic<Sint64> peakBytes;
+} RMemCounters;
+
+static RMemCounters heapCounters[MEM_TAG_COUNT];
+static RMemCounters heapTotal;
+
+static RMemCounters gpuCounters[MEM_TAG_COUNT];
+static RMemCounters gpuTotal;
+
+static thread_local RMemTag currentTag = MEM_OTHER;
+static thread_local Uint64 threadAllocs = 0;
+
+static const char *TAG_NAMES[MEM_TAG_COUNT] = {
+    "other", "world", "entity", "projectile", "texture", "map", "particle"};
+
+static void Count(RMemCounters *counters, Sint64 bytes) {
+  if (bytes >= 0) {
+    counters->allocs.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    counters->frees.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  Sint64 now =
+      counters->bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+  Sint64 peak = counters->peakBytes.load(std::memory_order_relaxed);
+
+  while (now > peak && !counters->peakBytes.compare_exchange_weak(
+                           peak, now, std::memory_order_relaxed)) {
+  }
+}
+
+static RMemStats Read(RMemCounters *counters) {
+  RMemStats stats;
+
+  stats.allocs = counters->allocs.load(std::memory_order_relaxed);
+  stats.frees = counters->frees.load(std::memory_order_relaxed);
+  stats.bytes = counters->bytes.load(std::memory_order_relaxed);
+  stats.peakBytes = counters->peakBytes.load(std::memory_order_relaxed);
+
+  return stats;
+}
+
+static bool ValidTag(RMemTag tag) { return tag >= 0 && tag < MEM_TAG_COUNT; }
+
+bool RMemory::IsTrackingHeap() {
+#ifdef R_TRACK_ALLOCATIONS
+  return true;
+#else
+  return false;
+#endif
+}
+
+const char *RMemory::GetTagName(RMemTag tag) {
+  return ValidTag(tag) ? TAG_NAMES[tag] : "?";
+}
+
+RMemStats RMemory::GetHeapStats(RMemTag tag) {
+  return Read(&heapCounters[ValidTag(tag) ? tag : MEM_OTHER]);
+}
+
+RMemStats RMemory::GetGpuStats(RMemTag tag) {
+  return Read(&gpuCounters[ValidTag(tag) ? tag : MEM_OTHER]);
+}
+
+RMemStats RMemory::GetHeapTotal() { return Read(&heapTotal); }
+
+RMemStats RMemory::GetGpuTotal() { return Read(&gpuTotal); }
+
+void RMemory::Track(RMemTag tag, Sint64 bytes) {
+  Count(&heapCounters[ValidTag(tag) ? tag : MEM_OTHER], bytes);
+  Count(&heapTotal, bytes);
+}
+
+void RMemory::TrackGpu(RMemTag tag, Sint64 bytes) {
+  Count(&gpuCounters[ValidTag(tag) ? tag : MEM_OTHER], bytes);
+  Count(&gpuTotal, bytes);
+}
+
+static void ResetPeak(RMemCounters *counters) {
+  counters->peakBytes.store(counters->bytes.load(std::memory_order_relaxed),
+                            std::memory_order_relaxed);
+}
+
+void RMemory::ResetPeaks() {
+  for (int i = 0; i < MEM_TAG_COUNT; ++i) {
+    ResetPeak(&heapCounters[i]);
+    ResetPeak(&gpuCounters[i]);
+  }
+
+  ResetPeak(&heapTotal);
+  ResetPeak(&gpuTotal);
+}
+
+void RMemory::Dump(FILE *out) {
+  fprintf(out, "memory (heap tracking %s):\n",
+          IsTrackingHeap() ? "on" : "off");
+
+  for (int i = 0; i < MEM_TAG_COUNT; ++i) {
+    RMemStats heap = GetHeapStats((RMemTag)i);
+    RMemStats gpu = GetGpuStats((RMemTag)i);
+
+    fprintf(out,
+            "  %-10s heap %10lld B (peak %10lld B, %llu allocs, %llu frees)"
+            "  gpu %10lld B (peak %10lld B)\n",
+            TAG_NAMES[i], (long long)heap.bytes, (long long)heap.peakBytes,
+            (unsigned long long)heap.allocs, (unsigned long long)heap.frees,
+            (long long)gpu.bytes, (long long)gpu.peakBytes);
+  }
+
+  RMemStats heap = GetHeapTotal();
+  RMemStats gpu = GetGpuTotal();
+
+  fprintf(out,
+          "  %-10s heap %10lld B (peak %10lld B, %llu allocs, %llu frees)"
+          "  gpu %10lld B (peak %10lld B)\n",
+          "total", (long long)heap.bytes, (long long)heap.peakBytes,
+          (unsigned long long)heap.allocs, (unsigned long long)heap.frees,
+          (long long)gpu.bytes, (long long)gpu.peakBytes);
+}
+
+Uint64 RMemory::GetThreadAllocs() { return threadAllocs; }
+
+RMemTag RMemory::GetTag() { return currentTag; }
+
+void RMemory::SetTag(RMemTag tag) {
+  currentTag = ValidTag(tag) ? tag : MEM_OTHER;
+}
+
+RMemScope::RMemScope(RMemTag tag) {
+  previous = RMemory::GetTag();
+  RMemory::SetTag(tag);
+}
+
+RMemScope::~RMemScope() { RMemory::SetTag(previous); }
+
+#ifdef R_TRACK_ALLOCATIONS
+
+// every block carries its size and tag in front of it, so a free is charged
+// to whoever allocated, whatever thread it happens on
+// 16 keeps what we hand out aligned like malloc's
+typedef struct RAllocHeader {
+  Uint64 size;
+  Uint64 tag;
+} RAllocHeader;
+
+static_assert(sizeof(RAllocHeader) == 16, "header would misalign blocks");
+
+static void *TrackedAlloc(size_t size) {
+  RAllocHeader *header = (RAllocHeader *)malloc(sizeof(RAllocHeader) + size);
+
+  if (header == NULL) {
+    return NULL;
+  }
+
+  header->size = size;
+  header->tag = currentTag;
+
+  threadAllocs++;
+
+  RMemory::Track(currentTag, size);
+
+  return header + 1;
+}
+
+static void TrackedFree(void *block) {
+  if (block == NULL) {
+    return;
+  }
+
+  RAllocHeader *header = (RAllocHeader *)block - 1;
+
+  RMemory::Track((RMemTag)header->tag, -(Sint64)header->size);
+
+  free(header);
+}
+
+void *operator new(size_t size) {
+  void *block = TrackedAlloc(size);
+
+  if (block == NULL) {
+    throw std::bad_alloc();
+  }
+
+  return block;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  return TrackedAlloc(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+  return TrackedAlloc(size);
+}
+
+void operator delete(void *block) noexcept { TrackedFree(block); }
+
+void operator delete[](void *block) noexcept { TrackedFree(block); }
+
+void operator delete(void *block, size_t) noexcept { TrackedFree(block); }
+
+void operator delete[](void *block, size_t) noexcept { TrackedFree(block); }
+
+void operator delete(void *block, const std::nothrow_t &) noexcept {
+  TrackedFree(block);
+}
+
+void operator delete[](void *block, const std::nothrow_t &) noexcept {
+  TrackedFree(block);
+}
+
+#endif
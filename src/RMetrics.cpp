@@ -0,0 +1,324 @@
+#include "RMetrics.hpp"
+
+#include <chrono>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+const char *UNIX_PREFIX = "unix:";
+
+// what goes out for each window, as (label, percentile)
+const int N_QUANTILES = 4;
+const double QUANTILES[N_QUANTILES] = {50, 90, 99, 99.9};
+const char *QUANTILE_LABELS[N_QUANTILES] = {"0.5", "0.9", "0.99", "0.999"};
+const char *QUANTILE_KEYS[N_QUANTILES] = {"p50", "p90", "p99", "p999"};
+
+static void Append(std::string *out, const char *format, ...) {
+  char line[512];
+
+  va_list args;
+  va_start(args, format);
+  vsnprintf(line, sizeof(line), format, args);
+  va_end(args);
+
+  out->append(line);
+}
+
+RMetrics::RMetrics() {
+  toSocket = false;
+  format = MF_PROMETHEUS;
+  interval = 10;
+  failing = false;
+  running = false;
+}
+
+RMetrics::~RMetrics() { Stop(); }
+
+int RMetrics::Add(const char *name, const char *help, Uint64 maxValue,
+                  double scale) {
+  std::lock_guard<std::mutex> lock(metricsMutex);
+
+  RMetric metric;
+
+  metric.name = name;
+  metric.help = help;
+  metric.scale = scale;
+  metric.window = RHistogram(maxValue);
+  metric.totalCount = 0;
+  metric.totalSum = 0;
+
+  metrics.push_back(metric);
+
+  return metrics.size() - 1;
+}
+
+void RMetrics::Record(int metric, Uint64 value) {
+  std::lock_guard<std::mutex> lock(metricsMutex);
+
+  if (metric < 0 || metric >= metrics.size()) {
+    return;
+  }
+
+  RMetric *m = &metrics[metric];
+
+  m->window.Record(value);
+  m->totalCount++;
+  m->totalSum += value;
+}
+
+bool RMetrics::Start(const char *path, RMetricsFormat format,
+                     float interval) {
+  Stop();
+
+  this->path = path;
+  this->format = format;
+  this->interval = interval > 0 ? interval : 10;
+
+  toSocket = strncmp(path, UNIX_PREFIX, strlen(UNIX_PREFIX)) == 0;
+
+  if (toSocket) {
+#ifdef _WIN32
+    printf("Unix sockets aren't supported here!\n");
+    return false;
+#else
+    this->path = path + strlen(UNIX_PREFIX);
+#endif
+  }
+
+  failing = false;
+  running = true;
+
+  exporter = std::thread(&RMetrics::ExportLoop, this);
+
+  return true;
+}
+
+void RMetrics::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(runMutex);
+
+    if (!running) {
+      return;
+    }
+
+    running = false;
+  }
+
+  stopped.notify_all();
+
+  exporter.join();
+
+  // whatever came in since the last one
+  Export();
+}
+
+void RMetrics::ExportLoop() {
+  auto wait = std::chrono::duration<float>(interval);
+
+  std::unique_lock<std::mutex> lock(runMutex);
+
+  while (running) {
+    if (stopped.wait_for(lock, wait, [this] { return !running; })) {
+      break;
+    }
+
+    lock.unlock();
+    Export();
+    lock.lock();
+  }
+}
+
+bool RMetrics::Export() {
+  std::string text;
+  Format(format, &text);
+
+  bool written = toSocket ? WriteSocket(text) : WriteFile(text);
+
+  if (!written && !failing) {
+    printf("Could not export metrics to %s!\n", path.c_str());
+  }
+
+  failing = !written;
+
+  return written;
+}
+
+void RMetrics::Format(RMetricsFormat format, std::string *out) {
+  std::vector<RMetric> snapshot;
+
+  {
+    std::lock_guard<std::mutex> lock(metricsMutex);
+
+    snapshot = metrics;
+
+    for (int i = 0; i < metrics.size(); ++i) {
+      metrics[i].window.Reset();
+    }
+  }
+
+  out->clear();
+
+  if (format == MF_JSON_LINES) {
+    Append(out, "{\"time\":%lld", (long long)time(NULL));
+  }
+
+  for (int i = 0; i < snapshot.size(); ++i) {
+    RMetric *m = &snapshot[i];
+    RHistogram *window = &m->window;
+
+    bool empty = window->GetCount() == 0;
+
+    if (format == MF_PROMETHEUS) {
+      const char *name = m->name.c_str();
+
+      Append(out, "# HELP %s %s\n", name, m->help.c_str());
+      Append(out, "# TYPE %s summary\n", name);
+
+      for (int q = 0; q < N_QUANTILES; ++q) {
+        const char *label = QUANTILE_LABELS[q];
+
+        if (empty) {
+          Append(out, "%s{quantile=\"%s\"} NaN\n", name, label);
+        } else {
+          Append(out, "%s{quantile=\"%s\"} %.9g\n", name, label,
+                 window->GetPercentile(QUANTILES[q]) * m->scale);
+        }
+      }
+
+      Append(out, "%s_sum %.9g\n", name, m->totalSum * m->scale);
+      Append(out, "%s_count %llu\n", name,
+             (unsigned long long)m->totalCount);
+
+      // worst case since the last export; summaries have nowhere for it
+      Append(out, "# TYPE %s_max gauge\n", name);
+      if (empty) {
+        Append(out, "%s_max NaN\n", name);
+      } else {
+        Append(out, "%s_max %.9g\n", name, window->GetMax() * m->scale);
+      }
+    }
+
+    else {
+      Append(out, ",\"%s\":{\"count\":%llu,\"sum\":%.9g,\"window\":%llu",
+             m->name.c_str(), (unsigned long long)m->totalCount,
+             m->totalSum * m->scale,
+             (unsigned long long)window->GetCount());
+
+      if (!empty) {
+        for (int q = 0; q < N_QUANTILES; ++q) {
+          Append(out, ",\"%s\":%.9g", QUANTILE_KEYS[q],
+                 window->GetPercentile(QUANTILES[q]) * m->scale);
+        }
+
+        Append(out, ",\"max\":%.9g", window->GetMax() * m->scale);
+      }
+
+      out->append("}");
+    }
+  }
+
+  if (format == MF_JSON_LINES) {
+    out->append("}\n");
+  }
+}
+
+bool RMetrics::WriteFile(const std::string &text) {
+  // json lines just pile up; whoever reads them rotates the file
+  if (format == MF_JSON_LINES) {
+    FILE *file = fopen(path.c_str(), "ab");
+
+    if (file == NULL) {
+      return false;
+    }
+
+    bool written = fwrite(text.data(), 1, text.size(), file) == text.size();
+
+    return fclose(file) == 0 && written;
+  }
+
+  // a scrape halfway through a write would see a truncated file, so write
+  // next to it and swap it in
+  std::string tmpPath = path + ".tmp";
+
+  FILE *file = fopen(tmpPath.c_str(), "wb");
+
+  if (file == NULL) {
+    return false;
+  }
+
+  bool written = fwrite(text.data(), 1, text.size(), file) == text.size();
+
+  if (fclose(file) != 0 || !written) {
+    remove(tmpPath.c_str());
+    return false;
+  }
+
+  if (rename(tmpPath.c_str(), path.c_str()) != 0) {
+    remove(tmpPath.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+bool RMetrics::WriteSocket(const std::string &text) {
+#ifdef _WIN32
+  return false;
+#else
+  sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+
+  address.sun_family = AF_UNIX;
+
+  if (path.size() >= sizeof(address.sun_path)) {
+    return false;
+  }
+
+  memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+  if (fd < 0) {
+    return false;
+  }
+
+  if (connect(fd, (sockaddr *)&address, sizeof(address)) != 0) {
+    close(fd);
+    return false;
+  }
+
+  // a reader that hung up shouldn't take the game down with a SIGPIPE
+  int flags = 0;
+
+#ifdef MSG_NOSIGNAL
+  flags = MSG_NOSIGNAL;
+#elif defined(SO_NOSIGPIPE)
+  int on = 1;
+  setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+  size_t sent = 0;
+
+  while (sent < text.size()) {
+    ssize_t n = send(fd, text.data() + sent, text.size() - sent, flags);
+
+    if (n <= 0) {
+      close(fd);
+      return false;
+    }
+
+    sent += n;
+  }
+
+  close(fd);
+
+  return true;
+#endif
+}
@@ -0,0 +1,312 @@
+#include "RNet.hpp"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef int socklen_t;
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+const Sint64 NO_SOCKET = -1;
+
+// how long the relay naps when nothing's due; well under a sim tick
+const int RELAY_IDLE_MS = 1;
+
+static bool StartSockets() {
+#ifdef _WIN32
+  static bool started = false;
+
+  if (!started) {
+    WSADATA data;
+    started = WSAStartup(MAKEWORD(2, 2), &data) == 0;
+  }
+
+  return started;
+#else
+  return true;
+#endif
+}
+
+static sockaddr_in ToSockAddr(const RNetAddress &address) {
+  sockaddr_in out;
+  memset(&out, 0, sizeof(out));
+
+  out.sin_family = AF_INET;
+  out.sin_addr.s_addr = htonl(address.host);
+  out.sin_port = htons(address.port);
+
+  return out;
+}
+
+bool ResolveAddress(const char *text, RNetAddress *out) {
+  if (!StartSockets()) {
+    return false;
+  }
+
+  const char *colon = strrchr(text, ':');
+
+  if (colon == NULL || colon == text) {
+    printf("Expected host:port, got %s!\n", text);
+    return false;
+  }
+
+  std::string name(text, colon - text);
+  int port = atoi(colon + 1);
+
+  if (port <= 0 || port > 65535) {
+    printf("Bad port in %s!\n", text);
+    return false;
+  }
+
+  addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+
+  addrinfo *found = NULL;
+
+  if (getaddrinfo(name.c_str(), NULL, &hints, &found) != 0 || found == NULL) {
+    printf("Could not resolve %s!\n", name.c_str());
+    return false;
+  }
+
+  out->host = ntohl(((sockaddr_in *)found->ai_addr)->sin_addr.s_addr);
+  out->port = port;
+
+  freeaddrinfo(found);
+
+  return true;
+}
+
+bool SameAddress(const RNetAddress &a, const RNetAddress &b) {
+  return a.host == b.host && a.port == b.port;
+}
+
+Uint64 NetMilliseconds() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+RUdpSocket::RUdpSocket() { fd = NO_SOCKET; }
+
+RUdpSocket::~RUdpSocket() { Close(); }
+
+bool RUdpSocket::Open(int port) {
+  Close();
+
+  if (!StartSockets()) {
+    printf("Could not start up sockets!\n");
+    return false;
+  }
+
+  Sint64 s = socket(AF_INET, SOCK_DGRAM, 0);
+
+  if (s < 0) {
+    printf("Could not create a udp socket!\n");
+    return false;
+  }
+
+  fd = s;
+
+  sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(port);
+
+  if (bind(fd, (sockaddr *)&address, sizeof(address)) != 0) {
+    printf("Could not bind udp port %d!\n", port);
+    Close();
+    return false;
+  }
+
+  // everything polls; nothing is allowed to sit waiting on the network
+#ifdef _WIN32
+  u_long on = 1;
+  bool nonBlocking = ioctlsocket(fd, FIONBIO, &on) == 0;
+#else
+  bool nonBlocking = fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) == 0;
+#endif
+
+  if (!nonBlocking) {
+    printf("Could not make the udp socket non-blocking!\n");
+    Close();
+    return false;
+  }
+
+  return true;
+}
+
+void RUdpSocket::Close() {
+  if (fd == NO_SOCKET) {
+    return;
+  }
+
+#ifdef _WIN32
+  closesocket(fd);
+#else
+  close(fd);
+#endif
+
+  fd = NO_SOCKET;
+}
+
+bool RUdpSocket::IsOpen() { return fd != NO_SOCKET; }
+
+int RUdpSocket::GetPort() {
+  if (fd == NO_SOCKET) {
+    return 0;
+  }
+
+  sockaddr_in address;
+  socklen_t size = sizeof(address);
+
+  if (getsockname(fd, (sockaddr *)&address, &size) != 0) {
+    return 0;
+  }
+
+  return ntohs(address.sin_port);
+}
+
+bool RUdpSocket::Send(const RNetAddress &to, const Uint8 *data, int size) {
+  if (fd == NO_SOCKET) {
+    return false;
+  }
+
+  sockaddr_in address = ToSockAddr(to);
+
+  return sendto(fd, (const char *)data, size, 0, (sockaddr *)&address,
+                sizeof(address)) == size;
+}
+
+int RUdpSocket::Receive(RNetAddress *from, Uint8 *data, int capacity) {
+  if (fd == NO_SOCKET) {
+    return -1;
+  }
+
+  sockaddr_in address;
+  socklen_t size = sizeof(address);
+
+  int n = recvfrom(fd, (char *)data, capacity, 0, (sockaddr *)&address, &size);
+
+  if (n < 0) {
+    return -1;
+  }
+
+  from->host = ntohl(address.sin_addr.s_addr);
+  from->port = ntohs(address.sin_port);
+
+  return n;
+}
+
+RNetRelay::RNetRelay() {
+  host.host = 0;
+  host.port = 0;
+  guest = host;
+  hasGuest = false;
+
+  latency = 0;
+  jitter = 0;
+  loss = 0;
+
+  forwarded = 0;
+  dropped = 0;
+}
+
+bool RNetRelay::Open(int port, const RNetAddress &host) {
+  this->host = host;
+  hasGuest = false;
+
+  return socket.Open(port);
+}
+
+void RNetRelay::SetConditions(int latency, int jitter, float loss) {
+  this->latency = latency > 0 ? latency : 0;
+  this->jitter = jitter > 0 ? jitter : 0;
+  this->loss = loss;
+}
+
+void RNetRelay::Update() {
+  RDelayedPacket packet;
+  RNetAddress from;
+
+  Uint64 now = NetMilliseconds();
+
+  while ((packet.size = socket.Receive(&from, packet.data, NET_MAX_PACKET)) >=
+         0) {
+    if (SameAddress(from, host)) {
+      if (!hasGuest) {
+        continue;
+      }
+
+      packet.to = guest;
+    } else {
+      guest = from;
+      hasGuest = true;
+
+      packet.to = host;
+    }
+
+    if (random.Float() * 100 < loss) {
+      dropped++;
+      continue;
+    }
+
+    int delay = latency;
+
+    if (jitter > 0) {
+      delay += random.Range(jitter * 2 + 1) - jitter;
+    }
+
+    packet.due = now + (delay > 0 ? delay : 0);
+
+    queue.push_back(packet);
+  }
+
+  // send whatever's come due, keeping the rest in the order they came
+  int kept = 0;
+
+  for (int i = 0; i < queue.size(); ++i) {
+    if (queue[i].due <= now) {
+      socket.Send(queue[i].to, queue[i].data, queue[i].size);
+      forwarded++;
+    } else {
+      if (kept != i) {
+        queue[kept] = queue[i];
+      }
+
+      kept++;
+    }
+  }
+
+  queue.resize(kept);
+}
+
+void RNetRelay::Run(const std::atomic<bool> *stop) {
+  while (!*stop) {
+    Update();
+    std::this_thread::sleep_for(std::chrono::milliseconds(RELAY_IDLE_MS));
+  }
+}
+
+int RNetRelay::GetPort() { return socket.GetPort(); }
+
+Uint64 RNetRelay::GetForwarded() { return forwarded; }
+
+Uint64 RNetRelay::GetDropped() { return dropped; }
@@ -0,0 +1,205 @@
+#include "RParticles.hpp"
+
+#include "RMemory.hpp"
+#include <SDL_render.h>
+
+const double PI = 3.14159265358979323846;
+
+// sparks slow down this much per second
+const float SPARK_DRAG = 0.05;
+
+// sparks per burst, on top of the blast itself
+const int HIT_SPARKS = 3;
+const int EXPLOSION_SPARKS = 10;
+
+RParticleSystem::RParticleSystem(int capacity) {
+  RMemScope scope(MEM_PARTICLE);
+
+  this->capacity = capacity;
+  count = 0;
+
+  posX.resize(capacity);
+  posY.resize(capacity);
+  velX.resize(capacity);
+  velY.resize(capacity);
+  age.resize(capacity);
+  life.resize(capacity);
+  startSize.resize(capacity);
+  endSize.resize(capacity);
+
+  sheet = NULL;
+  frameWidth = 1;
+  frameHeight = 1;
+  nFrames = 1;
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+  vertices.resize(capacity * 4);
+  indices.resize(capacity * 6);
+
+  for (int i = 0; i < capacity; ++i) {
+    int v = i * 4;
+    int *quad = &indices[i * 6];
+
+    // two triangles: top left, top right, bottom right / bottom left
+    quad[0] = v;
+    quad[1] = v + 1;
+    quad[2] = v + 2;
+    quad[3] = v;
+    quad[4] = v + 2;
+    quad[5] = v + 3;
+  }
+#endif
+}
+
+void RParticleSystem::SetSheet(RTexture *sheet, int frameWidth,
+                               int frameHeight, int nFrames) {
+  this->sheet = sheet;
+  this->frameWidth = frameWidth;
+  this->frameHeight = frameHeight;
+  this->nFrames = nFrames;
+}
+
+void RParticleSystem::Spawn(float x, float y, float vx, float vy, float life,
+                            float startSize, float endSize) {
+  if (count == capacity) {
+    return;
+  }
+
+  int i = count++;
+
+  posX[i] = x;
+  posY[i] = y;
+  velX[i] = vx;
+  velY[i] = vy;
+  age[i] = 0;
+  this->life[i] = life;
+  this->startSize[i] = startSize;
+  this->endSize[i] = endSize;
+}
+
+void RParticleSystem::SpawnEffects(std::vector<REffect> &effects) {
+  for (int i = 0; i < effects.size(); ++i) {
+    REffect *effect = &effects[i];
+
+    switch (effect->type) {
+    case FX_HIT:
+      Burst(effect->posX, effect->posY, HIT_SPARKS, 48, 240);
+      break;
+    case FX_EXPLOSION:
+      Burst(effect->posX, effect->posY, EXPLOSION_SPARKS, 160, 360);
+      break;
+    }
+  }
+}
+
+void RParticleSystem::Burst(float x, float y, int nSparks, float size,
+                            float speed) {
+  // the main blast stays put
+  Spawn(x, y, 0, 0, 0.5, size * 0.75f, size);
+
+  // smaller ones fly off it
+  for (int i = 0; i < nSparks; ++i) {
+    float angle = random.Float() * 2 * PI;
+    float v = speed * (0.5f + random.Float());
+
+    Spawn(x, y, SDL_cos(angle) * v, SDL_sin(angle) * v,
+          0.3f + random.Float() * 0.3f, size * 0.3f, size * 0.1f);
+  }
+}
+
+void RParticleSystem::Update(float dt) {
+  float drag = SDL_powf(SPARK_DRAG, dt);
+
+  // walking backwards, whatever gets moved into a dead one's slot has
+  // already been updated, and the live ones stay packed at the front
+  for (int i = count - 1; i >= 0; --i) {
+    age[i] += dt;
+
+    if (age[i] >= life[i]) {
+      int last = --count;
+
+      posX[i] = posX[last];
+      posY[i] = posY[last];
+      velX[i] = velX[last];
+      velY[i] = velY[last];
+      age[i] = age[last];
+      life[i] = life[last];
+      startSize[i] = startSize[last];
+      endSize[i] = endSize[last];
+
+      continue;
+    }
+
+    posX[i] += velX[i] * dt;
+    posY[i] += velY[i] * dt;
+    velX[i] *= drag;
+    velY[i] *= drag;
+  }
+}
+
+void RParticleSystem::Render(SDL_Renderer *renderer, RCamera *camera) {
+  if (sheet == NULL || count == 0) {
+    return;
+  }
+
+  SDL_Rect view = camera->GetView();
+
+  int sheetWidth = sheet->GetWidthUnscaled();
+  int sheetHeight = sheet->GetHeightUnscaled();
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+  int nQuads = 0;
+#endif
+
+  for (int i = 0; i < count; ++i) {
+    float progress = age[i] / life[i];
+    float size = startSize[i] + (endSize[i] - startSize[i]) * progress;
+    float half = size / 2;
+
+    if (posX[i] + half < view.x || posX[i] - half > view.x + view.w ||
+        posY[i] + half < view.y || posY[i] - half > view.y + view.h) {
+      continue;
+    }
+
+    int frame = SDL_min((int)(progress * nFrames), nFrames - 1);
+
+    int x, y;
+    camera->WorldToView(posX[i] - half, posY[i] - half, &x, &y);
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    SDL_Vertex *quad = &vertices[nQuads * 4];
+
+    float u0 = (float)(frame * frameWidth) / sheetWidth;
+    float u1 = (float)((frame + 1) * frameWidth) / sheetWidth;
+    float v1 = (float)frameHeight / sheetHeight;
+
+    // fade out over the back half
+    Uint8 alpha = progress < 0.5f ? 255 : 255 * (1 - progress) * 2;
+    SDL_Color color = {255, 255, 255, alpha};
+
+    quad[0] = {{(float)x, (float)y}, color, {u0, 0}};
+    quad[1] = {{x + size, (float)y}, color, {u1, 0}};
+    quad[2] = {{x + size, y + size}, color, {u1, v1}};
+    quad[3] = {{(float)x, y + size}, color, {u0, v1}};
+
+    nQuads++;
+#else
+    SDL_Rect clip = {frame * frameWidth, 0, frameWidth, frameHeight};
+
+    sheet->Render(renderer, x, y, size, size, &clip);
+#endif
+  }
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+  sheet->RenderGeometry(renderer, vertices.data(), nQuads * 4, indices.data(),
+                        nQuads * 6);
+#endif
+}
+
+int RParticleSystem::GetCount() { return count; }
+
+int RParticleSystem::GetCapacity() { return capacity; }
+
+int RParticleSystem::GetEffectCapacity() {
+  return capacity / (1 + HIT_SPARKS);
+}
@@ -0,0 +1,74 @@
+#include "RPath.hpp"
+
+RPath::RPath() {}
+
+void RPath::SetPoints(SDL_Point *points, int nPoints) {
+  this->points.assign(points, points + nPoints);
+
+  cumulative.assign(nPoints, 0);
+  dirX.assign(nPoints, 0);
+  dirY.assign(nPoints, 0);
+
+  for (int i = 0; i + 1 < nPoints; ++i) {
+    RReal dx = (RReal)(points[i + 1].x - points[i].x);
+    RReal dy = (RReal)(points[i + 1].y - points[i].y);
+    RReal d = RealHypot(dx, dy);
+
+    cumulative[i + 1] = cumulative[i] + d;
+
+    // repeated points make zero length segments; they just get skipped over
+    if (d > 0) {
+      dirX[i] = dx / d;
+      dirY[i] = dy / d;
+    }
+  }
+}
+
+int RPath::GetPointCount() { return points.size(); }
+
+SDL_Point *RPath::GetPoint(int i) { return &points[i]; }
+
+RReal RPath::GetLength() {
+  return cumulative.empty() ? 0 : cumulative.back();
+}
+
+void RPath::GetPosition(RReal distance, int *segment, RReal *x, RReal *y) {
+  int nPoints = points.size();
+
+  if (nPoints == 0) {
+    *x = 0;
+    *y = 0;
+    return;
+  }
+
+  // clamp to the ends
+  if (distance <= 0) {
+    *segment = 0;
+    *x = points[0].x;
+    *y = points[0].y;
+    return;
+  }
+
+  if (distance >= GetLength()) {
+    *segment = nPoints - 1;
+    *x = points[nPoints - 1].x;
+    *y = points[nPoints - 1].y;
+    return;
+  }
+
+  int seg = *segment;
+
+  if (seg < 0 || seg >= nPoints - 1 || distance < cumulative[seg]) {
+    seg = 0;
+  }
+
+  while (seg < nPoints - 2 && distance >= cumulative[seg + 1]) {
+    seg++;
+  }
+
+  RReal along = distance - cumulative[seg];
+
+  *segment = seg;
+  *x = points[seg].x + dirX[seg] * along;
+  *y = points[seg].y + dirY[seg] * along;
+}
@@ -0,0 +1,340 @@
+#include "RProjectiles.hpp"
+
+#include "RMemory.hpp"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// widest vector we use is 8 lanes of 32 bits
+const int LANE_ALIGN = 32;
+const int LANE_COUNT = 8;
+
+// msvc has no aligned_alloc, and what _aligned_malloc hands out has to go
+// back through _aligned_free, so the two always come as a pair
+static void *AlignedAlloc(int bytes) {
+  // aligned_alloc wants the size to be a multiple of the alignment
+  bytes = (bytes + LANE_ALIGN - 1) / LANE_ALIGN * LANE_ALIGN;
+
+  if (bytes <= 0) {
+    bytes = LANE_ALIGN;
+  }
+
+#if defined(_WIN32)
+  return _aligned_malloc(bytes, LANE_ALIGN);
+#else
+  return aligned_alloc(LANE_ALIGN, bytes);
+#endif
+}
+
+static void AlignedFree(void *memory) {
+#if defined(_WIN32)
+  _aligned_free(memory);
+#else
+  free(memory);
+#endif
+}
+
+// what one projectile takes across all the arrays; they don't come from new,
+// so RMemory is told about them by hand
+const int PROJECTILE_BYTES = 4 * sizeof(Sint32) + sizeof(int) +
+                             sizeof(REntityHandle) + sizeof(EntityKind) +
+                             sizeof(Uint8);
+
+template <typename T> static void Grow(T **array, int count, int capacity) {
+  T *grown = (T *)AlignedAlloc(capacity * sizeof(T));
+
+  if (*array != NULL) {
+    memcpy(grown, *array, count * sizeof(T));
+    AlignedFree(*array);
+  }
+
+  *array = grown;
+}
+
+#if !defined(__AVX2__) && defined(__SSE2__)
+// sse2 has no 32 bit multiply; do the even and odd lanes as 64 bit products
+// and keep the low halves, which are the same signed or not
+static __m128i MulLo32(__m128i a, __m128i b) {
+  __m128i even = _mm_mul_epu32(a, b);
+  __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+
+  return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                            _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+#endif
+
+static int IntegrateScalar(Sint32 *posX, Sint32 *posY, const Sint32 *velX,
+                           const Sint32 *velY, Uint8 *dead, int begin,
+                           int end, int width, int height, int steps) {
+  int nOut = 0;
+
+  for (int i = begin; i < end; ++i) {
+    posX[i] += velX[i] * steps;
+    posY[i] += velY[i] * steps;
+
+    bool out = posX[i] < 0 || posX[i] > width || posY[i] < 0 ||
+               posY[i] > height;
+
+    dead[i] = out;
+    nOut += out;
+  }
+
+  return nOut;
+}
+
+RProjectileStore::RProjectileStore() {
+  count = 0;
+  capacity = 0;
+
+  posX = NULL;
+  posY = NULL;
+  velX = NULL;
+  velY = NULL;
+  damage = NULL;
+  issuer = NULL;
+  issuerKind = NULL;
+  dead = NULL;
+}
+
+RProjectileStore::RProjectileStore(const RProjectileStore &other)
+    : RProjectileStore() {
+  *this = other;
+}
+
+RProjectileStore::~RProjectileStore() { Free(); }
+
+RProjectileStore &RProjectileStore::operator=(const RProjectileStore &other) {
+  if (this == &other) {
+    return *this;
+  }
+
+  count = 0;
+  Reserve(other.count);
+
+  memcpy(posX, other.posX, other.count * sizeof(Sint32));
+  memcpy(posY, other.posY, other.count * sizeof(Sint32));
+  memcpy(velX, other.velX, other.count * sizeof(Sint32));
+  memcpy(velY, other.velY, other.count * sizeof(Sint32));
+  memcpy(damage, other.damage, other.count * sizeof(int));
+  memcpy(issuer, other.issuer, other.count * sizeof(REntityHandle));
+  memcpy(issuerKind, other.issuerKind, other.count * sizeof(EntityKind));
+  memcpy(dead, other.dead, other.count * sizeof(Uint8));
+
+  count = other.count;
+
+  return *this;
+}
+
+int RProjectileStore::GetCount() { return count; }
+
+Sint32 *RProjectileStore::GetPosX() { return posX; }
+
+Sint32 *RProjectileStore::GetPosY() { return posY; }
+
+Sint32 *RProjectileStore::GetVelX() { return velX; }
+
+Sint32 *RProjectileStore::GetVelY() { return velY; }
+
+int *RProjectileStore::GetDamage() { return damage; }
+
+REntityHandle *RProjectileStore::GetIssuer() { return issuer; }
+
+EntityKind *RProjectileStore::GetIssuerKind() { return issuerKind; }
+
+Uint8 *RProjectileStore::GetDeadMask() { return dead; }
+
+void RProjectileStore::Reserve(int capacity) {
+  if (capacity <= this->capacity) {
+    return;
+  }
+
+  // keep whole vectors' worth of room so kernels never run off the end
+  capacity = (capacity + LANE_COUNT - 1) / LANE_COUNT * LANE_COUNT;
+
+  Grow(&posX, count, capacity);
+  Grow(&posY, count, capacity);
+  Grow(&velX, count, capacity);
+  Grow(&velY, count, capacity);
+  Grow(&damage, count, capacity);
+  Grow(&issuer, count, capacity);
+  Grow(&issuerKind, count, capacity);
+  Grow(&dead, count, capacity);
+
+  RMemory::Track(MEM_PROJECTILE,
+                 (Sint64)(capacity - this->capacity) * PROJECTILE_BYTES);
+
+  this->capacity = capacity;
+}
+
+void RProjectileStore::Add(RProjectileSpawn *spawn) {
+  if (count == capacity) {
+    Reserve(capacity > 0 ? capacity * 2 : 256);
+  }
+
+  posX[count] = spawn->posX;
+  posY[count] = spawn->posY;
+  velX[count] = spawn->velX;
+  velY[count] = spawn->velY;
+  damage[count] = spawn->damage;
+  issuer[count] = spawn->issuer;
+  issuerKind[count] = spawn->issuerKind;
+  dead[count] = 0;
+
+  count++;
+}
+
+void RProjectileStore::Resize(int count) {
+  Reserve(count);
+
+  if (count > this->count) {
+    memset(dead + this->count, 0, count - this->count);
+  }
+
+  this->count = count;
+}
+
+void RProjectileStore::Clear() { count = 0; }
+
+int RProjectileStore::Integrate(int begin, int end, int width, int height,
+                                int steps) {
+  int i = begin;
+  int nOut = 0;
+
+#if defined(__AVX2__)
+  __m256i zero = _mm256_setzero_si256();
+  __m256i maxX = _mm256_set1_epi32(width);
+  __m256i maxY = _mm256_set1_epi32(height);
+  __m256i step = _mm256_set1_epi32(steps);
+
+  // only take the aligned path from an aligned start
+  for (; i % 8 == 0 && i + 8 <= end; i += 8) {
+    __m256i x = _mm256_load_si256((__m256i *)(posX + i));
+    __m256i y = _mm256_load_si256((__m256i *)(posY + i));
+
+    __m256i vx = _mm256_load_si256((__m256i *)(velX + i));
+    __m256i vy = _mm256_load_si256((__m256i *)(velY + i));
+
+    x = _mm256_add_epi32(x, _mm256_mullo_epi32(vx, step));
+    y = _mm256_add_epi32(y, _mm256_mullo_epi32(vy, step));
+
+    _mm256_store_si256((__m256i *)(posX + i), x);
+    _mm256_store_si256((__m256i *)(posY + i), y);
+
+    // x < 0 || x > w || y < 0 || y > h
+    __m256i out = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpgt_epi32(zero, x),
+                        _mm256_cmpgt_epi32(x, maxX)),
+        _mm256_or_si256(_mm256_cmpgt_epi32(zero, y),
+                        _mm256_cmpgt_epi32(y, maxY)));
+
+    int bits = _mm256_movemask_ps(_mm256_castsi256_ps(out));
+
+    for (int lane = 0; lane < 8; ++lane) {
+      dead[i + lane] = (bits >> lane) & 1;
+    }
+
+    nOut += __builtin_popcount(bits);
+  }
+#elif defined(__SSE2__)
+  __m128i zero = _mm_setzero_si128();
+  __m128i maxX = _mm_set1_epi32(width);
+  __m128i maxY = _mm_set1_epi32(height);
+  __m128i step = _mm_set1_epi32(steps);
+
+  for (; i % 4 == 0 && i + 4 <= end; i += 4) {
+    __m128i x = _mm_load_si128((__m128i *)(posX + i));
+    __m128i y = _mm_load_si128((__m128i *)(posY + i));
+
+    __m128i vx = _mm_load_si128((__m128i *)(velX + i));
+    __m128i vy = _mm_load_si128((__m128i *)(velY + i));
+
+    x = _mm_add_epi32(x, MulLo32(vx, step));
+    y = _mm_add_epi32(y, MulLo32(vy, step));
+
+    _mm_store_si128((__m128i *)(posX + i), x);
+    _mm_store_si128((__m128i *)(posY + i), y);
+
+    // x < 0 || x > w || y < 0 || y > h
+    __m128i out =
+        _mm_or_si128(_mm_or_si128(_mm_cmplt_epi32(x, zero),
+                                  _mm_cmpgt_epi32(x, maxX)),
+                     _mm_or_si128(_mm_cmplt_epi32(y, zero),
+                                  _mm_cmpgt_epi32(y, maxY)));
+
+    int bits = _mm_movemask_ps(_mm_castsi128_ps(out));
+
+    for (int lane = 0; lane < 4; ++lane) {
+      dead[i + lane] = (bits >> lane) & 1;
+    }
+
+    nOut += __builtin_popcount(bits);
+  }
+#endif
+
+  // leftovers (or everything, without simd)
+  nOut += IntegrateScalar(posX, posY, velX, velY, dead, i, end, width, height,
+                          steps);
+
+  return nOut;
+}
+
+void RProjectileStore::Compact() {
+  int kept = 0;
+
+  for (int i = 0; i < count; ++i) {
+    if (dead[i]) {
+      continue;
+    }
+
+    if (kept != i) {
+      posX[kept] = posX[i];
+      posY[kept] = posY[i];
+      velX[kept] = velX[i];
+      velY[kept] = velY[i];
+      damage[kept] = damage[i];
+      issuer[kept] = issuer[i];
+      issuerKind[kept] = issuerKind[i];
+    }
+
+    dead[kept] = 0;
+    kept++;
+  }
+
+  count = kept;
+}
+
+void RProjectileStore::Free() {
+  if (capacity > 0) {
+    RMemory::Track(MEM_PROJECTILE, -(Sint64)capacity * PROJECTILE_BYTES);
+  }
+
+  AlignedFree(posX);
+  AlignedFree(posY);
+  AlignedFree(velX);
+  AlignedFree(velY);
+  AlignedFree(damage);
+  AlignedFree(issuer);
+  AlignedFree(issuerKind);
+  AlignedFree(dead);
+
+  posX = NULL;
+  posY = NULL;
+  velX = NULL;
+  velY = NULL;
+  damage = NULL;
+  issuer = NULL;
+  issuerKind = NULL;
+  dead = NULL;
+
+  count = 0;
+  capacity = 0;
+}
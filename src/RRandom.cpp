@@ -0,0 +1,36 @@
+#include "RRandom.hpp"
+
+RRandom::RRandom(Uint64 seed) { Seed(seed); }
+
+void RRandom::Seed(Uint64 seed) {
+  // splitmix the seed so nearby seeds don't give nearby sequences; xorshift
+  // also can't have a zero state
+  Uint64 z = seed + 0x9E3779B97F4A7C15ull;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  z = z ^ (z >> 31);
+
+  state = z != 0 ? z : 1;
+}
+
+Uint64 RRandom::GetState() { return state; }
+
+void RRandom::SetState(Uint64 state) { this->state = state != 0 ? state : 1; }
+
+Uint32 RRandom::Next() {
+  state ^= state >> 12;
+  state ^= state << 25;
+  state ^= state >> 27;
+
+  return (Uint32)((state * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+int RRandom::Range(int n) {
+  if (n <= 0) {
+    return 0;
+  }
+
+  return (int)(((Uint64)Next() * (Uint64)n) >> 32);
+}
+
+float RRandom::Float() { return (Next() >> 8) / 16777216.0f; }
@@ -0,0 +1,204 @@
+#include "RRenderQueue.hpp"
+
+#include <SDL_render.h>
+
+// key layout, high to low: layer (8 bits), blend (4 bits), material (20 bits)
+const int KEY_LAYER_SHIFT = 24;
+const int KEY_BLEND_SHIFT = 20;
+const Uint32 KEY_MATERIAL_MASK = (1 << KEY_BLEND_SHIFT) - 1;
+
+// only needs to keep modes apart, not mean anything
+static Uint32 BlendBits(SDL_BlendMode blend) {
+  switch (blend) {
+  case SDL_BLENDMODE_NONE:
+    return 0;
+  case SDL_BLENDMODE_BLEND:
+    return 1;
+  case SDL_BLENDMODE_ADD:
+    return 2;
+  case SDL_BLENDMODE_MOD:
+    return 3;
+  default:
+    return 15;
+  }
+}
+
+RRenderQueue::RRenderQueue() { stateChanges = 0; }
+
+void RRenderQueue::SubmitTexture(RRenderLayer layer, RTexture *texture,
+                                 SDL_Rect *clip, int x, int y, double angle,
+                                 SDL_BlendMode blend) {
+  SDL_Color none = {0, 0, 0, 0};
+
+  RRenderItem item;
+
+  item.material = GetMaterial(texture, none);
+  item.dest.x = x;
+  item.dest.y = y;
+  item.dest.w = 0;
+  item.dest.h = 0;
+  item.clipped = clip != NULL;
+  item.angle = angle;
+
+  if (clip != NULL) {
+    item.clip = *clip;
+  }
+
+  Submit(layer, blend, &item);
+}
+
+void RRenderQueue::SubmitFill(RRenderLayer layer, SDL_Color color,
+                              SDL_Rect *rect, SDL_BlendMode blend) {
+  RRenderItem item;
+
+  item.material = GetMaterial(NULL, color);
+  item.dest = *rect;
+  item.clipped = false;
+  item.angle = 0;
+
+  Submit(layer, blend, &item);
+}
+
+void RRenderQueue::Submit(RRenderLayer layer, SDL_BlendMode blend,
+                          RRenderItem *item) {
+  item->blend = blend;
+
+  Uint32 key = ((Uint32)layer << KEY_LAYER_SHIFT) |
+               (BlendBits(blend) << KEY_BLEND_SHIFT) |
+               (item->material & KEY_MATERIAL_MASK);
+
+  keys.push_back(((Uint64)key << 32) | (Uint32)items.size());
+  items.push_back(*item);
+}
+
+Uint32 RRenderQueue::GetMaterial(RTexture *texture, SDL_Color color) {
+  // there are only ever a handful of these
+  for (int i = 0; i < materials.size(); ++i) {
+    RMaterial *m = &materials[i];
+
+    if (m->texture != texture) {
+      continue;
+    }
+
+    if (texture != NULL || (m->color.r == color.r && m->color.g == color.g &&
+                            m->color.b == color.b && m->color.a == color.a)) {
+      return i;
+    }
+  }
+
+  if (materials.size() > KEY_MATERIAL_MASK) {
+    printf("Too many render materials! Sorting may be off.\n");
+  }
+
+  RMaterial m;
+
+  m.texture = texture;
+  m.color = color;
+
+  materials.push_back(m);
+
+  return materials.size() - 1;
+}
+
+void RRenderQueue::Sort() {
+  int n = keys.size();
+
+  scratch.resize(n);
+
+  Uint64 *src = keys.data();
+  Uint64 *dst = scratch.data();
+
+  for (int shift = 32; shift < 64; shift += 8) {
+    int counts[256] = {0};
+
+    for (int i = 0; i < n; ++i) {
+      counts[(src[i] >> shift) & 0xff]++;
+    }
+
+    // everything has the same byte here; nothing would move
+    if (counts[(src[0] >> shift) & 0xff] == n) {
+      continue;
+    }
+
+    int offset = 0;
+
+    for (int b = 0; b < 256; ++b) {
+      int count = counts[b];
+      counts[b] = offset;
+      offset += count;
+    }
+
+    for (int i = 0; i < n; ++i) {
+      dst[counts[(src[i] >> shift) & 0xff]++] = src[i];
+    }
+
+    Uint64 *swap = src;
+    src = dst;
+    dst = swap;
+  }
+
+  if (src != keys.data()) {
+    keys.swap(scratch);
+  }
+}
+
+void RRenderQueue::Flush(SDL_Renderer *renderer) {
+  stateChanges = 0;
+
+  if (keys.empty()) {
+    return;
+  }
+
+  Sort();
+
+  Uint32 lastKey = 0xffffffff;
+
+  for (int i = 0; i < keys.size(); ++i) {
+    Uint32 key = keys[i] >> 32;
+    RRenderItem *item = &items[(Uint32)keys[i]];
+    RMaterial *m = &materials[item->material];
+
+    if (key != lastKey) {
+      if (m->texture != NULL) {
+        m->texture->SetBlendMode(item->blend);
+      } else {
+        SDL_SetRenderDrawBlendMode(renderer, item->blend);
+        SDL_SetRenderDrawColor(renderer, m->color.r, m->color.g, m->color.b,
+                               m->color.a);
+      }
+
+      lastKey = key;
+      stateChanges++;
+    }
+
+    if (m->texture == NULL) {
+      SDL_RenderFillRect(renderer, &item->dest);
+      continue;
+    }
+
+    SDL_Rect *clip = item->clipped ? &item->clip : NULL;
+
+    if (item->angle == 0) {
+      m->texture->Render(renderer, item->dest.x, item->dest.y, clip, true);
+      continue;
+    }
+
+    int scale = m->texture->GetScale();
+    int w = (clip != NULL ? clip->w : m->texture->GetWidthUnscaled()) * scale;
+    int h = (clip != NULL ? clip->h : m->texture->GetHeightUnscaled()) * scale;
+
+    // null rotates around center
+    m->texture->Render(renderer, item->dest.x - w / 2, item->dest.y - h / 2,
+                       clip, item->angle, NULL, SDL_FLIP_NONE);
+  }
+
+  SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+  SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+
+  items.clear();
+  keys.clear();
+}
+
+int RRenderQueue::GetSize() { return items.size(); }
+
+int RRenderQueue::GetStateChanges() { return stateChanges; }
@@ -0,0 +1,412 @@
+#include "RReplay.hpp"
+
+#include <string.h>
+
+const Uint8 RECORD_COMMAND = 0;
+const Uint8 RECORD_HASH = 1;
+const Uint8 RECORD_END = 2;
+
+static Uint64 ZigZag(Sint64 value) {
+  return ((Uint64)value << 1) ^ (Uint64)(value >> 63);
+}
+
+static Sint64 UnZigZag(Uint64 value) {
+  return (Sint64)(value >> 1) ^ -(Sint64)(value & 1);
+}
+
+// reads over an in-memory copy of the file; running off the end sets failed
+// instead of reading garbage
+typedef struct RReader {
+  std::vector<Uint8> *data;
+  int offset;
+  bool failed;
+} RReader;
+
+static Uint8 ReadByte(RReader *reader) {
+  if (reader->offset >= reader->data->size()) {
+    reader->failed = true;
+    return 0;
+  }
+
+  return (*reader->data)[reader->offset++];
+}
+
+static Uint64 ReadFixed(RReader *reader, int nBytes) {
+  Uint64 value = 0;
+
+  for (int i = 0; i < nBytes; ++i) {
+    value |= (Uint64)ReadByte(reader) << (8 * i);
+  }
+
+  return value;
+}
+
+static Uint64 ReadVarint(RReader *reader) {
+  Uint64 value = 0;
+
+  for (int shift = 0; shift < 64; shift += 7) {
+    Uint8 byte = ReadByte(reader);
+
+    value |= (Uint64)(byte & 0x7F) << shift;
+
+    if (!(byte & 0x80)) {
+      break;
+    }
+  }
+
+  return value;
+}
+
+RReplayRecorder::RReplayRecorder() {
+  file = NULL;
+  lastTick = 0;
+}
+
+RReplayRecorder::~RReplayRecorder() {
+  if (file != NULL) {
+    fclose(file);
+  }
+}
+
+bool RReplayRecorder::Open(const char *path, Uint32 seed, int tickRate,
+                           Uint64 waveHash, RTargetPolicy towerPolicy,
+                           float retargetInterval) {
+  file = fopen(path, "wb");
+
+  if (file == NULL) {
+    printf("Could not open replay %s for writing!\n", path);
+    return false;
+  }
+
+  fwrite("DTRP", 1, 4, file);
+  WriteByte(REPLAY_VERSION);
+  WriteByte(SIM_FIXED_POINT);
+
+  for (int i = 0; i < 4; ++i) {
+    WriteByte((seed >> (8 * i)) & 0xFF);
+  }
+
+  WriteByte(tickRate & 0xFF);
+  WriteByte((tickRate >> 8) & 0xFF);
+
+  for (int i = 0; i < 8; ++i) {
+    WriteByte((waveHash >> (8 * i)) & 0xFF);
+  }
+
+  WriteByte(towerPolicy);
+
+  // the float's bits, so it comes back exactly
+  Uint32 interval = 0;
+  memcpy(&interval, &retargetInterval, sizeof(interval));
+
+  for (int i = 0; i < 4; ++i) {
+    WriteByte((interval >> (8 * i)) & 0xFF);
+  }
+
+  lastTick = 0;
+
+  return true;
+}
+
+bool RReplayRecorder::IsOpen() { return file != NULL; }
+
+void RReplayRecorder::RecordCommand(Uint64 tick, RCommand *command) {
+  if (file == NULL) {
+    return;
+  }
+
+  WriteRecord(RECORD_COMMAND, tick);
+  WriteByte(command->type);
+  WriteVarint(ZigZag(command->a));
+  WriteVarint(ZigZag(command->b));
+}
+
+void RReplayRecorder::RecordHash(Uint64 tick, Uint64 hash) {
+  if (file == NULL) {
+    return;
+  }
+
+  WriteRecord(RECORD_HASH, tick);
+
+  for (int i = 0; i < 8; ++i) {
+    WriteByte((hash >> (8 * i)) & 0xFF);
+  }
+}
+
+void RReplayRecorder::Close(Uint64 finalTick) {
+  if (file == NULL) {
+    return;
+  }
+
+  WriteRecord(RECORD_END, finalTick);
+
+  fclose(file);
+  file = NULL;
+}
+
+void RReplayRecorder::WriteRecord(Uint8 kind, Uint64 tick) {
+  WriteByte(kind);
+  WriteVarint(tick - lastTick);
+
+  lastTick = tick;
+}
+
+void RReplayRecorder::WriteByte(Uint8 value) { fputc(value, file); }
+
+void RReplayRecorder::WriteVarint(Uint64 value) {
+  while (value >= 0x80) {
+    WriteByte((value & 0x7F) | 0x80);
+    value >>= 7;
+  }
+
+  WriteByte(value);
+}
+
+RReplayPlayer::RReplayPlayer() {
+  seed = 0;
+  tickRate = 0;
+  waveHash = 0;
+  towerPolicy = T_FIRST;
+  retargetInterval = 0;
+  endTick = 0;
+
+  commandCursor = 0;
+  hashCursor = 0;
+
+  desynced = false;
+}
+
+bool RReplayPlayer::Load(const char *path) {
+  FILE *file = fopen(path, "rb");
+
+  if (file == NULL) {
+    printf("Could not open replay %s!\n", path);
+    return false;
+  }
+
+  std::vector<Uint8> data;
+  Uint8 chunk[4096];
+  size_t nRead;
+
+  while ((nRead = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    data.insert(data.end(), chunk, chunk + nRead);
+  }
+
+  fclose(file);
+
+  RReader reader = {&data, 0, false};
+
+  if (data.size() < 4 || memcmp(data.data(), "DTRP", 4) != 0) {
+    printf("%s is not a replay!\n", path);
+    return false;
+  }
+
+  reader.offset = 4;
+
+  int version = ReadByte(&reader);
+
+  if (version != REPLAY_VERSION) {
+    printf("Replay %s is version %d, we only play %d!\n", path, version,
+           REPLAY_VERSION);
+    return false;
+  }
+
+  // same commands, different arithmetic; it'd desync on the first shot
+  int fixedPoint = ReadByte(&reader);
+
+  if (fixedPoint != SIM_FIXED_POINT) {
+    printf("Replay %s was recorded by a %s build, this one is %s!\n", path,
+           fixedPoint ? "fixed point" : "float",
+           SIM_FIXED_POINT ? "fixed point" : "float");
+    return false;
+  }
+
+  seed = ReadFixed(&reader, 4);
+  tickRate = ReadFixed(&reader, 2);
+  waveHash = ReadFixed(&reader, 8);
+
+  int policy = ReadByte(&reader);
+  Uint32 interval = ReadFixed(&reader, 4);
+
+  memcpy(&retargetInterval, &interval, sizeof(retargetInterval));
+
+  if (reader.failed || !IsTargetPolicy(policy) ||
+      !IsEventSeconds(retargetInterval)) {
+    printf("Replay %s has bad tower targeting!\n", path);
+    return false;
+  }
+
+  towerPolicy = (RTargetPolicy)policy;
+
+  commands.clear();
+  hashes.clear();
+
+  Uint64 tick = 0;
+  bool ended = false;
+
+  while (!ended && !reader.failed) {
+    Uint8 kind = ReadByte(&reader);
+
+    if (reader.failed) {
+      break;
+    }
+
+    tick += ReadVarint(&reader);
+
+    switch (kind) {
+    case RECORD_COMMAND: {
+      RReplayCommand command;
+
+      command.tick = tick;
+      command.command.type = (RCommandType)ReadByte(&reader);
+      command.command.a = UnZigZag(ReadVarint(&reader));
+      command.command.b = UnZigZag(ReadVarint(&reader));
+
+      commands.push_back(command);
+      break;
+    }
+    case RECORD_HASH: {
+      RReplayHash hash;
+
+      hash.tick = tick;
+      hash.hash = ReadFixed(&reader, 8);
+
+      hashes.push_back(hash);
+      break;
+    }
+    case RECORD_END:
+      ended = true;
+      break;
+    default:
+      printf("Replay %s has a bad record!\n", path);
+      reader.failed = true;
+      break;
+    }
+  }
+
+  // a session that crashed never wrote its end; play what we got
+  if (!ended) {
+    printf("Replay %s was cut short, playing up to tick %llu\n", path,
+           (unsigned long long)tick);
+  }
+
+  endTick = tick;
+
+  return tickRate > 0;
+}
+
+Uint32 RReplayPlayer::GetSeed() { return seed; }
+
+int RReplayPlayer::GetTickRate() { return tickRate; }
+
+Uint64 RReplayPlayer::GetWaveHash() { return waveHash; }
+
+RTargetPolicy RReplayPlayer::GetTowerPolicy() { return towerPolicy; }
+
+float RReplayPlayer::GetRetargetInterval() { return retargetInterval; }
+
+Uint64 RReplayPlayer::GetEndTick() { return endTick; }
+
+bool RReplayPlayer::IsDesynced() { return desynced; }
+
+void RReplayPlayer::Begin(RWorld *world) {
+  commandCursor = 0;
+  hashCursor = 0;
+  desynced = false;
+
+  CaptureKeyframe(world);
+}
+
+void RReplayPlayer::Step(RWorld *world) {
+  Uint64 tick = world->GetTick();
+
+  if (tick % REPLAY_KEYFRAME_INTERVAL == 0) {
+    CaptureKeyframe(world);
+  }
+
+  while (commandCursor < commands.size() &&
+         commands[commandCursor].tick <= tick) {
+    world->HandleCommand(&commands[commandCursor].command);
+    commandCursor++;
+  }
+
+  world->Tick(1.0f / tickRate);
+
+  CheckHash(world);
+}
+
+void RReplayPlayer::Seek(RWorld *world, Uint64 tick) {
+  if (tick > endTick) {
+    tick = endTick;
+  }
+
+  // going forward from where we are beats restoring an older keyframe
+  bool restore = tick < world->GetTick();
+
+  int best = -1;
+
+  for (int i = 0; i < keyframes.size(); ++i) {
+    if (keyframes[i].tick <= tick) {
+      best = i;
+    }
+  }
+
+  if (best >= 0 && keyframes[best].tick > world->GetTick()) {
+    restore = true;
+  }
+
+  if (restore && best >= 0) {
+    world->Restore(keyframes[best].snapshot.data(),
+                   keyframes[best].snapshot.size());
+
+    // rewind the cursors to match
+    commandCursor = 0;
+    while (commandCursor < commands.size() &&
+           commands[commandCursor].tick < world->GetTick()) {
+      commandCursor++;
+    }
+
+    hashCursor = 0;
+    while (hashCursor < hashes.size() &&
+           hashes[hashCursor].tick <= world->GetTick()) {
+      hashCursor++;
+    }
+  }
+
+  while (world->GetTick() < tick) {
+    Step(world);
+  }
+
+  world->DiscardEffects();
+}
+
+void RReplayPlayer::CaptureKeyframe(RWorld *world) {
+  // only ever append; after seeking back we already have the later ones
+  if (!keyframes.empty() && keyframes.back().tick >= world->GetTick()) {
+    return;
+  }
+
+  keyframes.emplace_back();
+
+  keyframes.back().tick = world->GetTick();
+  world->Save(&keyframes.back().snapshot);
+}
+
+void RReplayPlayer::CheckHash(RWorld *world) {
+  Uint64 tick = world->GetTick();
+
+  while (hashCursor < hashes.size() && hashes[hashCursor].tick < tick) {
+    hashCursor++;
+  }
+
+  if (hashCursor >= hashes.size() || hashes[hashCursor].tick != tick) {
+    return;
+  }
+
+  if (hashes[hashCursor].hash != world->Hash() && !desynced) {
+    printf("Replay desynced at tick %llu!\n", (unsigned long long)tick);
+    desynced = true;
+  }
+
+  hashCursor++;
+}
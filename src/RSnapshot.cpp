@@ -0,0 +1,95 @@
+#include "RSnapshot.hpp"
+
+#include "RFixed.hpp"
+#include <stdio.h>
+
+static const char SNAPSHOT_MAGIC[4] = {'D', 'T', 'S', 'N'};
+
+// reads back as something else on a machine with the other byte order
+static const Uint32 BYTE_ORDER_MARK = 0x01020304;
+
+RSnapshotWriter::RSnapshotWriter(std::vector<Uint8> *out) { this->out = out; }
+
+void RSnapshotWriter::WriteHeader() {
+  WriteBytes(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+  Write((Uint16)SNAPSHOT_VERSION);
+  Write((Uint8)SIM_FIXED_POINT);
+  Write(BYTE_ORDER_MARK);
+}
+
+void RSnapshotWriter::WriteBytes(const void *data, int nBytes) {
+  if (nBytes <= 0) {
+    return;
+  }
+
+  int at = out->size();
+
+  out->resize(at + nBytes);
+  memcpy(out->data() + at, data, nBytes);
+}
+
+RSnapshotReader::RSnapshotReader(const Uint8 *data, int size) {
+  this->data = data;
+  this->size = size;
+
+  at = 0;
+  ok = data != NULL && size >= 0;
+}
+
+bool RSnapshotReader::ReadHeader() {
+  char magic[4];
+  Uint16 version;
+  Uint8 fixedPoint;
+  Uint32 byteOrder;
+
+  if (!ReadBytes(magic, sizeof(magic)) || !Read(&version) ||
+      !Read(&fixedPoint) || !Read(&byteOrder)) {
+    printf("Snapshot is too short!\n");
+    return false;
+  }
+
+  if (memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) != 0) {
+    printf("Not a snapshot!\n");
+    return false;
+  }
+
+  if (version != SNAPSHOT_VERSION) {
+    printf("Snapshot version %d isn't supported, expected %d!\n", version,
+           SNAPSHOT_VERSION);
+    return false;
+  }
+
+  if (byteOrder != BYTE_ORDER_MARK) {
+    printf("Snapshot was saved with a different byte order!\n");
+    return false;
+  }
+
+  if (fixedPoint != SIM_FIXED_POINT) {
+    printf("Snapshot is from a %s build, this one is %s!\n",
+           fixedPoint ? "fixed point" : "float",
+           SIM_FIXED_POINT ? "fixed point" : "float");
+    return false;
+  }
+
+  return true;
+}
+
+bool RSnapshotReader::ReadBytes(void *data, int nBytes) {
+  if (!ok || !HasBytes(nBytes)) {
+    ok = false;
+    return false;
+  }
+
+  if (nBytes > 0) {
+    memcpy(data, this->data + at, nBytes);
+    at += nBytes;
+  }
+
+  return true;
+}
+
+bool RSnapshotReader::HasBytes(Sint64 nBytes) {
+  return nBytes >= 0 && nBytes <= size - at;
+}
+
+bool RSnapshotReader::IsOk() { return ok; }
@@ -0,0 +1,123 @@
+#include "RSpatialGrid.hpp"
+
+RSpatialGrid::RSpatialGrid() {
+  cellSize = 1;
+  nCellsX = 0;
+  nCellsY = 0;
+}
+
+void RSpatialGrid::Resize(int width, int height, int cellSize) {
+  this->cellSize = cellSize;
+
+  nCellsX = (width + cellSize - 1) / cellSize;
+  nCellsY = (height + cellSize - 1) / cellSize;
+
+  cellStart.assign(nCellsX * nCellsY + 1, 0);
+
+  Clear();
+}
+
+void RSpatialGrid::Clear() {
+  stagedCells.clear();
+  stagedIds.clear();
+  cellIds.clear();
+}
+
+void RSpatialGrid::Insert(int id, SDL_Rect *rect) {
+  // anything hanging off the level gets lumped into the border cells
+  int minX = ClampCellX(rect->x);
+  int maxX = ClampCellX(rect->x + rect->w);
+  int minY = ClampCellY(rect->y);
+  int maxY = ClampCellY(rect->y + rect->h);
+
+  for (int y = minY; y <= maxY; ++y) {
+    for (int x = minX; x <= maxX; ++x) {
+      stagedCells.push_back(CellIndex(x, y));
+      stagedIds.push_back(id);
+    }
+  }
+}
+
+void RSpatialGrid::InsertPoint(int id, int x, int y) {
+  stagedCells.push_back(CellIndex(ClampCellX(x), ClampCellY(y)));
+  stagedIds.push_back(id);
+}
+
+void RSpatialGrid::Build() {
+  int nCells = nCellsX * nCellsY;
+
+  // counting sort keeps insertion order within each cell
+  for (int i = 0; i <= nCells; ++i) {
+    cellStart[i] = 0;
+  }
+
+  for (int i = 0; i < stagedCells.size(); ++i) {
+    cellStart[stagedCells[i] + 1]++;
+  }
+
+  for (int i = 0; i < nCells; ++i) {
+    cellStart[i + 1] += cellStart[i];
+  }
+
+  cellIds.resize(stagedIds.size());
+
+  // scatter ids to their cells, bumping a write cursor per cell
+  cellCursor.assign(cellStart.begin(), cellStart.end() - 1);
+
+  for (int i = 0; i < stagedCells.size(); ++i) {
+    cellIds[cellCursor[stagedCells[i]]++] = stagedIds[i];
+  }
+
+  stagedCells.clear();
+  stagedIds.clear();
+}
+
+int RSpatialGrid::QueryPoint(int x, int y, const int **ids) {
+  if (nCellsX == 0 || nCellsY == 0) {
+    *ids = NULL;
+    return 0;
+  }
+
+  int cell = CellIndex(ClampCellX(x), ClampCellY(y));
+
+  *ids = cellIds.data() + cellStart[cell];
+
+  return cellStart[cell + 1] - cellStart[cell];
+}
+
+void RSpatialGrid::QueryRect(int minX, int minY, int maxX, int maxY,
+                             std::vector<int> &out) {
+  if (nCellsX == 0 || nCellsY == 0) {
+    return;
+  }
+
+  int cellMinX = ClampCellX(minX);
+  int cellMaxX = ClampCellX(maxX);
+  int cellMinY = ClampCellY(minY);
+  int cellMaxY = ClampCellY(maxY);
+
+  for (int y = cellMinY; y <= cellMaxY; ++y) {
+    for (int x = cellMinX; x <= cellMaxX; ++x) {
+      int cell = CellIndex(x, y);
+
+      out.insert(out.end(), cellIds.begin() + cellStart[cell],
+                 cellIds.begin() + cellStart[cell + 1]);
+    }
+  }
+}
+
+int RSpatialGrid::CellIndex(int cellX, int cellY) {
+  return cellY * nCellsX + cellX;
+}
+
+int RSpatialGrid::ClampCellX(int x) {
+  int cellX = x < 0 ? 0 : x / cellSize;
+
+  return cellX >= nCellsX ? nCellsX - 1 : cellX;
+}
+
+int RSpatialGrid::ClampCellY(int y) {
+  int cellY = y < 0 ? 0 : y / cellSize;
+
+  return cellY >= nCellsY ? nCellsY - 1 : cellY;
+}
@@ -17,6 +17,10 @@ SDL_Rect *RSprite::GetRect(){
   return spriteSheet->GetRect();
 }
 
+RTexture *RSprite::GetSheet() { return spriteSheet; }
+
+SDL_Rect *RSprite::GetClip() { return &spriteClips[currentFrame]; }
+
 float RSprite::GetFrameTimer() { return this->fTimer; }
 
 bool RSprite::GetMovedFrame() { return movedFrame; }
@@ -45,8 +49,7 @@ void RSprite::SetFrame(int f) {
   this->currentFrame = f;
 }
 
-bool RSprite::Render(SDL_Renderer *renderer, float dt, int x, int y,
-                     double angle) {
+bool RSprite::Update(float dt) {
   movedFrame = false;
 
   if (fps > 0) {
@@ -65,6 +68,13 @@ bool RSprite::Render(SDL_Renderer *renderer, float dt, int x, int y,
     }
   }
 
+  return movedFrame;
+}
+
+bool RSprite::Render(SDL_Renderer *renderer, float dt, int x, int y,
+                     double angle) {
+  Update(dt);
+
   // null rotates around center
   spriteSheet->Render(renderer, x - spriteSheet->GetWidth() / 2,
                       y - spriteSheet->GetHeight() / 2,
@@ -0,0 +1,81 @@
+#include "RTargeting.hpp"
+
+RTargeting::RTargeting() {}
+
+void RTargeting::Resize(int width, int height, int cellSize) {
+  grid.Resize(width, height, cellSize);
+}
+
+void RTargeting::Index(std::vector<REntity *> &enemies) {
+  grid.Clear();
+
+  for (int i = 0; i < enemies.size(); ++i) {
+    grid.InsertPoint(i, enemies[i]->GetPosX(), enemies[i]->GetPosY());
+  }
+
+  grid.Build();
+}
+
+REntity *RTargeting::FindTarget(REntity *tower,
+                                std::vector<REntity *> &enemies,
+                                std::vector<int> &scratch) {
+  int x = tower->GetPosX();
+  int y = tower->GetPosY();
+  int range = (int)tower->GetRange();
+
+  scratch.clear();
+  grid.QueryRect(x - range, y - range, x + range, y + range, scratch);
+
+  RTargetPolicy policy = tower->GetTargetPolicy();
+  REntity *best = NULL;
+  int bestIndex = 0;
+
+  for (int i = 0; i < scratch.size(); ++i) {
+    int index = scratch[i];
+    REntity *enemy = enemies[index];
+
+    // box corners are out of range even though they're in the query
+    if (!InRange(tower, enemy)) {
+      continue;
+    }
+
+    // cells come back in grid order; break ties by list order so the pick
+    // doesn't depend on where things sit in the grid
+    if (best == NULL || IsBetter(policy, tower, enemy, best) ||
+        (!IsBetter(policy, tower, best, enemy) && index < bestIndex)) {
+      best = enemy;
+      bestIndex = index;
+    }
+  }
+
+  return best;
+}
+
+bool RTargeting::InRange(REntity *tower, REntity *target) {
+  Sint64 range = (int)tower->GetRange();
+
+  return DistanceSquared(tower, target) < range * range;
+}
+
+bool RTargeting::IsBetter(RTargetPolicy policy, REntity *tower, REntity *a,
+                          REntity *b) {
+  switch (policy) {
+  case T_FIRST:
+    return a->GetPathProgress() > b->GetPathProgress();
+  case T_CLOSEST:
+    return DistanceSquared(tower, a) < DistanceSquared(tower, b);
+  case T_WEAKEST:
+    return a->GetHealth() < b->GetHealth();
+  case T_STRONGEST:
+    return a->GetHealth() > b->GetHealth();
+  default:
+    return false;
+  }
+}
+
+Sint64 RTargeting::DistanceSquared(REntity *a, REntity *b) {
+  Sint64 dx = a->GetPosX() - b->GetPosX();
+  Sint64 dy = a->GetPosY() - b->GetPosY();
+
+  return dx * dx + dy * dy;
+}
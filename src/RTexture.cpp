@@ -1,5 +1,6 @@
 #include "RTexture.hpp"
 
+#include "RMemory.hpp"
 #include <SDL_image.h>
 #include <SDL_render.h>
 
@@ -8,6 +9,7 @@ RTexture::RTexture() {
   width = 0;
   height = 0;
   scale = 1;
+  gpuBytes = 0;
   renderDest.x = 0;
   renderDest.y = 0;
   renderDest.w = 0;
@@ -42,6 +44,9 @@ bool RTexture::LoadFromRenderedText(SDL_Renderer *renderer, TTF_Font *font,
 
   SDL_FreeSurface(tSurf);
 
+  gpuBytes = GetTextureBytes(texture);
+  RMemory::TrackGpu(MEM_TEXTURE, gpuBytes);
+
   return true;
 }
 
@@ -59,12 +64,35 @@ bool RTexture::LoadFromFile(SDL_Renderer *renderer, const char *path, Uint8 r,
     return false;
   }
 
+  return LoadFromSurface(renderer, lSurf, r, g, b);
+}
+
+bool RTexture::LoadFromMemory(SDL_Renderer *renderer, const void *data,
+                              int size, Uint8 r, Uint8 g, Uint8 b) {
+
+  Free();
+
+  // 1 has the rwops closed for us
+  SDL_Surface *lSurf = IMG_Load_RW(SDL_RWFromConstMem(data, size), 1);
+
+  if (lSurf == NULL) {
+    printf("Unable to load image: %s\n", SDL_GetError());
+    return false;
+  }
+
+  return LoadFromSurface(renderer, lSurf, r, g, b);
+}
+
+bool RTexture::LoadFromSurface(SDL_Renderer *renderer, SDL_Surface *lSurf,
+                               Uint8 r, Uint8 g, Uint8 b) {
+
   SDL_SetColorKey(lSurf, SDL_TRUE, SDL_MapRGB(lSurf->format, r, g, b));
 
   SDL_Texture *nTexture = SDL_CreateTextureFromSurface(renderer, lSurf);
 
   if (nTexture == NULL) {
     printf("Could not create texture: %s\n", SDL_GetError());
+    SDL_FreeSurface(lSurf);
     return false;
   }
 
@@ -75,6 +103,9 @@ bool RTexture::LoadFromFile(SDL_Renderer *renderer, const char *path, Uint8 r,
 
   texture = nTexture;
 
+  gpuBytes = GetTextureBytes(texture);
+  RMemory::TrackGpu(MEM_TEXTURE, gpuBytes);
+
   return true;
 }
 
@@ -82,6 +113,10 @@ void RTexture::Free() {
   if (texture != NULL) {
     SDL_DestroyTexture(texture);
     texture = NULL;
+
+    RMemory::TrackGpu(MEM_TEXTURE, -gpuBytes);
+    gpuBytes = 0;
+
     width = 0;
     height = 0;
   }
@@ -151,6 +186,17 @@ void RTexture::Render(SDL_Renderer *renderer, int x, int y, int w, int h,
   SDL_RenderCopy(renderer, texture, clip, &renderDest);
 }
 
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+
+void RTexture::RenderGeometry(SDL_Renderer *renderer,
+                              const SDL_Vertex *vertices, int nVertices,
+                              const int *indices, int nIndices) {
+  SDL_RenderGeometry(renderer, texture, vertices, nVertices, indices,
+                     nIndices);
+}
+
+#endif
+
 int RTexture::GetWidth() {
   if (renderDest.w == width || renderDest.w == 0) {
     return width * scale;
@@ -175,4 +221,21 @@ SDL_Rect *RTexture::GetRect(){
   return &renderDest;
 }
 
+int RTexture::GetScale() { return scale; }
+
+Sint64 RTexture::GetTextureBytes(SDL_Texture *texture) {
+  Uint32 format;
+  int w, h;
+
+  if (texture == NULL ||
+      SDL_QueryTexture(texture, &format, NULL, &w, &h) != 0) {
+    return 0;
+  }
+
+  // formats we don't know the size of are probably 4 bytes anyway
+  int bytesPerPixel = SDL_BYTESPERPIXEL(format);
+
+  return (Sint64)w * h * (bytesPerPixel > 0 ? bytesPerPixel : 4);
+}
+
 void RTexture::SetScale(int nScale) { scale = nScale; }
@@ -0,0 +1,67 @@
+#include "RTileGrid.hpp"
+
+RTileGrid::RTileGrid() {
+  gridWidth = 0;
+  gridHeight = 0;
+  tileWidth = 1;
+  tileHeight = 1;
+}
+
+void RTileGrid::Resize(int gridWidth, int gridHeight, int tileWidth,
+                       int tileHeight) {
+  this->gridWidth = gridWidth;
+  this->gridHeight = gridHeight;
+  this->tileWidth = tileWidth;
+  this->tileHeight = tileHeight;
+
+  tiles.assign(gridWidth * gridHeight, NULL_HANDLE);
+}
+
+void RTileGrid::Clear() { tiles.assign(tiles.size(), NULL_HANDLE); }
+
+int RTileGrid::GetGridWidth() { return gridWidth; }
+
+int RTileGrid::GetGridHeight() { return gridHeight; }
+
+bool RTileGrid::InBounds(int tileX, int tileY) {
+  return tileX >= 0 && tileX < gridWidth && tileY >= 0 && tileY < gridHeight;
+}
+
+bool RTileGrid::TileAt(int x, int y, int *tileX, int *tileY) {
+  // negative coords would round toward tile 0 otherwise
+  if (x < 0 || y < 0) {
+    return false;
+  }
+
+  *tileX = x / tileWidth;
+  *tileY = y / tileHeight;
+
+  return InBounds(*tileX, *tileY);
+}
+
+REntityHandle RTileGrid::Get(int tileX, int tileY) {
+  if (!InBounds(tileX, tileY)) {
+    return NULL_HANDLE;
+  }
+
+  return tiles[tileY * gridWidth + tileX];
+}
+
+bool RTileGrid::IsFree(int tileX, int tileY) {
+  return InBounds(tileX, tileY) && Get(tileX, tileY) == NULL_HANDLE;
+}
+
+bool RTileGrid::Claim(int tileX, int tileY, REntityHandle handle) {
+  if (!IsFree(tileX, tileY)) {
+    return false;
+  }
+
+  tiles[tileY * gridWidth + tileX] = handle;
+  return true;
+}
+
+void RTileGrid::Release(int tileX, int tileY, REntityHandle handle) {
+  if (InBounds(tileX, tileY) && Get(tileX, tileY) == handle) {
+    tiles[tileY * gridWidth + tileX] = NULL_HANDLE;
+  }
+}
@@ -0,0 +1,261 @@
+#include "RTileMap.hpp"
+
+#include "RJson.hpp"
+#include "RMemory.hpp"
+#include <SDL_render.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+static int Base64Value(char c) {
+  if (c >= 'A' && c <= 'Z') {
+    return c - 'A';
+  }
+
+  if (c >= 'a' && c <= 'z') {
+    return c - 'a' + 26;
+  }
+
+  if (c >= '0' && c <= '9') {
+    return c - '0' + 52;
+  }
+
+  if (c == '+') {
+    return 62;
+  }
+
+  if (c == '/') {
+    return 63;
+  }
+
+  return -1;
+}
+
+// stops at padding or anything that isn't base64
+static void DecodeBase64(const char *text, std::vector<Uint8> *out) {
+  Uint32 bits = 0;
+  int nBits = 0;
+
+  for (; *text != '\0'; ++text) {
+    int value = Base64Value(*text);
+
+    if (value < 0) {
+      break;
+    }
+
+    bits = (bits << 6) | value;
+    nBits += 6;
+
+    if (nBits >= 8) {
+      nBits -= 8;
+      out->push_back((bits >> nBits) & 0xFF);
+    }
+  }
+}
+
+RTileMap::RTileMap() {
+  tileSize = 1;
+  gridWidth = 0;
+  gridHeight = 0;
+
+  background = {0, 0, 0, 255};
+}
+
+bool RTileMap::LoadFromFile(SDL_Renderer *renderer, const char *path) {
+  RMemScope scope(MEM_MAP);
+
+  RJsonValue root;
+
+  if (!root.LoadFromFile(path)) {
+    return false;
+  }
+
+  Free();
+
+  RJsonValue *value = root.Get("tileSize");
+  tileSize = value != NULL ? value->GetInt() : 0;
+
+  int mapWidth = root.Get("mapWidth") ? root.Get("mapWidth")->GetInt() : 0;
+  int mapHeight = root.Get("mapHeight") ? root.Get("mapHeight")->GetInt() : 0;
+
+  if (tileSize <= 0 || mapWidth <= 0 || mapHeight <= 0) {
+    printf("%s: needs tileSize, mapWidth and mapHeight\n", path);
+    return false;
+  }
+
+  gridWidth = (mapWidth + tileSize - 1) / tileSize;
+  gridHeight = (mapHeight + tileSize - 1) / tileSize;
+
+  // "#rrggbb"
+  RJsonValue *settings = root.Get("settings");
+  RJsonValue *color = settings != NULL ? settings->Get("backgroundColor") : NULL;
+
+  if (color != NULL && color->GetString().size() == 7) {
+    long rgb = strtol(color->GetString().c_str() + 1, NULL, 16);
+
+    background.r = (rgb >> 16) & 0xFF;
+    background.g = (rgb >> 8) & 0xFF;
+    background.b = rgb & 0xFF;
+  }
+
+  // sheets are keyed by id; tiles refer to them that way
+  RJsonValue *sheetData = root.Get("spriteSheets");
+
+  if (sheetData == NULL || sheetData->GetType() != J_OBJECT) {
+    printf("%s: no spriteSheets\n", path);
+    return false;
+  }
+
+  std::vector<Uint8> png;
+
+  for (int i = 0; i < sheetData->GetSize(); ++i) {
+    // "data:image/png;base64,..."
+    const char *uri = sheetData->GetItem(i)->GetString().c_str();
+    const char *comma = strchr(uri, ',');
+
+    png.clear();
+    DecodeBase64(comma != NULL ? comma + 1 : uri, &png);
+
+    sheets.emplace_back();
+
+    if (!sheets.back().LoadFromMemory(renderer, png.data(), png.size())) {
+      printf("%s: sprite sheet %s won't load\n", path,
+             sheetData->GetKey(i).c_str());
+      Free();
+      return false;
+    }
+
+    sheetColumns.push_back(SDL_max(1, sheets.back().GetWidthUnscaled() /
+                                          tileSize));
+  }
+
+  RJsonValue *layerData = root.Get("layers");
+
+  if (layerData == NULL || layerData->GetType() != J_ARRAY) {
+    printf("%s: no layers\n", path);
+    Free();
+    return false;
+  }
+
+  // the editor doesn't keep its canvas origin at 0, 0; the map starts
+  // wherever its top left tile is
+  int originX = INT_MAX;
+  int originY = INT_MAX;
+
+  for (int i = 0; i < layerData->GetSize(); ++i) {
+    RJsonValue *tiles = layerData->GetItem(i)->Get("tiles");
+
+    for (int j = 0; tiles != NULL && j < tiles->GetSize(); ++j) {
+      RJsonValue *tile = tiles->GetItem(j);
+
+      if (tile->Get("x") != NULL && tile->Get("y") != NULL) {
+        originX = SDL_min(originX, tile->Get("x")->GetInt());
+        originY = SDL_min(originY, tile->Get("y")->GetInt());
+      }
+    }
+  }
+
+  if (originX == INT_MAX) {
+    originX = 0;
+    originY = 0;
+  }
+
+  int dropped = 0;
+
+  for (int i = 0; i < layerData->GetSize(); ++i) {
+    RTile empty = {-1, 0, false};
+
+    layers.emplace_back(gridWidth * gridHeight, empty);
+
+    RJsonValue *tiles = layerData->GetItem(i)->Get("tiles");
+
+    for (int j = 0; tiles != NULL && j < tiles->GetSize(); ++j) {
+      RJsonValue *tile = tiles->GetItem(j);
+
+      RJsonValue *id = tile->Get("id");
+      RJsonValue *x = tile->Get("x");
+      RJsonValue *y = tile->Get("y");
+      RJsonValue *sheetId = tile->Get("spriteSheetId");
+      RJsonValue *scaleX = tile->Get("scaleX");
+
+      if (id == NULL || x == NULL || y == NULL || sheetId == NULL) {
+        dropped++;
+        continue;
+      }
+
+      int sheet = -1;
+
+      for (int k = 0; k < sheetData->GetSize(); ++k) {
+        if (sheetData->GetKey(k) == sheetId->GetString()) {
+          sheet = k;
+          break;
+        }
+      }
+
+      int tileX = (x->GetInt() - originX) / tileSize;
+      int tileY = (y->GetInt() - originY) / tileSize;
+
+      if (sheet < 0 || tileX >= gridWidth || tileY >= gridHeight) {
+        dropped++;
+        continue;
+      }
+
+      RTile *cell = &layers.back()[tileY * gridWidth + tileX];
+
+      cell->sheet = sheet;
+      cell->index = id->GetInt();
+      cell->flip = scaleX != NULL && scaleX->GetNumber(1) < 0;
+    }
+  }
+
+  if (dropped > 0) {
+    printf("%s: skipped %d tiles that are off the map or incomplete\n", path,
+           dropped);
+  }
+
+  return true;
+}
+
+void RTileMap::Free() {
+  sheets.clear();
+  sheetColumns.clear();
+  layers.clear();
+}
+
+int RTileMap::GetTileSize() { return tileSize; }
+
+int RTileMap::GetGridWidth() { return gridWidth; }
+
+int RTileMap::GetGridHeight() { return gridHeight; }
+
+int RTileMap::GetWidth() { return gridWidth * tileSize; }
+
+int RTileMap::GetHeight() { return gridHeight * tileSize; }
+
+int RTileMap::GetLayerCount() { return layers.size(); }
+
+RTile *RTileMap::GetTile(int layer, int tileX, int tileY) {
+  if (tileX < 0 || tileX >= gridWidth || tileY < 0 || tileY >= gridHeight) {
+    return NULL;
+  }
+
+  return &layers[layer][tileY * gridWidth + tileX];
+}
+
+SDL_Color RTileMap::GetBackgroundColor() { return background; }
+
+void RTileMap::RenderTile(SDL_Renderer *renderer, RTile *tile, int x, int y) {
+  if (tile->sheet < 0) {
+    return;
+  }
+
+  int columns = sheetColumns[tile->sheet];
+
+  SDL_Rect clip = {(tile->index % columns) * tileSize,
+                   (tile->index / columns) * tileSize, tileSize, tileSize};
+
+  sheets[tile->sheet].Render(renderer, x, y, &clip, 0, NULL,
+                             tile->flip ? SDL_FLIP_HORIZONTAL : SDL_FLIP_NONE);
+}
@@ -7,6 +7,8 @@ RTimer::RTimer() {
 
 float RTimer::GetTime() { return timer; }
 
+bool RTimer::IsRunning() { return running; }
+
 void RTimer::Reset() { timer = 0; }
 
 void RTimer::Start() { running = true; }
@@ -0,0 +1,188 @@
+#include "RTimingWheel.hpp"
+
+#include <algorithm>
+
+const Uint64 WHEEL_SLOT_MASK = WHEEL_SLOTS - 1;
+
+// bytes per event in a snapshot
+const int SNAPSHOT_EVENT_BYTES = 2 * sizeof(Uint64) + sizeof(Uint8) +
+                                 sizeof(REntityHandle) + sizeof(int);
+
+// steps covered by one slot on the given level
+static Uint64 SlotSpan(int level) {
+  return (Uint64)1 << (level * WHEEL_SLOT_BITS);
+}
+
+static void SaveEvents(RSnapshotWriter *out, std::vector<REvent> &events) {
+  for (int i = 0; i < events.size(); ++i) {
+    out->Write(events[i].due);
+    out->Write(events[i].seq);
+    out->Write((Uint8)events[i].type);
+    out->Write(events[i].entity);
+    out->Write(events[i].a);
+  }
+}
+
+RTimingWheel::RTimingWheel() {
+  now = 0;
+  nextSeq = 0;
+  count = 0;
+}
+
+Uint64 RTimingWheel::GetNow() { return now; }
+
+int RTimingWheel::GetCount() { return count; }
+
+void RTimingWheel::Schedule(REventType type, Uint64 due, REntityHandle entity,
+                            int a) {
+  REvent event;
+
+  event.due = due > now ? due : now + 1;
+  event.seq = nextSeq++;
+  event.type = type;
+  event.entity = entity;
+  event.a = a;
+
+  Insert(&event);
+  count++;
+}
+
+void RTimingWheel::Advance(int steps, std::vector<REvent> &due) {
+  int first = due.size();
+
+  for (int i = 0; i < steps; ++i) {
+    now++;
+
+    // far off events get another look once per top level rotation
+    if (now % SlotSpan(WHEEL_LEVELS) == 0) {
+      cascading.swap(overflow);
+
+      for (int j = 0; j < cascading.size(); ++j) {
+        Insert(&cascading[j]);
+      }
+
+      cascading.clear();
+    }
+
+    // top down, so an event can fall through several levels in one step
+    for (int level = WHEEL_LEVELS - 1; level > 0; --level) {
+      if (now % SlotSpan(level) == 0) {
+        Cascade(level);
+      }
+    }
+
+    std::vector<REvent> &slot = slots[0][now & WHEEL_SLOT_MASK];
+
+    due.insert(due.end(), slot.begin(), slot.end());
+    count -= slot.size();
+    slot.clear();
+  }
+
+  // cascading reorders events within a slot; seq puts them back
+  std::sort(due.begin() + first, due.end(), [](const REvent &a, const REvent &b) {
+    return a.due != b.due ? a.due < b.due : a.seq < b.seq;
+  });
+}
+
+void RTimingWheel::GetEvents(std::vector<REvent> &events) {
+  for (int level = 0; level < WHEEL_LEVELS; ++level) {
+    for (int i = 0; i < WHEEL_SLOTS; ++i) {
+      events.insert(events.end(), slots[level][i].begin(),
+                    slots[level][i].end());
+    }
+  }
+
+  events.insert(events.end(), overflow.begin(), overflow.end());
+}
+
+void RTimingWheel::Clear() {
+  for (int level = 0; level < WHEEL_LEVELS; ++level) {
+    for (int i = 0; i < WHEEL_SLOTS; ++i) {
+      slots[level][i].clear();
+    }
+  }
+
+  overflow.clear();
+
+  now = 0;
+  nextSeq = 0;
+  count = 0;
+}
+
+void RTimingWheel::Save(RSnapshotWriter *out) {
+  out->Write(now);
+  out->Write(nextSeq);
+  out->Write((Sint32)count);
+
+  // where each event sits in the wheel doesn't matter; Load puts it back by
+  // its due step
+  for (int level = 0; level < WHEEL_LEVELS; ++level) {
+    for (int i = 0; i < WHEEL_SLOTS; ++i) {
+      SaveEvents(out, slots[level][i]);
+    }
+  }
+
+  SaveEvents(out, overflow);
+}
+
+bool RTimingWheel::Load(RSnapshotReader *in) {
+  Clear();
+
+  Sint32 nEvents = 0;
+
+  in->Read(&now);
+  in->Read(&nextSeq);
+
+  if (!in->Read(&nEvents) ||
+      !in->HasBytes((Sint64)nEvents * SNAPSHOT_EVENT_BYTES)) {
+    return false;
+  }
+
+  for (int i = 0; i < nEvents; ++i) {
+    REvent event;
+    Uint8 type = 0;
+
+    in->Read(&event.due);
+    in->Read(&event.seq);
+    in->Read(&type);
+    in->Read(&event.entity);
+    in->Read(&event.a);
+
+    if (!in->IsOk() || event.due <= now || type > EV_RETARGET) {
+      return false;
+    }
+
+    event.type = (REventType)type;
+
+    Insert(&event);
+    count++;
+  }
+
+  return true;
+}
+
+void RTimingWheel::Insert(REvent *event) {
+  // lowest level whose window still reaches the due step
+  for (int level = 0; level < WHEEL_LEVELS; ++level) {
+    int shift = level * WHEEL_SLOT_BITS;
+
+    if ((event->due >> shift) - (now >> shift) < WHEEL_SLOTS) {
+      slots[level][(event->due >> shift) & WHEEL_SLOT_MASK].push_back(*event);
+      return;
+    }
+  }
+
+  overflow.push_back(*event);
+}
+
+void RTimingWheel::Cascade(int level) {
+  int shift = level * WHEEL_SLOT_BITS;
+
+  cascading.swap(slots[level][(now >> shift) & WHEEL_SLOT_MASK]);
+
+  for (int i = 0; i < cascading.size(); ++i) {
+    Insert(&cascading[i]);
+  }
+
+  cascading.clear();
+}
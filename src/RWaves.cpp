@@ -0,0 +1,147 @@
+#include "RWaves.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+static bool ParseColor(const char *name, EnemyColor *color) {
+  if (strcmp(name, "red") == 0) {
+    *color = E_RED;
+  } else if (strcmp(name, "green") == 0) {
+    *color = E_GREEN;
+  } else if (strcmp(name, "yellow") == 0) {
+    *color = E_YELLOW;
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+static Uint64 HashBytes(Uint64 hash, const void *data, int nBytes) {
+  // fnv-1a, like the world's
+  const Uint8 *bytes = (const Uint8 *)data;
+
+  for (int i = 0; i < nBytes; ++i) {
+    hash = (hash ^ bytes[i]) * 1099511628211ull;
+  }
+
+  return hash;
+}
+
+RWaveSchedule::RWaveSchedule() {}
+
+bool RWaveSchedule::LoadFromFile(const char *path) {
+  FILE *file = fopen(path, "r");
+
+  if (file == NULL) {
+    printf("Could not open wave file %s!\n", path);
+    return false;
+  }
+
+  waves.clear();
+
+  char line[256];
+  int lineNumber = 0;
+  bool success = true;
+
+  while (success && fgets(line, sizeof(line), file) != NULL) {
+    lineNumber++;
+
+    // drop comments
+    char *comment = strchr(line, '#');
+    if (comment != NULL) {
+      *comment = '\0';
+    }
+
+    char word[32];
+    if (sscanf(line, "%31s", word) != 1) {
+      continue;
+    }
+
+    RWave wave;
+    RSpawnGroup group;
+
+    if (strcmp(word, "wave") == 0) {
+      if (sscanf(line, "%*s %f", &wave.delay) != 1 || wave.delay < 0) {
+        printf("%s:%d: expected wave <delay>\n", path, lineNumber);
+        success = false;
+        break;
+      }
+
+      waves.push_back(wave);
+      continue;
+    }
+
+    if (!ParseColor(word, &group.color)) {
+      printf("%s:%d: unknown tank color %s\n", path, lineNumber, word);
+      success = false;
+      break;
+    }
+
+    if (sscanf(line, "%*s %d %f %d", &group.count, &group.interval,
+               &group.path) != 3 ||
+        group.count < 0 || group.interval < 0 || group.path < 0) {
+      printf("%s:%d: expected <color> <count> <interval> <path>\n", path,
+             lineNumber);
+      success = false;
+      break;
+    }
+
+    if (waves.empty()) {
+      printf("%s:%d: spawn before the first wave\n", path, lineNumber);
+      success = false;
+      break;
+    }
+
+    waves.back().groups.push_back(group);
+  }
+
+  fclose(file);
+
+  if (!success) {
+    waves.clear();
+  }
+
+  return success;
+}
+
+std::vector<RWave> &RWaveSchedule::GetWaves() { return waves; }
+
+int RWaveSchedule::GetTankCount() {
+  int count = 0;
+
+  for (int i = 0; i < waves.size(); ++i) {
+    for (int j = 0; j < waves[i].groups.size(); ++j) {
+      count += waves[i].groups[j].count;
+    }
+  }
+
+  return count;
+}
+
+Uint64 RWaveSchedule::Hash() {
+  Uint64 hash = 14695981039346656037ull;
+
+  int nWaves = waves.size();
+  hash = HashBytes(hash, &nWaves, sizeof(nWaves));
+
+  // field by field; the structs have padding
+  for (int i = 0; i < nWaves; ++i) {
+    RWave &wave = waves[i];
+    int nGroups = wave.groups.size();
+
+    hash = HashBytes(hash, &wave.delay, sizeof(wave.delay));
+    hash = HashBytes(hash, &nGroups, sizeof(nGroups));
+
+    for (int j = 0; j < nGroups; ++j) {
+      RSpawnGroup &group = wave.groups[j];
+
+      hash = HashBytes(hash, &group.color, sizeof(group.color));
+      hash = HashBytes(hash, &group.count, sizeof(group.count));
+      hash = HashBytes(hash, &group.interval, sizeof(group.interval));
+      hash = HashBytes(hash, &group.path, sizeof(group.path));
+    }
+  }
+
+  return hash;
+}
@@ -0,0 +1,1338 @@
+#include "RWorld.hpp"
+
+#include "RMemory.hpp"
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+// how many items each parallel job gets
+const int ENTITY_GRAIN = 256;
+const int PROJECTILE_GRAIN = 1024;
+
+// used when nobody hands us a job system; runs every chunk on the caller
+static RJobSystem serialJobs(0);
+
+typedef struct RTankStats {
+  int health;
+  int fireRate;
+  RReal speed;
+} RTankStats;
+
+// indexed by EnemyColor
+// red is the all-rounder, green is quick but fragile, yellow slow and tough
+static const RTankStats TANK_STATS[] = {
+    {100, 8, 360},
+    {60, 6, 480},
+    {250, 4, 240},
+};
+
+// three tiles out; enough to cover the road from a tile or two away, and a
+// targeting query box only takes in a few cells each way
+const int TOWER_RANGE = TILE_WIDTH * 3;
+
+RWorld::RWorld() {
+  tick = 0;
+
+  amtRed = 999;
+  amtGreen = 999;
+  amtYellow = 999;
+
+  // aim at level center until the player clicks somewhere
+  enemyTargetX = LEVEL_WIDTH / 2;
+  enemyTargetY = LEVEL_HEIGHT / 2;
+  selectedTower = NULL_HANDLE;
+
+  defenderMaxHealth = 5;
+  defenderHealth = defenderMaxHealth;
+
+  jobs = &serialJobs;
+
+  enemyGrid.Resize(LEVEL_WIDTH, LEVEL_HEIGHT, TILE_WIDTH);
+  towerGrid.Resize(LEVEL_WIDTH, LEVEL_HEIGHT, TILE_WIDTH);
+  towerTiles.Resize(LEVEL_GRID_WIDTH, LEVEL_GRID_HEIGHT, TILE_WIDTH,
+                    TILE_HEIGHT);
+
+  // towers reconsider a few times a second; the tile grid is fine here too
+  targeting.Resize(LEVEL_WIDTH, LEVEL_HEIGHT, TILE_WIDTH);
+  towerPolicy = T_FIRST;
+  retargetInterval = 0.25;
+  retargetGeneration = 0;
+}
+
+RWorld::RWorld(const RWorld &other) : RWorld() { *this = other; }
+
+RWorld &RWorld::operator=(const RWorld &other) {
+  if (this == &other) {
+    return *this;
+  }
+
+  tick = other.tick;
+  paths = other.paths;
+  spawnGroups = other.spawnGroups;
+
+  amtRed = other.amtRed;
+  amtGreen = other.amtGreen;
+  amtYellow = other.amtYellow;
+
+  enemyTargetX = other.enemyTargetX;
+  enemyTargetY = other.enemyTargetY;
+  selectedTower = other.selectedTower;
+
+  defenderMaxHealth = other.defenderMaxHealth;
+  defenderHealth = other.defenderHealth;
+
+  random = other.random;
+  towerPolicy = other.towerPolicy;
+  retargetInterval = other.retargetInterval;
+  retargetGeneration = other.retargetGeneration;
+
+  sounds.clear();
+  effects.clear();
+
+  // the pool copies slot for slot, so every handle (locked targets,
+  // projectile issuers) means the same thing in the copy; only the lists
+  // need pointing at the copy's entities
+  entities = other.entities;
+
+  for (int pass = 0; pass < 2; ++pass) {
+    const std::vector<REntity *> &source = pass == 0 ? other.enemies
+                                                     : other.towers;
+    std::vector<REntity *> &dest = pass == 0 ? enemies : towers;
+
+    dest.clear();
+
+    for (int i = 0; i < source.size(); ++i) {
+      dest.push_back(entities.Get(source[i]->GetHandle()));
+    }
+  }
+
+  towerTiles = other.towerTiles;
+
+  projectiles = other.projectiles;
+  scheduler = other.scheduler;
+
+  return *this;
+}
+
+Uint64 RWorld::GetTick() { return tick; }
+
+int RWorld::GetDefenderHealth() { return defenderHealth; }
+
+int RWorld::GetEnemyAmount(EnemyColor color) {
+  switch (color) {
+  case E_RED:
+    return amtRed;
+  case E_GREEN:
+    return amtGreen;
+  case E_YELLOW:
+    return amtYellow;
+  default:
+    return 0;
+  }
+}
+
+static Uint64 HashBytes(Uint64 hash, const void *data, int nBytes) {
+  // fnv-1a
+  const Uint8 *bytes = (const Uint8 *)data;
+
+  for (int i = 0; i < nBytes; ++i) {
+    hash = (hash ^ bytes[i]) * 1099511628211ull;
+  }
+
+  return hash;
+}
+
+Uint64 RWorld::Hash() {
+  Uint64 hash = 14695981039346656037ull;
+
+  Uint64 randomState = random.GetState();
+
+  hash = HashBytes(hash, &tick, sizeof(tick));
+  hash = HashBytes(hash, &randomState, sizeof(randomState));
+  hash = HashBytes(hash, &defenderHealth, sizeof(defenderHealth));
+  hash = HashBytes(hash, &amtRed, sizeof(amtRed));
+  hash = HashBytes(hash, &amtGreen, sizeof(amtGreen));
+  hash = HashBytes(hash, &amtYellow, sizeof(amtYellow));
+  hash = HashBytes(hash, &enemyTargetX, sizeof(enemyTargetX));
+  hash = HashBytes(hash, &enemyTargetY, sizeof(enemyTargetY));
+  hash = HashBytes(hash, &selectedTower, sizeof(selectedTower));
+  hash = HashBytes(hash, &towerPolicy, sizeof(towerPolicy));
+  hash = HashBytes(hash, &retargetGeneration, sizeof(retargetGeneration));
+
+  int nGroups = spawnGroups.size();
+
+  hash = HashBytes(hash, &nGroups, sizeof(nGroups));
+
+  for (int i = 0; i < nGroups; ++i) {
+    hash = HashBytes(hash, &spawnGroups[i].startStep,
+                     sizeof(spawnGroups[i].startStep));
+    hash = HashBytes(hash, &spawnGroups[i].spawned,
+                     sizeof(spawnGroups[i].spawned));
+  }
+
+  for (int pass = 0; pass < 2; ++pass) {
+    std::vector<REntity *> &list = pass == 0 ? enemies : towers;
+
+    for (int i = 0; i < list.size(); ++i) {
+      int posX = list[i]->GetPosX();
+      int posY = list[i]->GetPosY();
+      int health = list[i]->GetHealth();
+      RReal progress = list[i]->GetPathProgress();
+      RReal angle = list[i]->GetWeaponAngle();
+
+      hash = HashBytes(hash, &posX, sizeof(posX));
+      hash = HashBytes(hash, &posY, sizeof(posY));
+      hash = HashBytes(hash, &health, sizeof(health));
+      hash = HashBytes(hash, &progress, sizeof(progress));
+      hash = HashBytes(hash, &angle, sizeof(angle));
+    }
+  }
+
+  int nProjectiles = projectiles.GetCount();
+
+  hash = HashBytes(hash, &nProjectiles, sizeof(nProjectiles));
+  hash = HashBytes(hash, projectiles.GetPosX(), nProjectiles * sizeof(Sint32));
+  hash = HashBytes(hash, projectiles.GetPosY(), nProjectiles * sizeof(Sint32));
+  hash = HashBytes(hash, projectiles.GetVelX(), nProjectiles * sizeof(Sint32));
+  hash = HashBytes(hash, projectiles.GetVelY(), nProjectiles * sizeof(Sint32));
+  hash = HashBytes(hash, projectiles.GetDamage(), nProjectiles * sizeof(int));
+  hash = HashBytes(hash, projectiles.GetIssuer(),
+                   nProjectiles * sizeof(REntityHandle));
+  hash = HashBytes(hash, projectiles.GetIssuerKind(),
+                   nProjectiles * sizeof(EntityKind));
+
+  // where an event sits in the wheel depends on how it got there, so each
+  // one is hashed on its own and the results summed, which doesn't care
+  // about order; field by field, since REvent has padding
+  snapshotEvents.clear();
+  scheduler.GetEvents(snapshotEvents);
+
+  Uint64 now = scheduler.GetNow();
+  Uint64 events = 0;
+
+  for (int i = 0; i < snapshotEvents.size(); ++i) {
+    REvent &event = snapshotEvents[i];
+    Uint64 eventHash = 14695981039346656037ull;
+
+    eventHash = HashBytes(eventHash, &event.due, sizeof(event.due));
+    eventHash = HashBytes(eventHash, &event.seq, sizeof(event.seq));
+    eventHash = HashBytes(eventHash, &event.type, sizeof(event.type));
+    eventHash = HashBytes(eventHash, &event.entity, sizeof(event.entity));
+    eventHash = HashBytes(eventHash, &event.a, sizeof(event.a));
+
+    events += eventHash;
+  }
+
+  hash = HashBytes(hash, &now, sizeof(now));
+  hash = HashBytes(hash, &events, sizeof(events));
+
+  return hash;
+}
+
+void RWorld::Seed(Uint32 seed) { random.Seed(seed); }
+
+// bytes per projectile in a snapshot
+const int SNAPSHOT_PROJECTILE_BYTES = sizeof(REntityHandle) +
+                                      4 * sizeof(Sint32) + sizeof(int) +
+                                      sizeof(EntityKind);
+
+static_assert(sizeof(EntityKind) == sizeof(int),
+              "snapshots store projectile kinds as ints");
+
+// bytes per spawn group in a snapshot
+const int SNAPSHOT_SPAWN_GROUP_BYTES = sizeof(Uint8) + sizeof(int) +
+                                       sizeof(float) + sizeof(int) +
+                                       sizeof(Uint64) + sizeof(int);
+
+void RWorld::Save(std::vector<Uint8> *out) {
+  out->clear();
+
+  RSnapshotWriter writer(out);
+
+  writer.WriteHeader();
+
+  writer.Write(tick);
+  writer.Write(random.GetState());
+
+  writer.Write(amtRed);
+  writer.Write(amtGreen);
+  writer.Write(amtYellow);
+
+  writer.Write(enemyTargetX);
+  writer.Write(enemyTargetY);
+  writer.Write(selectedTower);
+
+  writer.Write(defenderMaxHealth);
+  writer.Write(defenderHealth);
+
+  writer.Write((Uint8)towerPolicy);
+  writer.Write(retargetInterval);
+  writer.Write(retargetGeneration);
+
+  // the pool goes out whole, free slots and generations included, so every
+  // handle written anywhere stays valid as is
+  entities.Save(&writer);
+
+  writer.Write((Sint32)spawnGroups.size());
+
+  for (int i = 0; i < spawnGroups.size(); ++i) {
+    writer.Write((Uint8)spawnGroups[i].group.color);
+    writer.Write(spawnGroups[i].group.count);
+    writer.Write(spawnGroups[i].group.interval);
+    writer.Write(spawnGroups[i].group.path);
+    writer.Write(spawnGroups[i].startStep);
+    writer.Write(spawnGroups[i].spawned);
+  }
+
+  for (int pass = 0; pass < 2; ++pass) {
+    std::vector<REntity *> &list = pass == 0 ? enemies : towers;
+
+    snapshotHandles.clear();
+
+    for (int i = 0; i < list.size(); ++i) {
+      snapshotHandles.push_back(list[i]->GetHandle());
+    }
+
+    writer.Write((Sint32)list.size());
+    writer.WriteBytes(snapshotHandles.data(),
+                      snapshotHandles.size() * sizeof(REntityHandle));
+  }
+
+  scheduler.Save(&writer);
+
+  // projectiles go out as the raw arrays
+  int nProjectiles = projectiles.GetCount();
+
+  writer.Write((Sint32)nProjectiles);
+  writer.WriteBytes(projectiles.GetIssuer(),
+                    nProjectiles * sizeof(REntityHandle));
+  writer.WriteBytes(projectiles.GetPosX(), nProjectiles * sizeof(Sint32));
+  writer.WriteBytes(projectiles.GetPosY(), nProjectiles * sizeof(Sint32));
+  writer.WriteBytes(projectiles.GetVelX(), nProjectiles * sizeof(Sint32));
+  writer.WriteBytes(projectiles.GetVelY(), nProjectiles * sizeof(Sint32));
+  writer.WriteBytes(projectiles.GetDamage(), nProjectiles * sizeof(int));
+  writer.WriteBytes(projectiles.GetIssuerKind(),
+                    nProjectiles * sizeof(EntityKind));
+}
+
+bool RWorld::Restore(const Uint8 *data, int size) {
+  RMemScope scope(MEM_WORLD);
+
+  RSnapshotReader in(data, size);
+
+  if (!in.ReadHeader()) {
+    return false;
+  }
+
+  Uint64 newTick = 0;
+  Uint64 randomState = 0;
+  int newAmts[3] = {0, 0, 0};
+  int newTarget[2] = {0, 0};
+  REntityHandle newSelected = NULL_HANDLE;
+  int newDefender[2] = {0, 0};
+  Uint8 newPolicy = 0;
+  float newInterval = 0;
+  int newGeneration = 0;
+
+  in.Read(&newTick);
+  in.Read(&randomState);
+  in.Read(&newAmts[0]);
+  in.Read(&newAmts[1]);
+  in.Read(&newAmts[2]);
+  in.Read(&newTarget[0]);
+  in.Read(&newTarget[1]);
+  in.Read(&newSelected);
+  in.Read(&newDefender[0]);
+  in.Read(&newDefender[1]);
+  in.Read(&newPolicy);
+  in.Read(&newInterval);
+  in.Read(&newGeneration);
+
+  if (newPolicy > T_STRONGEST) {
+    printf("Snapshot has an unknown tower policy!\n");
+    return false;
+  }
+
+  if (!IsEventSeconds(newInterval)) {
+    printf("Snapshot has a bad retarget interval!\n");
+    return false;
+  }
+
+  // load into a pool on the side so a bad snapshot changes nothing
+  REntityPool loaded;
+  std::vector<REntity *> lists[2];
+
+  bool ok = in.IsOk() && loaded.Load(&in, paths);
+
+  // spawn groups still going
+  Sint32 nGroups = 0;
+  std::vector<RActiveSpawn> loadedGroups;
+
+  ok = ok && in.Read(&nGroups) && nGroups >= 0 &&
+       in.HasBytes((Sint64)nGroups * SNAPSHOT_SPAWN_GROUP_BYTES);
+
+  for (int i = 0; i < nGroups && ok; ++i) {
+    RActiveSpawn spawn;
+    Uint8 color = 0;
+
+    in.Read(&color);
+    in.Read(&spawn.group.count);
+    in.Read(&spawn.group.interval);
+    in.Read(&spawn.group.path);
+    in.Read(&spawn.startStep);
+    in.Read(&spawn.spawned);
+
+    spawn.group.color = (EnemyColor)color;
+    loadedGroups.push_back(spawn);
+
+    ok = in.IsOk() && IsEnemyColor(color) && spawn.group.path >= 0 &&
+         spawn.group.path < paths.size();
+  }
+
+  // every slot is free or in exactly one list; anything in two places would
+  // be updated by two chunks at once and freed twice
+  std::vector<Uint8> slotTaken;
+
+  if (ok) {
+    const std::vector<Uint32> &freeSlots = loaded.GetFreeSlots();
+
+    slotTaken.assign(loaded.GetCapacity(), 0);
+
+    for (int i = 0; i < freeSlots.size(); ++i) {
+      slotTaken[freeSlots[i]] = 1;
+    }
+  }
+
+  for (int pass = 0; pass < 2 && ok; ++pass) {
+    Sint32 count = 0;
+
+    ok = in.Read(&count) &&
+         in.HasBytes((Sint64)count * sizeof(REntityHandle));
+
+    for (int i = 0; i < count && ok; ++i) {
+      REntityHandle handle;
+
+      in.Read(&handle);
+
+      REntity *entity = loaded.Get(handle);
+
+      lists[pass].push_back(entity);
+      // enemies are tanks and towers are towers
+      ok = entity != NULL && entity->GetKind() == (pass == 0 ? TANK : TOWER) &&
+           !slotTaken[handle.index] &&
+           IsEventSeconds(1 / entity->GetFireRate());
+
+      if (ok) {
+        slotTaken[handle.index] = 1;
+      }
+    }
+  }
+
+  // and nobody live is left out of both
+  for (int i = 0; i < slotTaken.size() && ok; ++i) {
+    ok = slotTaken[i];
+  }
+
+  RTimingWheel loadedScheduler;
+
+  ok = ok && loadedScheduler.Load(&in);
+
+  // spawn events point into the spawn groups
+  snapshotEvents.clear();
+
+  if (ok) {
+    loadedScheduler.GetEvents(snapshotEvents);
+  }
+
+  for (int i = 0; i < snapshotEvents.size() && ok; ++i) {
+    REvent &event = snapshotEvents[i];
+
+    ok = event.type != EV_SPAWN_GROUP ||
+         (event.a >= 0 && event.a < loadedGroups.size());
+  }
+
+  Sint32 nProjectiles = 0;
+  RProjectileStore loadedProjectiles;
+
+  if (ok) {
+    ok = in.Read(&nProjectiles) &&
+         in.HasBytes((Sint64)nProjectiles * SNAPSHOT_PROJECTILE_BYTES);
+  }
+
+  // sizes were checked above, so these can't run short
+  if (ok) {
+    loadedProjectiles.Resize(nProjectiles);
+
+    in.ReadBytes(loadedProjectiles.GetIssuer(),
+                 nProjectiles * sizeof(REntityHandle));
+    in.ReadBytes(loadedProjectiles.GetPosX(), nProjectiles * sizeof(Sint32));
+    in.ReadBytes(loadedProjectiles.GetPosY(), nProjectiles * sizeof(Sint32));
+    in.ReadBytes(loadedProjectiles.GetVelX(), nProjectiles * sizeof(Sint32));
+    in.ReadBytes(loadedProjectiles.GetVelY(), nProjectiles * sizeof(Sint32));
+    in.ReadBytes(loadedProjectiles.GetDamage(), nProjectiles * sizeof(int));
+    in.ReadBytes(loadedProjectiles.GetIssuerKind(),
+                 nProjectiles * sizeof(EntityKind));
+  }
+
+  // looked at as the ints they were written as; they aren't kinds yet
+  for (int i = 0; i < nProjectiles && ok; ++i) {
+    int kind = 0;
+    memcpy(&kind, &loadedProjectiles.GetIssuerKind()[i], sizeof(kind));
+
+    ok = kind == TANK || kind == TOWER;
+  }
+
+  if (!ok) {
+    printf("Snapshot is truncated or corrupt!\n");
+    return false;
+  }
+
+  // everything checked out; swap it in
+  tick = newTick;
+  random.SetState(randomState);
+
+  amtRed = newAmts[0];
+  amtGreen = newAmts[1];
+  amtYellow = newAmts[2];
+
+  enemyTargetX = newTarget[0];
+  enemyTargetY = newTarget[1];
+  selectedTower = newSelected;
+
+  defenderMaxHealth = newDefender[0];
+  defenderHealth = newDefender[1];
+
+  towerPolicy = (RTargetPolicy)newPolicy;
+  retargetInterval = newInterval;
+  retargetGeneration = newGeneration;
+
+  sounds.clear();
+  effects.clear();
+
+  // moving the pool keeps its entities where they are, so the lists built
+  // against it stay good
+  entities = std::move(loaded);
+
+  enemies.swap(lists[0]);
+  towers.swap(lists[1]);
+
+  RebuildTiles();
+
+  scheduler = loadedScheduler;
+  spawnGroups.swap(loadedGroups);
+
+  projectiles = loadedProjectiles;
+
+  return true;
+}
+
+bool RWorld::SaveSnapshot(const char *path) {
+  std::vector<Uint8> data;
+  Save(&data);
+
+  // write next to it and swap it in, so a crash mid-write never leaves a
+  // half written snapshot behind
+  std::string tmpPath = std::string(path) + ".tmp";
+
+  FILE *file = fopen(tmpPath.c_str(), "wb");
+
+  if (file == NULL) {
+    printf("Could not open %s for writing!\n", tmpPath.c_str());
+    return false;
+  }
+
+  bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+
+  if (fclose(file) != 0 || !written) {
+    printf("Could not write snapshot %s!\n", tmpPath.c_str());
+    remove(tmpPath.c_str());
+    return false;
+  }
+
+  if (rename(tmpPath.c_str(), path) != 0) {
+    printf("Could not replace snapshot %s!\n", path);
+    remove(tmpPath.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+bool RWorld::LoadSnapshot(const char *path) {
+  FILE *file = fopen(path, "rb");
+
+  if (file == NULL) {
+    printf("Could not open snapshot %s!\n", path);
+    return false;
+  }
+
+  std::vector<Uint8> data;
+  Uint8 buffer[4096];
+  size_t nRead;
+
+  while ((nRead = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    data.insert(data.end(), buffer, buffer + nRead);
+  }
+
+  fclose(file);
+
+  return Restore(data.data(), data.size());
+}
+
+void RWorld::SetPath(RPath *path) { paths.assign(1, path); }
+
+int RWorld::AddPath(RPath *path) {
+  paths.push_back(path);
+
+  return paths.size() - 1;
+}
+
+void RWorld::SetJobSystem(RJobSystem *jobs) {
+  this->jobs = jobs != NULL ? jobs : &serialJobs;
+}
+
+void RWorld::SetTowerTargeting(RTargetPolicy policy, float retargetInterval) {
+  this->towerPolicy = policy;
+  this->retargetInterval = retargetInterval;
+
+  // looks already on the wheel are at the old interval; start over
+  retargetGeneration++;
+
+  for (int i = 0; i < towers.size(); ++i) {
+    towers[i]->SetTargetPolicy(policy);
+    ScheduleRetarget(towers[i], i);
+  }
+}
+
+RTargetPolicy RWorld::GetTowerPolicy() { return towerPolicy; }
+
+float RWorld::GetRetargetInterval() { return retargetInterval; }
+
+void RWorld::HandleCommand(RCommand *command) {
+  switch (command->type) {
+  case C_SPAWN_ENEMY:
+    // commands come from the other side of a network game or a replay file;
+    // every peer turns the same bad ones away, so they stay in sync
+    if (!IsEnemyColor(command->a)) {
+      printf("Unknown enemy color %d!\n", command->a);
+      break;
+    }
+
+    SpawnEnemy((EnemyColor)command->a);
+    break;
+  case C_SET_TARGET:
+    SetEnemyTarget(command->a, command->b);
+    break;
+  default:
+    printf("Unknown command %d!\n", command->type);
+    break;
+  }
+}
+
+void RWorld::SpawnEnemy(EnemyColor color) {
+  int *amt = color == E_RED     ? &amtRed
+             : color == E_GREEN ? &amtGreen
+                                : &amtYellow;
+
+  if (*amt <= 0 || paths.empty()) {
+    return;
+  }
+
+  SpawnTank(color, 0);
+
+  // now have one less enemy!
+  (*amt)--;
+}
+
+void RWorld::SpawnTank(EnemyColor color, int pathId) {
+  if (!IsEnemyColor(color) || pathId < 0 || pathId >= paths.size()) {
+    printf("Can't spawn a tank of color %d on path %d!\n", color, pathId);
+    return;
+  }
+
+  const RTankStats *stats = &TANK_STATS[color];
+
+  REntity *newEnemy = entities.Get(entities.Create(TANK));
+
+  newEnemy->SetColor(color);
+
+  // give path; this also places it at the beginning
+  newEnemy->SetPath(paths[pathId], pathId);
+  newEnemy->UpdateRect();
+
+  // set properties
+  newEnemy->SetMaxHealth(stats->health);
+  newEnemy->SetFireRate(stats->fireRate);
+  newEnemy->SetSpeed(stats->speed);
+
+  // first shot one full interval from now
+  scheduler.Schedule(EV_FIRE, scheduler.GetNow() + GetFireInterval(newEnemy),
+                     newEnemy->GetHandle());
+
+  // add enemy to reg
+  enemies.push_back(newEnemy);
+}
+
+bool RWorld::SpawnTower(int gridX, int gridY) {
+  if (!towerTiles.IsFree(gridX, gridY)) {
+    return false;
+  }
+
+  REntity *newTower = entities.Get(entities.Create(TOWER));
+
+  towerTiles.Claim(gridX, gridY, newTower->GetHandle());
+
+  // amplify pos to px scale
+  // center pos over tile too; sprites render centered
+  gridX = gridX * TILE_WIDTH + TILE_WIDTH / 2;
+  gridY = gridY * TILE_HEIGHT + TILE_HEIGHT / 2;
+
+  // spawn tower in coords relative to grid
+  newTower->SetPos(gridX, gridY);
+  newTower->UpdateRect();
+
+  // a small, random head start on the first shot
+  Uint64 headStart = random.Range(100) * STEPS_PER_SECOND / 100;
+
+  newTower->SetFireRate(5);
+  newTower->SetProjectileSpeed(14);
+  newTower->SetRange(TOWER_RANGE);
+
+  Uint64 firstShot = scheduler.GetNow() + GetFireInterval(newTower);
+  scheduler.Schedule(EV_FIRE, firstShot > headStart ? firstShot - headStart : 0,
+                     newTower->GetHandle());
+
+  newTower->SetTargetPolicy(towerPolicy);
+  ScheduleRetarget(newTower, towers.size());
+
+  towers.push_back(newTower);
+
+  return true;
+}
+
+void RWorld::SpawnTowers(int nTowers) {
+  // random free tiles; give up eventually in case the grid is (nearly) full
+  int attempts = nTowers * 8;
+
+  while (nTowers > 0 && attempts > 0) {
+    int gridX = random.Range(LEVEL_GRID_WIDTH);
+    int gridY = random.Range(LEVEL_GRID_HEIGHT);
+
+    if (SpawnTower(gridX, gridY)) {
+      nTowers--;
+    }
+
+    attempts--;
+  }
+}
+
+void RWorld::StartWaves(RWaveSchedule *schedule) {
+  std::vector<RWave> &waves = schedule->GetWaves();
+
+  // make room for everyone up front so spawning never has to grow anything
+  int nTanks = schedule->GetTankCount();
+
+  entities.Reserve(entities.GetCount() + nTanks);
+  enemies.reserve(enemies.size() + nTanks);
+
+  double waveEnd = scheduler.GetNow();
+
+  for (int i = 0; i < waves.size(); ++i) {
+    double waveStart = waveEnd + waves[i].delay * STEPS_PER_SECOND;
+
+    waveEnd = waveStart;
+
+    for (int j = 0; j < waves[i].groups.size(); ++j) {
+      RActiveSpawn spawn;
+
+      spawn.group = waves[i].groups[j];
+      spawn.startStep = SDL_lround(waveStart);
+      spawn.spawned = 0;
+
+      if (spawn.group.count <= 0) {
+        continue;
+      }
+
+      if (spawn.group.path >= paths.size()) {
+        printf("Wave %d wants path %d, there are only %d!\n", i,
+               spawn.group.path, (int)paths.size());
+        continue;
+      }
+
+      spawnGroups.push_back(spawn);
+
+      scheduler.Schedule(EV_SPAWN_GROUP, spawn.startStep, NULL_HANDLE,
+                         spawnGroups.size() - 1);
+
+      double groupEnd = spawn.startStep + GetSpawnOffset(&spawn,
+                                                         spawn.group.count - 1);
+
+      if (groupEnd > waveEnd) {
+        waveEnd = groupEnd;
+      }
+    }
+  }
+}
+
+void RWorld::SetEnemyTarget(int x, int y) {
+  // snap to whichever tower was clicked, if any, and keep it selected so the
+  // target can be dropped once it's gone
+  selectedTower = NULL_HANDLE;
+
+  REntity *tower = GetTowerAt(x, y);
+
+  if (tower != NULL && REntity::CheckCollision(tower->GetRect(), x, y)) {
+    x = tower->GetPosX();
+    y = tower->GetPosY();
+    selectedTower = tower->GetHandle();
+  }
+
+  enemyTargetX = x;
+  enemyTargetY = y;
+}
+
+REntity *RWorld::GetTowerAt(int x, int y) {
+  int tileX, tileY;
+
+  if (!towerTiles.TileAt(x, y, &tileX, &tileY)) {
+    return NULL;
+  }
+
+  return entities.Get(towerTiles.Get(tileX, tileY));
+}
+
+void RWorld::Tick(float dt) {
+  RMemScope scope(MEM_WORLD);
+
+  // collisions are swept along the whole move, so big ticks don't let shots
+  // skip through anything
+  int steps = SDL_lroundf(dt * STEPS_PER_SECOND);
+
+  if (steps < 1) {
+    steps = 1;
+  }
+
+  ClearFinishedEnemies();
+
+  UpdateProjectiles(steps);
+  CheckProjectileCollisions(steps);
+
+  UpdateEnemies(dt);
+  UpdateTowers();
+
+  RunEvents(steps);
+
+  tick++;
+}
+
+void RWorld::BuildDrawList(RDrawList *list) {
+  list->Clear();
+
+  list->tick = tick;
+
+  Sint32 *posX = projectiles.GetPosX();
+  Sint32 *posY = projectiles.GetPosY();
+  EntityKind *issuerKind = projectiles.GetIssuerKind();
+
+  for (int i = 0; i < projectiles.GetCount(); ++i) {
+    RProjectileDrawItem item;
+
+    item.posX = posX[i];
+    item.posY = posY[i];
+    item.issuerKind = issuerKind[i];
+
+    list->projectiles.push_back(item);
+  }
+
+  for (int pass = 0; pass < 2; ++pass) {
+    std::vector<REntity *> &source = pass == 0 ? enemies : towers;
+    std::vector<REntityDrawItem> &dest =
+        pass == 0 ? list->enemies : list->towers;
+
+    for (int i = 0; i < source.size(); ++i) {
+      REntity *entity = source[i];
+      REntityDrawItem item;
+
+      item.kind = entity->GetKind();
+      item.color = entity->GetColor();
+      item.posX = entity->GetPosX();
+      item.posY = entity->GetPosY();
+      item.weaponAngle = (float)entity->GetWeaponAngle();
+      item.health = entity->GetHealth();
+      item.maxHealth = entity->GetMaxHealth();
+
+      dest.push_back(item);
+    }
+  }
+
+  // as much room as ours, so the list only grows when they do
+  list->sounds.reserve(sounds.capacity());
+  list->effects.reserve(effects.capacity());
+
+  list->sounds.insert(list->sounds.end(), sounds.begin(), sounds.end());
+  sounds.clear();
+
+  list->effects.insert(list->effects.end(), effects.begin(), effects.end());
+  effects.clear();
+
+  list->enemyTargetX = enemyTargetX;
+  list->enemyTargetY = enemyTargetY;
+
+  list->defenderHealth = defenderHealth;
+
+  list->amtRed = amtRed;
+  list->amtGreen = amtGreen;
+  list->amtYellow = amtYellow;
+}
+
+void RWorld::ParallelFor(int count, int grain, const RJobFunc &func) {
+  jobs->ParallelFor(count, grain, func);
+}
+
+void RWorld::PrepareChunks(int nChunks) {
+  // a chunk can't hit or ready more than it has in it, so those never need
+  // to grow again; no allocations in the middle of a tick
+  for (int i = chunkHits.size(); i < nChunks; ++i) {
+    chunkHits.emplace_back();
+    chunkReady.emplace_back();
+    chunkQueries.emplace_back();
+
+    chunkHits[i].reserve(PROJECTILE_GRAIN);
+    chunkReady[i].reserve(ENTITY_GRAIN);
+  }
+
+  for (int i = 0; i < nChunks; ++i) {
+    chunkHits[i].clear();
+    chunkReady[i].clear();
+  }
+}
+
+void RWorld::ReserveQueries(int nChunks, int most) {
+  // half as much again, so a wave coming out doesn't reallocate every tick it
+  // gets a little bigger
+  for (int i = 0; i < nChunks; ++i) {
+    if (chunkQueries[i].capacity() < most) {
+      chunkQueries[i].reserve(most + most / 2);
+    }
+  }
+}
+
+Uint64 RWorld::GetFireInterval(REntity *entity) {
+  Uint64 interval = SDL_lroundf(STEPS_PER_SECOND / entity->GetFireRate());
+
+  return interval > 0 ? interval : 1;
+}
+
+void RWorld::FireWeapon(REntity *entity, Uint64 due) {
+  RProjectileSpawn fired;
+
+  entity->Fire(&fired);
+  projectiles.Add(&fired);
+
+  // next shot goes off the step this one was due, not when it actually got
+  // handled, so big ticks keep the same cadence
+  scheduler.Schedule(EV_FIRE, due + GetFireInterval(entity),
+                     entity->GetHandle());
+}
+
+Uint64 RWorld::GetRetargetSteps() {
+  Uint64 steps = SDL_lroundf(retargetInterval * STEPS_PER_SECOND);
+
+  return steps > 0 ? steps : 1;
+}
+
+void RWorld::ScheduleRetarget(REntity *tower, int index) {
+  // eight phases over the interval, by index
+  Uint64 steps = GetRetargetSteps();
+  Uint64 early = (index % 8) * steps / 8;
+
+  scheduler.Schedule(EV_RETARGET, scheduler.GetNow() + steps - early,
+                     tower->GetHandle(), retargetGeneration);
+}
+
+Uint64 RWorld::GetSpawnOffset(RActiveSpawn *spawn, int index) {
+  return (Uint64)(index * (double)spawn->group.interval * STEPS_PER_SECOND);
+}
+
+void RWorld::SpawnGroup(int index) {
+  RActiveSpawn *spawn = &spawnGroups[index];
+  Uint64 now = scheduler.GetNow();
+
+  // everyone whose time has come; at short intervals that's a whole batch
+  // per step, all from the one event
+  while (spawn->spawned < spawn->group.count &&
+         spawn->startStep + GetSpawnOffset(spawn, spawn->spawned) <= now) {
+    SpawnTank(spawn->group.color, spawn->group.path);
+    spawn->spawned++;
+  }
+
+  if (spawn->spawned < spawn->group.count) {
+    scheduler.Schedule(EV_SPAWN_GROUP,
+                       spawn->startStep + GetSpawnOffset(spawn, spawn->spawned),
+                       NULL_HANDLE, index);
+  }
+}
+
+void RWorld::RunEvents(int steps) {
+  dueEvents.clear();
+
+  // nothing can come due that isn't already waiting; half as much again so
+  // a wave coming out doesn't reallocate every tick it gets a little bigger
+  int waiting = scheduler.GetCount();
+
+  if (dueEvents.capacity() < waiting) {
+    dueEvents.reserve(waiting + waiting / 2);
+  }
+
+  scheduler.Advance(steps, dueEvents);
+
+  bool enemyFired = false;
+  bool towerFired = false;
+
+  for (int i = 0; i < dueEvents.size(); ++i) {
+    REvent &event = dueEvents[i];
+
+    switch (event.type) {
+    case EV_FIRE: {
+      REntity *entity = entities.Get(event.entity);
+
+      // whoever it was is gone; the event goes with them
+      if (entity == NULL) {
+        break;
+      }
+
+      // towers hold fire until they have something to aim at
+      if (entity->GetKind() == TOWER &&
+          entities.Get(entity->GetLockedTarget()) == NULL) {
+        entity->SetWeaponReady(true);
+        break;
+      }
+
+      FireWeapon(entity, event.due);
+
+      enemyFired |= entity->GetKind() == TANK;
+      towerFired |= entity->GetKind() == TOWER;
+      break;
+    }
+    case EV_SPAWN_GROUP:
+      SpawnGroup(event.a);
+      break;
+    case EV_RETARGET: {
+      REntity *tower = entities.Get(event.entity);
+
+      if (tower == NULL || event.a != retargetGeneration) {
+        break;
+      }
+
+      // picked up by the next UpdateTowers, which does it in parallel
+      tower->SetRetargetDue(true);
+
+      scheduler.Schedule(EV_RETARGET, event.due + GetRetargetSteps(),
+                         tower->GetHandle(), retargetGeneration);
+      break;
+    }
+    default:
+      printf("Unknown event %d!\n", event.type);
+      break;
+    }
+  }
+
+  if (enemyFired) {
+    sounds.push_back(S_SHOOT_ENEMY);
+  }
+
+  if (towerFired) {
+    sounds.push_back(S_SHOOT_TOWER);
+  }
+}
+
+void RWorld::DiscardEffects() {
+  sounds.clear();
+  effects.clear();
+}
+
+void RWorld::AddEffect(REffectType type, int x, int y) {
+  REffect effect;
+
+  effect.type = type;
+  effect.posX = x;
+  effect.posY = y;
+
+  effects.push_back(effect);
+}
+
+void RWorld::CheckProjectileCollisions(int steps) {
+  // broad phase: bucket everyone by the tiles they overlap
+  enemyGrid.Clear();
+  towerGrid.Clear();
+
+  for (int i = 0; i < enemies.size(); ++i) {
+    enemyGrid.Insert(i, enemies[i]->GetRect());
+  }
+
+  for (int i = 0; i < towers.size(); ++i) {
+    towerGrid.Insert(i, towers[i]->GetRect());
+  }
+
+  enemyGrid.Build();
+  towerGrid.Build();
+
+  // narrow phase: each projectile sweeps the segment it moved along this
+  // tick against the hostile entities in the tiles that segment touches, and
+  // takes the first one it reaches (ties go to list order)
+  // ones that just left the level still get checked; they may have hit
+  // something on the way out
+  int nProjectiles = projectiles.GetCount();
+  int nChunks = RJobSystem::GetChunkCount(nProjectiles, PROJECTILE_GRAIN);
+  PrepareChunks(nChunks);
+
+  Sint32 *posX = projectiles.GetPosX();
+  Sint32 *posY = projectiles.GetPosY();
+  Sint32 *velX = projectiles.GetVelX();
+  Sint32 *velY = projectiles.GetVelY();
+  EntityKind *issuerKind = projectiles.GetIssuerKind();
+
+  ParallelFor(nProjectiles, PROJECTILE_GRAIN,
+              [&](int begin, int end, int chunk) {
+                std::vector<RHit> &hits = chunkHits[chunk];
+
+                for (int i = begin; i < end; ++i) {
+                  bool fromTank = issuerKind[i] == TANK;
+                  RSpatialGrid &grid = fromTank ? towerGrid : enemyGrid;
+                  std::vector<REntity *> &targets = fromTank ? towers : enemies;
+
+                  int x1 = posX[i];
+                  int y1 = posY[i];
+                  int x0 = x1 - velX[i] * steps;
+                  int y0 = y1 - velY[i] * steps;
+
+                  int best = -1;
+                  RReal bestT = 0;
+
+                  // straight off the grid; a scratch list of ids would have
+                  // to be as big as the biggest crowd a shot ever flies into
+                  grid.ForEachInRect(
+                      std::min(x0, x1), std::min(y0, y1), std::max(x0, x1),
+                      std::max(y0, y1), [&](int id) {
+                        RReal t;
+
+                        if (!REntity::SweepCollision(targets[id]->GetRect(),
+                                                     x0, y0, x1, y1, &t)) {
+                          return;
+                        }
+
+                        if (best < 0 || t < bestT ||
+                            (t == bestT && id < best)) {
+                          best = id;
+                          bestT = t;
+                        }
+                      });
+
+                  if (best >= 0) {
+                    RHit hit;
+
+                    hit.projectile = i;
+                    hit.entity = targets[best];
+                    hit.t = bestT;
+
+                    hits.push_back(hit);
+                  }
+                }
+              });
+
+  // resolve in order; this is the only part that changes anything
+  bool anyHit = false;
+  int *damage = projectiles.GetDamage();
+  Uint8 *dead = projectiles.GetDeadMask();
+
+  for (int i = 0; i < nChunks; ++i) {
+    std::vector<RHit> &hits = chunkHits[i];
+
+    for (int j = 0; j < hits.size(); ++j) {
+      REntity *target = hits[j].entity;
+
+      // already finished off earlier this tick; let the shot fly on
+      if (target->GetHealth() == 0) {
+        continue;
+      }
+
+      target->TakeDamage(damage[hits[j].projectile]);
+
+      // erase colliding projectile
+      int p = hits[j].projectile;
+      dead[p] = 1;
+
+      // back up to where along the move it actually hit
+      RReal back = (1 - hits[j].t) * (RReal)steps;
+
+      AddEffect(FX_HIT, (int)(posX[p] - velX[p] * back),
+                (int)(posY[p] - velY[p] * back));
+
+      anyHit = true;
+    }
+  }
+
+  // one pass drops both the hits and whatever flew off the level
+  projectiles.Compact();
+
+  if (anyHit) {
+    sounds.push_back(S_HIT_ENEMY);
+
+    // if health reaches zero, die
+    RemoveDeadEntities(enemies);
+    RemoveDeadEntities(towers);
+  }
+}
+
+void RWorld::RemoveDeadEntities(std::vector<REntity *> &list) {
+  list.erase(std::remove_if(list.begin(), list.end(),
+                            [this](REntity *entity) {
+                              if (entity->GetHealth() == 0) {
+                                AddEffect(FX_EXPLOSION, entity->GetPosX(),
+                                          entity->GetPosY());
+
+                                if (entity->GetKind() == TOWER) {
+                                  ReleaseTile(entity);
+                                }
+
+                                entities.Destroy(entity->GetHandle());
+                                return true;
+                              }
+
+                              return false;
+                            }),
+             list.end());
+}
+
+void RWorld::ReleaseTile(REntity *tower) {
+  int tileX, tileY;
+
+  if (towerTiles.TileAt(tower->GetPosX(), tower->GetPosY(), &tileX, &tileY)) {
+    towerTiles.Release(tileX, tileY, tower->GetHandle());
+  }
+}
+
+void RWorld::RebuildTiles() {
+  towerTiles.Clear();
+
+  for (int i = 0; i < towers.size(); ++i) {
+    int tileX, tileY;
+
+    if (towerTiles.TileAt(towers[i]->GetPosX(), towers[i]->GetPosY(), &tileX,
+                          &tileY)) {
+      towerTiles.Claim(tileX, tileY, towers[i]->GetHandle());
+    }
+  }
+}
+
+void RWorld::ClearFinishedEnemies() {
+  // clear enemies that have cleared the path
+  enemies.erase(std::remove_if(enemies.begin(), enemies.end(),
+                               [this](REntity *enemy) {
+                                 if (!enemy->IsAtEndOfPath()) {
+                                   return false;
+                                 }
+
+                                 // enemies that clear the path also do
+                                 // damage to defender
+                                 // keep it at units so its easier :)
+                                 defenderHealth--;
+
+                                 entities.Destroy(enemy->GetHandle());
+                                 return true;
+                               }),
+                enemies.end());
+
+  // the selected tower may have been destroyed since last tick; the target
+  // stays where it was
+  if (entities.Get(selectedTower) == NULL) {
+    selectedTower = NULL_HANDLE;
+  }
+}
+
+void RWorld::UpdateProjectiles(int steps) {
+  // move and flag off bounds projectiles in one go; they're dropped along
+  // with the ones that hit something once collisions are done
+  ParallelFor(projectiles.GetCount(), PROJECTILE_GRAIN,
+              [this, steps](int begin, int end, int /*chunk*/) {
+                projectiles.Integrate(begin, end, LEVEL_WIDTH, LEVEL_HEIGHT,
+                                      steps);
+              });
+}
+
+void RWorld::UpdateEnemies(float dt) {
+  // firing happens when the scheduler says so, in RunEvents
+  ParallelFor(enemies.size(), ENTITY_GRAIN,
+              [this, dt](int begin, int end, int /*chunk*/) {
+                for (int i = begin; i < end; ++i) {
+                  REntity *enemy = enemies[i];
+
+                  enemy->MoveAlongPath(dt);
+                  enemy->SetTarget(enemyTargetX, enemyTargetY);
+                  enemy->Aim();
+                  enemy->UpdateRect();
+                }
+              });
+}
+
+void RWorld::UpdateTowers() {
+  targeting.Index(enemies);
+
+  int nChunks = RJobSystem::GetChunkCount(towers.size(), ENTITY_GRAIN);
+  PrepareChunks(nChunks);
+
+  // whatever the range, a query can't find more than every enemy
+  ReserveQueries(nChunks, enemies.size());
+
+  ParallelFor(
+      towers.size(), ENTITY_GRAIN, [this](int begin, int end, int chunk) {
+        for (int i = begin; i < end; ++i) {
+          REntity *tower = towers[i];
+          REntityHandle locked = tower->GetLockedTarget();
+          REntity *target = entities.Get(locked);
+
+          // a target that died, finished or walked off can't wait for the
+          // next scheduled look around
+          bool lost = locked != NULL_HANDLE &&
+                      (target == NULL || !RTargeting::InRange(tower, target));
+
+          if (lost || tower->IsRetargetDue()) {
+            target = targeting.FindTarget(tower, enemies, chunkQueries[chunk]);
+
+            tower->SetLockedTarget(target != NULL ? target->GetHandle()
+                                                  : NULL_HANDLE);
+            tower->SetRetargetDue(false);
+          }
+
+          if (target == NULL) {
+            continue;
+          }
+
+          tower->SetTarget(target->GetPosX(), target->GetPosY());
+          tower->Aim();
+
+          if (tower->IsWeaponReady()) {
+            chunkReady[chunk].push_back(tower);
+          }
+        }
+      });
+
+  // towers that were waiting on a target shoot as soon as they get one
+  bool fired = false;
+
+  for (int i = 0; i < nChunks; ++i) {
+    for (int j = 0; j < chunkReady[i].size(); ++j) {
+      REntity *tower = chunkReady[i][j];
+
+      tower->SetWeaponReady(false);
+      FireWeapon(tower, scheduler.GetNow());
+
+      fired = true;
+    }
+  }
+
+  if (fired) {
+    sounds.push_back(S_SHOOT_TOWER);
+  }
+}
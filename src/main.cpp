@@ -1,7 +1,24 @@
+#include "RArena.hpp"
+#include "RCamera.hpp"
+#include "RCrowdLod.hpp"
 #include "REntity.hpp"
 #include "RGUI.hpp"
+#include "RHistogram.hpp"
+#include "RInput.hpp"
+#include "RLockstep.hpp"
+#include "RMapRenderer.hpp"
+#include "RMaps.hpp"
+#include "RMemory.hpp"
+#include "RMetrics.hpp"
+#include "RNet.hpp"
+#include "RParticles.hpp"
+#include "RRenderQueue.hpp"
+#include "RReplay.hpp"
 #include "RSprite.hpp"
 #include "RTexture.hpp"
+#include "RTileMap.hpp"
+#include "RWaves.hpp"
+#include "RWorld.hpp"
 #include <SDL.h>
 #include <SDL_error.h>
 #include <SDL_events.h>
@@ -14,18 +31,13 @@
 #include <SDL_ttf.h>
 #include <SDL_video.h>
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <filesystem>
+#include <string.h>
 #include <string>
-
-const int TILE_WIDTH = 128;
-const int TILE_HEIGHT = 128;
-
-const int LEVEL_GRID_WIDTH = 12;
-const int LEVEL_GRID_HEIGHT = 12;
-
-const int LEVEL_WIDTH = TILE_WIDTH * LEVEL_GRID_WIDTH;
-const int LEVEL_HEIGHT = TILE_HEIGHT * LEVEL_GRID_HEIGHT;
+#include <thread>
+#include <time.h>
 
 const int GUI_WIDTH = TILE_WIDTH * 3;
 
@@ -34,6 +46,16 @@ const int SCREEN_HEIGHT = LEVEL_HEIGHT;
 
 const int FONT_SIZE = 8;
 
+// Internal Resolution
+// everything is laid out in 128px tiles, but can be drawn into a smaller
+// target (e.g. 32px tiles, like the source art) and blown back up by a
+// whole number to fill the window; far fewer px to fill that way
+
+// px per tile in the internal target; 128 draws straight to the window
+int renderTileSize = TILE_WIDTH;
+
+SDL_Texture *gSceneTarget = NULL;
+
 // Files
 
 const std::filesystem::path PATH_ASSETS =
@@ -41,6 +63,9 @@ const std::filesystem::path PATH_ASSETS =
 const std::filesystem::path PATH_PNG = PATH_ASSETS / "png";
 const std::filesystem::path PATH_WAV = PATH_ASSETS / "wav";
 const std::filesystem::path PATH_FONT = PATH_ASSETS / "font";
+const std::filesystem::path PATH_WAVES = PATH_ASSETS / "waves";
+const std::filesystem::path PATH_MAPS =
+    PATH_ASSETS / "editables" / "map_editables";
 
 // SDL
 
@@ -51,18 +76,38 @@ TTF_Font *gFont = NULL;
 
 void PrintError() { printf("%s\n", SDL_GetError()); }
 
+// Frame Memory
+
+// scratch for the render thread; emptied at the end of every frame, so
+// nothing in it can be kept past that
+RArena gFrameArena;
+
+// with GAME_TRACK_ALLOCATIONS, frames and ticks past the warm up that still
+// called new; reported on exit, should stay at 0 while nothing's changing
+const int ALLOC_CHECK_WARMUP = 600;
+
+Uint64 checkedFrames = 0;
+Uint64 allocatingFrames = 0;
+Uint64 lastFrameAllocs = 0;
+
+std::atomic<Uint64> checkedTicks(0);
+std::atomic<Uint64> allocatingTicks(0);
+
 // Debugging/Util
 
-std::string IntToPaddedText(int value, int width) {
-  // c++ handles std::string on its own so no manual mallocing needs to happen
-  // here; this function works!
-  std::string n_str = std::to_string(value);
-  n_str =
-      std::string(width - std::min(width, (int)n_str.length()), '0') + n_str;
+// lives in the frame arena
+RArenaString IntToPaddedText(int value, int width) {
+  char digits[16];
+  int nDigits = snprintf(digits, sizeof(digits), "%d", value);
+
+  RArenaAllocator<char> allocator(&gFrameArena);
+  RArenaString text(allocator);
 
-  n_str = "x" + n_str;
+  text += 'x';
+  text.append(width - std::min(width, nDigits), '0');
+  text += digits;
 
-  return n_str;
+  return text;
 }
 
 void DrawPath(SDL_Renderer *renderer, SDL_Point *path, int pathLength) {
@@ -88,16 +133,178 @@ auto lastUpdateTime = std::chrono::high_resolution_clock::now();
 float targetFps = 120;
 float dt = 0;
 
+// the sim runs on a fixed tick so its results don't depend on frame rate
+const float SIM_TICK_RATE = 120;
+
+// Camera
+// the level area of the window looks at part of the level through this
+
+RCamera gCamera;
+
+// screen px per second
+const float CAMERA_PAN_SPEED = 1200;
+
+// per mouse wheel notch
+const float CAMERA_ZOOM_STEP = 1.25;
+
+// Simulation
+// the world belongs to the sim thread once it starts; the main thread only
+// talks to it through commands and only looks at it through draw lists
+
+RWorld gWorld;
+RJobSystem gJobs;
+RCommandQueue gCommands;
+RDrawListBuffer gDrawLists;
+
+// level side draws, sorted so like goes with like
+RRenderQueue gRenderQueue;
+
+// past a few thousand tanks on screen frame rate matters more than detail
+RCrowdLod gCrowdLod;
+int lastVisibleEnemies = 0;
+
+const int LOD_HURT_BARS_COUNT = 500;
+const int LOD_FIXED_TURRETS_COUNT = 1500;
+const int LOD_NO_TURRETS_COUNT = 3000;
+const int LOD_IMPOSTORS_COUNT = 6000;
+
+// bars are a few px tall from this far out
+const float LOD_HURT_BARS_ZOOM = 0.5;
+
+const int LOD_CLUSTER_CELL = TILE_WIDTH * 2;
+const int LOD_CLUSTER_MIN = 12;
+
+std::thread simThread;
+std::atomic<bool> simRunning(false);
+
+// Metrics
+
+// --metrics <file or unix:socket>; nothing gets recorded without it
+RMetrics gMetrics;
+bool metricsOn = false;
+
+int metFrameTime = -1;
+int metRenderTime = -1;
+int metTickTime = -1;
+int metEnemies = -1;
+int metProjectiles = -1;
+int metInputLatency = -1;
+
+// times are recorded in us
+const Uint64 METRICS_MAX_TIME = 60 * 1000000;
+const Uint64 METRICS_MAX_COUNT = 1000000;
+const double METRICS_US = 1e-6;
+
+void AddMetrics() {
+  metFrameTime = gMetrics.Add("game_frame_time_seconds",
+                              "Time between presented frames.",
+                              METRICS_MAX_TIME, METRICS_US);
+  metRenderTime = gMetrics.Add("game_render_time_seconds",
+                               "Time spent drawing a frame.",
+                               METRICS_MAX_TIME, METRICS_US);
+  metTickTime = gMetrics.Add("game_sim_tick_seconds",
+                             "Time spent on one simulation tick.",
+                             METRICS_MAX_TIME, METRICS_US);
+  metEnemies = gMetrics.Add("game_enemies", "Tanks alive, sampled per tick.",
+                            METRICS_MAX_COUNT);
+  metProjectiles = gMetrics.Add("game_projectiles",
+                                "Projectiles in flight, sampled per tick.",
+                                METRICS_MAX_COUNT);
+  metInputLatency = gMetrics.Add("game_input_latency_seconds",
+                                 "Time from input to the frame showing it.",
+                                 METRICS_MAX_TIME, METRICS_US);
+}
+
+Uint64 MicrosecondsSince(std::chrono::high_resolution_clock::time_point t) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::high_resolution_clock::now() - t)
+      .count();
+}
+
+// Replays
+
+RReplayRecorder gRecorder;
+RReplayPlayer gPlayer;
+bool replaying = false;
+
+// how far the arrow keys jump while watching a replay
+const int REPLAY_SEEK_STEP = SIM_TICK_RATE * 5;
+
+// tick the replay should jump to, or -1; set by the main thread
+std::atomic<Sint64> seekTick(-1);
+
+// last tick drawn, so we know where to seek from
+Uint64 shownTick = 0;
+
+// Checkpoints
+
+// where the world is saved every so often, and picked up from on startup
+const char *checkpointPath = NULL;
+
+const int CHECKPOINT_INTERVAL = SIM_TICK_RATE * 60;
+
+// Networking
+
+// --host / --join; the sim only runs a tick once both sides' input is in
+RLockstep gLockstep;
+bool netPlaying = false;
+
+// 50ms at 120Hz; latency under that never makes anyone wait
+const int NET_DEFAULT_INPUT_DELAY = 6;
+
+const float NET_JOIN_TIMEOUT = 60;
+
+// how long the sim naps while it waits on the other side's input
+const auto NET_STALL_WAIT = std::chrono::milliseconds(1);
+
+// Tower Targeting
+
+// --tower-policy names, in RTargetPolicy order
+const int TARGET_POLICY_COUNT = 4;
+const char *TARGET_POLICY_NAMES[TARGET_POLICY_COUNT] = {"first", "closest",
+                                                        "weakest", "strongest"};
+
+bool ParseTargetPolicy(const char *name, RTargetPolicy *policy) {
+  for (int i = 0; i < TARGET_POLICY_COUNT; ++i) {
+    if (strcmp(name, TARGET_POLICY_NAMES[i]) == 0) {
+      *policy = (RTargetPolicy)i;
+      return true;
+    }
+  }
+
+  return false;
+}
+
 // Event Handling
 
-int mouseX = 0;
-int mouseY = 0;
+RInput gInput;
 
-bool leftClick = false;
-bool mouseWithinLevel = false;
+// how long input waits to show up on screen, in ms; reported on exit
+const Uint64 INPUT_LATENCY_MAX = 10000;
+RHistogram gInputLatency(INPUT_LATENCY_MAX);
 
-int crosshairSnapX;
-int crosshairSnapY;
+bool IsWithinLevel(int x, int y) {
+  return x > 0 && x <= LEVEL_WIDTH && y > 0 && y <= LEVEL_HEIGHT;
+}
+
+// where in the level the player is aiming, if they're holding left click
+// somewhere within it
+bool AimTarget(int *x, int *y) {
+  int mouseX = gInput.GetMouseX();
+  int mouseY = gInput.GetMouseY();
+
+  if (!gInput.IsLeftDown() || !IsWithinLevel(mouseX, mouseY)) {
+    return false;
+  }
+
+  gCamera.ScreenToWorld(mouseX, mouseY, x, y);
+
+  return true;
+}
+
+// last target sent to the sim, so we don't flood it while the button is held
+int sentTargetX = -1;
+int sentTargetY = -1;
 
 // GUI
 
@@ -109,7 +316,7 @@ RGraphic graphicRedTank;
 RButton buttonRedTank(&graphicRedTank, NULL);
 
 RGraphic graphicGreenTank;
-RButton buttonBlueTank(&graphicGreenTank, NULL);
+RButton buttonGreenTank(&graphicGreenTank, NULL);
 
 RGraphic graphicYellowTank;
 RButton buttonYellowTank(&graphicYellowTank, NULL);
@@ -119,6 +326,25 @@ RVerticalLayoutGroup vlGroup;
 std::string defenderHealthText;
 int defenderHealthTextWidth = 3; // used to pad with 0's when not triple digit
 
+// values the gui text was last rendered with; redone when the sim changes them
+int shownDefenderHealth = -1;
+int shownAmtRed = -1;
+int shownAmtGreen = -1;
+int shownAmtYellow = -1;
+
+// Memory Readout
+
+// --mem-stats; also dumps everything on the way out
+bool showMemStats = false;
+
+// one line per tag and one for the totals
+RTexture tMemStats[MEM_TAG_COUNT + 1];
+
+const int MEM_STATS_SCALE = 3;
+const float MEM_STATS_INTERVAL = 1;
+
+float memStatsTimer = MEM_STATS_INTERVAL;
+
 // Music
 
 Mix_Music *songAutoDaFe;
@@ -129,97 +355,39 @@ Mix_Chunk *sfxShootEnemy;
 Mix_Chunk *sfxHitEnemy;
 Mix_Chunk *sfxShootTower;
 
-// Gameplay
-
-int defenderMaxHealth = 5;
-int defenderHealth = defenderMaxHealth;
+// every sound cuts off the one before on the same channel, so a frame is
+// only ever heard as its last; that's all a missed one needs to pass on
+const int CARRIED_SOUNDS = 1;
 
 // Maps
 
-RTexture tMap0;
-const int MAP_0_PATH_LENGTH = 13;
-SDL_Point map0Path[MAP_0_PATH_LENGTH];
+RTileMap gMap0;
+RMapRenderer gMapRenderer;
 
-void SetPoint(SDL_Point *path, int i, int x, int y) {
-  // dangerous! can cause segfaults with this; there's no boundscheck
-  path[i].x = x;
-  path[i].y = y;
-}
-
-// Projectiles
-
-std::vector<RProjectile *> gProjectiles;
-
-RTexture tBallRed;
-RTexture tBallBlue;
+// vram the baked map chunks may take up
+const int MAP_CHUNK_BUDGET = 64 * 1024 * 1024;
 
-// Entities
-
-void CheckProjectileCollisions(REntity *enemy,
-                               std::vector<REntity *> &parentList) {
-  REntity *self = enemy;
-
-  // check for projectile collisions
-  std::vector<RProjectile *>::iterator iter;
-  for (iter = gProjectiles.begin(); iter != gProjectiles.end();) {
-    RProjectile *projectile =
-        gProjectiles.at(std::distance(gProjectiles.begin(), iter));
-    REntity *projectileIssuer = projectile->GetIssuer();
-
-    auto issuerIndex =
-        std::find(parentList.begin(), parentList.end(), projectileIssuer);
-
-    // if the issuer is another entity in the list this entity is in, it's
-    // friendly fire
-    bool issuerInParentList = (issuerIndex != parentList.end());
-
-    if (projectileIssuer == NULL || projectileIssuer == self ||
-        issuerInParentList) {
-      iter++;
-      continue;
-    }
+RPath map0;
 
-    int projectileX = projectile->GetPosX();
-    int projectileY = projectile->GetPosY();
+// Effects
 
-    // check if projectile pos is inside rect
-    if (REntity::CheckCollision(self->GetRect(), projectileX, projectileY)) {
-      self->TakeDamage(projectileIssuer->GetProjectileDamage());
+RTexture tExplosion;
 
-      // TESTING
-      // play enemy damage sound
-      Mix_PlayChannel(0, sfxHitEnemy, 0);
+// 7 frames of 128x128
+const int EXPLOSION_FRAMES = 7;
 
-      // if health reaches zero, die
-      if (self->GetHealth() == 0) {
+// big waves throw off a lot of these; past this many new ones are dropped
+const int PARTICLE_CAPACITY = 65536;
 
-        // remove enemy from parent vector by value rather than index
-        parentList.erase(
-            std::remove(parentList.begin(), parentList.end(), self),
-            parentList.end());
-      }
+RParticleSystem gParticles(PARTICLE_CAPACITY);
 
-      // erase colliding projectile
-      iter = gProjectiles.erase(iter);
-    }
+// Projectiles
 
-    else {
-      iter++;
-    }
-  }
-}
+RTexture tBallRed;
+RTexture tBallBlue;
 
 // Enemies
 
-std::vector<REntity *> gEnemies;
-
-int amtRed = 999;
-int amtGreen = 999;
-int amtYellow = 999;
-
-int enemyTargetX = 0;
-int enemyTargetY = 0;
-
 RTexture tEnemy;
 RTexture tEnemyWeapon;
 
@@ -239,35 +407,29 @@ SDL_Rect cEnemyWeapon[] = {{0 * 128, 0, 128, 128}, {1 * 128, 0, 128, 128},
 RSprite sEnemy(&tEnemy, cEnemy, 1);
 RSprite sEnemyWeapon(&tEnemyWeapon, cEnemyWeapon, 8);
 
-void SpawnRedEnemy(){
-  if (amtRed <= 0){
-    return;
-  }
+RSprite sEnemyGreen(&tEnemyGreen, cEnemy, 1);
+RSprite sEnemyWeaponGreen(&tEnemyWeaponGreen, cEnemyWeapon, 8);
 
-  REntity *newEnemy = new REntity(TANK, &sEnemy, &sEnemyWeapon, sfxShootEnemy);
+RSprite sEnemyYellow(&tEnemyYellow, cEnemy, 1);
+RSprite sEnemyWeaponYellow(&tEnemyWeaponYellow, cEnemyWeapon, 8);
 
-  // give path, place at beginning 
-  newEnemy->SetPath(map0Path, MAP_0_PATH_LENGTH);
-  newEnemy->SetPos(map0Path[0].x, map0Path[0].y);
-
-  // set properties
-  newEnemy->SetFireRate(8);
-  newEnemy->SetSpeed(3);
+void SpawnRedEnemy(){
+  gCommands.Push(C_SPAWN_ENEMY, E_RED);
+}
 
-  // add enemy to reg
-  gEnemies.push_back(newEnemy);
+void SpawnGreenEnemy(){
+  gCommands.Push(C_SPAWN_ENEMY, E_GREEN);
+}
 
-  // now have one less enemy!
-  amtRed--;
-  graphicRedTank.SetText(gRenderer, gFont, IntToPaddedText(amtRed, 3).c_str());  
+void SpawnYellowEnemy(){
+  gCommands.Push(C_SPAWN_ENEMY, E_YELLOW);
 }
 
-// Towers
+// Waves
 
-std::vector<REntity *> gTowers;
+RWaveSchedule gWaves;
 
-int towerTargetX = 0;
-int towerTargetY = 0;
+// Towers
 
 RTexture tTowerBase;
 RTexture tTowerWeapon;
@@ -282,33 +444,6 @@ SDL_Rect cTowerWeapon[] = {
 RSprite sTowerBase(&tTowerBase, cTowerBase, 1);
 RSprite sTowerWeapon(&tTowerWeapon, cTowerWeapon, 11);
 
-void SpawnTower(int gridX, int gridY) {
-  if (gridX > LEVEL_GRID_WIDTH || gridX < 0 || gridY > LEVEL_GRID_HEIGHT ||
-      gridY < 0) {
-    return;
-  }
-
-  // amplify pos to px scale
-  // center pos over tile too; sprites render centered
-  gridX = gridX * TILE_WIDTH + TILE_WIDTH / 2;
-  gridY = gridY * TILE_HEIGHT + TILE_HEIGHT / 2;
-
-  REntity *newTower =
-
-      new REntity(TOWER, &sTowerBase, &sTowerWeapon, sfxShootTower);
-
-  // spawn tower in coords relative to grid
-  newTower->SetPos(gridX, gridY);
-
-  // add a small, random offset to the shoot timer
-  newTower->AddToShootTimer((rand() % 100) / (float)100);
-
-  newTower->SetFireRate(5);
-  newTower->SetProjectileSpeed(14);
-
-  gTowers.push_back(newTower);
-}
-
 // Initialization
 
 bool Init() {
@@ -364,47 +499,61 @@ bool Init() {
   Mix_Volume(1, MIX_MAX_VOLUME);
 
   // put mouse at window center
+  // the world starts out aiming there too
   SDL_WarpMouseInWindow(gWindow, LEVEL_WIDTH / 2, LEVEL_HEIGHT / 2);
 
-  // because we need to poll the event handler to get new mouse position, set
-  // the target to center manually
-  enemyTargetX = LEVEL_WIDTH / 2;
-  enemyTargetY = LEVEL_HEIGHT / 2;
+  return success;
+}
 
-  // scale screen
-  // SDL_RenderSetLogicalSize(gRenderer, 1920, 1080);
+bool CreateSceneTarget() {
+  if (renderTileSize == TILE_WIDTH) {
+    return true;
+  }
 
-  return success;
+  // only exact fractions of a tile, so the upscale is a whole number
+  if (renderTileSize <= 0 || TILE_WIDTH % renderTileSize != 0) {
+    printf("Tile size has to divide %d evenly!\n", TILE_WIDTH);
+    return false;
+  }
+
+  int upscale = TILE_WIDTH / renderTileSize;
+
+  if (!SDL_RenderTargetSupported(gRenderer)) {
+    printf("No render targets here; drawing at full size\n");
+    renderTileSize = TILE_WIDTH;
+    return true;
+  }
+
+  // blocky pixels when it gets blown up, not blurry ones
+  SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "nearest");
+
+  gSceneTarget =
+      SDL_CreateTexture(gRenderer, SDL_PIXELFORMAT_RGBA8888,
+                        SDL_TEXTUREACCESS_TARGET, SCREEN_WIDTH / upscale,
+                        SCREEN_HEIGHT / upscale);
+
+  if (gSceneTarget == NULL) {
+    PrintError();
+    return false;
+  }
+
+  RMemory::TrackGpu(MEM_TEXTURE, RTexture::GetTextureBytes(gSceneTarget));
+
+  // everything downstream still thinks in 128px tiles
+  float pixelScale = 1.0f / upscale;
+
+  gCamera.SetPixelScale(pixelScale);
+  gMapRenderer.SetBakeScale(pixelScale);
+
+  return true;
 }
 
 void MakeMapPaths() {
-  // first set map points in unscaled coords (e.g. 10, 7 refers to 10 tiles x, 7
-  // tiles y)
-  // first int is the index of the point, second is the coords
-  SetPoint(map0Path, 0, 0, 5);
-  SetPoint(map0Path, 1, 8, 5);
-  SetPoint(map0Path, 2, 8, 2);
-  SetPoint(map0Path, 3, 6, 2);
-  SetPoint(map0Path, 4, 6, 10);
-  SetPoint(map0Path, 5, 4, 10);
-  SetPoint(map0Path, 6, 4, 7);
-  SetPoint(map0Path, 7, 9, 7);
-  SetPoint(map0Path, 8, 9, 6);
-  SetPoint(map0Path, 9, 11, 6);
-  SetPoint(map0Path, 10, 11, 10);
-  SetPoint(map0Path, 11, 8, 10);
-  SetPoint(map0Path, 12, 8, 12);
-
-  for (int i = 0; i < MAP_0_PATH_LENGTH; ++i) {
-    // scale up points to match level screen cords
-    map0Path[i].x *= TILE_WIDTH;
-    map0Path[i].y *= TILE_HEIGHT;
-
-    // also make a tile's posistion its center; it's easier to deal with
-    // positioning entities this way
-    map0Path[i].x -= (int)SDL_roundf((float)TILE_WIDTH / 2);
-    map0Path[i].y -= (int)SDL_roundf((float)TILE_HEIGHT / 2);
-  }
+  // the segment lengths get worked out here, once; entities only track
+  // distance along it
+  MakeMap0Path(&map0);
+
+  gWorld.SetPath(&map0);
 }
 
 void ConfigureGUI() {
@@ -424,21 +573,24 @@ void ConfigureGUI() {
 
   graphicRedTank.SetTextPadding(25);
   graphicRedTank.SetTextScale(8);
-  graphicRedTank.SetText(gRenderer, gFont, IntToPaddedText(amtRed, 2).c_str()); 
+  graphicRedTank.SetText(gRenderer, gFont,
+                          IntToPaddedText(gWorld.GetEnemyAmount(E_RED), 2).c_str()); 
 
   graphicGreenTank.SetTextPadding(25);
   graphicGreenTank.SetTextScale(8);
-  graphicGreenTank.SetText(gRenderer, gFont, IntToPaddedText(amtGreen, 2).c_str()); 
+  graphicGreenTank.SetText(gRenderer, gFont,
+                          IntToPaddedText(gWorld.GetEnemyAmount(E_GREEN), 2).c_str()); 
 
   graphicYellowTank.SetTextPadding(25);
   graphicYellowTank.SetTextScale(8);
-  graphicYellowTank.SetText(gRenderer, gFont, IntToPaddedText(amtYellow, 2).c_str()); 
+  graphicYellowTank.SetText(gRenderer, gFont,
+                          IntToPaddedText(gWorld.GetEnemyAmount(E_YELLOW), 2).c_str()); 
 
   // Button Actions
 
   buttonRedTank.SetAction(&SpawnRedEnemy);
-  buttonBlueTank.SetAction(NULL);
-  buttonYellowTank.SetAction(NULL);
+  buttonGreenTank.SetAction(&SpawnGreenEnemy);
+  buttonYellowTank.SetAction(&SpawnYellowEnemy);
 
   // Layout Group
   // 1. Add elements
@@ -469,11 +621,13 @@ bool LoadMedia() {
 
   // Maps
 
-  if (!tMap0.LoadFromFile(gRenderer, (PATH_PNG / "map0.png").c_str())) {
-    PrintError();
+  if (!gMap0.LoadFromFile(gRenderer, (PATH_MAPS / "map0.json").c_str())) {
     success = false;
   }
 
+  gMapRenderer.SetBudget(MAP_CHUNK_BUDGET);
+  gMapRenderer.SetMap(&gMap0);
+
   // Projectiles
 
   if (!tBallRed.LoadFromFile(gRenderer, (PATH_PNG / "ball.png").c_str())) {
@@ -545,6 +699,17 @@ bool LoadMedia() {
   }
 
 
+  // Effects
+
+  if (!tExplosion.LoadFromFile(gRenderer,
+                               (PATH_PNG / "explosion.png").c_str())) {
+    PrintError();
+    success = false;
+  }
+
+  gParticles.SetSheet(&tExplosion, TILE_WIDTH, TILE_HEIGHT, EXPLOSION_FRAMES);
+  gDrawLists.SetCarryLimits(CARRIED_SOUNDS, gParticles.GetEffectCapacity());
+
   // GUI
 
   if (!tCrosshair.LoadFromFile(gRenderer,
@@ -567,7 +732,7 @@ bool LoadMedia() {
   tHeart.SetScale(12);
   tHeart.ModColor(255, 0, 0);
 
-  defenderHealthText = std::to_string(defenderHealth);
+  defenderHealthText = std::to_string(gWorld.GetDefenderHealth());
   defenderHealthText =
       std::string(defenderHealthTextWidth -
                       std::min(defenderHealthTextWidth,
@@ -610,15 +775,100 @@ bool LoadMedia() {
 }
 
 void Close() {
-  // TODO finish this!
-  // there is a lot we aren't freeing
+  gMetrics.Stop();
+
+  // sim thread must be gone before anything it could be using is
+  simRunning = false;
+
+  if (simThread.joinable()) {
+    simThread.join();
+  }
 
-  tMap0.Free();
+  gRecorder.Close(gWorld.GetTick());
+
+  if (checkpointPath != NULL && !replaying) {
+    gWorld.SaveSnapshot(checkpointPath);
+  }
+
+  // the world's entities and projectiles belong to its pool and store, so
+  // everything left to free by hand is what LoadMedia loaded
+  gMapRenderer.Invalidate();
+  gMap0.Free();
   tEnemy.Free();
   tEnemyWeapon.Free();
+  tEnemyGreen.Free();
+  tEnemyWeaponGreen.Free();
+  tEnemyYellow.Free();
+  tEnemyWeaponYellow.Free();
+  tTowerBase.Free();
+  tTowerWeapon.Free();
   tBallRed.Free();
+  tBallBlue.Free();
+  tExplosion.Free();
+  tCrosshair.Free();
+  tHeart.Free();
+  tDefenderHealth.Free();
 
   Mix_FreeChunk(sfxShootEnemy);
+  sfxShootEnemy = NULL;
+  Mix_FreeChunk(sfxShootTower);
+  sfxShootTower = NULL;
+  Mix_FreeChunk(sfxHitEnemy);
+  sfxHitEnemy = NULL;
+
+  Mix_FreeMusic(songAutoDaFe);
+  songAutoDaFe = NULL;
+
+  if (gFont != NULL) {
+    TTF_CloseFont(gFont);
+    gFont = NULL;
+  }
+
+  if (gSceneTarget != NULL) {
+    RMemory::TrackGpu(MEM_TEXTURE, -RTexture::GetTextureBytes(gSceneTarget));
+    SDL_DestroyTexture(gSceneTarget);
+    gSceneTarget = NULL;
+  }
+
+  for (int i = 0; i <= MEM_TAG_COUNT; ++i) {
+    tMemStats[i].Free();
+  }
+
+  // by now only what we never freed is left
+  if (showMemStats || RMemory::IsTrackingHeap()) {
+    RMemory::Dump(stdout);
+  }
+
+  if (netPlaying) {
+    RNetStats net = gLockstep.GetStats();
+
+    printf("net: sent %llu packets (%llu B), got %llu (%llu B), waited on "
+           "the other side %llu times%s\n",
+           (unsigned long long)net.packetsSent,
+           (unsigned long long)net.bytesSent,
+           (unsigned long long)net.packetsReceived,
+           (unsigned long long)net.bytesReceived,
+           (unsigned long long)net.stalls,
+           gLockstep.IsDesynced() ? ", desynced" : "");
+  }
+
+  if (gInputLatency.GetCount() > 0) {
+    printf("input to present: p50 %llums, p99 %llums, max %llums over %llu "
+           "frames\n",
+           (unsigned long long)gInputLatency.GetPercentile(50),
+           (unsigned long long)gInputLatency.GetPercentile(99),
+           (unsigned long long)gInputLatency.GetMax(),
+           (unsigned long long)gInputLatency.GetCount());
+  }
+
+  if (RMemory::IsTrackingHeap()) {
+    printf("went to the heap after warm up: %llu of %llu frames, %llu of %llu "
+           "ticks\n",
+           (unsigned long long)allocatingFrames,
+           (unsigned long long)checkedFrames,
+           (unsigned long long)allocatingTicks.load(),
+           (unsigned long long)checkedTicks.load());
+  }
 
   SDL_DestroyRenderer(gRenderer);
   gRenderer = NULL;
@@ -626,6 +876,9 @@ void Close() {
   SDL_DestroyWindow(gWindow);
   gWindow = NULL;
 
+  Mix_CloseAudio();
+
+  TTF_Quit();
   IMG_Quit();
   Mix_Quit();
   SDL_Quit();
@@ -633,105 +886,306 @@ void Close() {
 
 // Game Flow
 
-// WARNING: what happens if projectile/enemy is popped from the middle?
-// forloop might be dangerous
+// stands in front of a host so the link between two games on one machine
+// can be made as bad as a real one; the other game joins this port
+int RunRelay(int port, const char *hostAddress, int latency, int jitter,
+             float loss) {
+  RNetAddress host;
+
+  if (!ResolveAddress(hostAddress, &host)) {
+    return 1;
+  }
 
-void ClearOffBoundsProjectiles() {
-  for (int i = 0; i < gProjectiles.size(); ++i) {
-    RProjectile *projectile = gProjectiles[i];
-    if (projectile->GetPosX() < 0 || projectile->GetPosX() > LEVEL_WIDTH ||
-        projectile->GetPosY() < 0 || projectile->GetPosY() > LEVEL_HEIGHT) {
+  RNetRelay relay;
 
-      // remove ith element; vector erases this for us
-      gProjectiles.erase(gProjectiles.begin() + i);
-    }
+  if (!relay.Open(port, host)) {
+    return 1;
   }
+
+  relay.SetConditions(latency, jitter, loss);
+
+  printf("Relaying port %d to %s, %dms +-%dms, %g%% loss\n", relay.GetPort(),
+         hostAddress, latency, jitter, loss);
+
+  // runs until it's killed
+  std::atomic<bool> stop(false);
+  relay.Run(&stop);
+
+  return 0;
 }
 
-void ClearFinishedEnemies() {
-  // clear enemies that have cleared the path
-  for (int i = 0; i < gEnemies.size(); ++i) {
-    REntity *enemy = gEnemies[i];
+void SimulationLoop() {
+  std::vector<RCommand> commands;
+
+  auto tickDuration = std::chrono::duration_cast<
+      std::chrono::high_resolution_clock::duration>(
+      std::chrono::duration<float>(1 / SIM_TICK_RATE));
+
+  auto nextTickTime = std::chrono::high_resolution_clock::now();
+
+  Uint64 tickCount = 0;
+  Uint64 lastTickAllocs = RMemory::GetThreadAllocs();
+
+  while (simRunning) {
+    auto tickStart = std::chrono::high_resolution_clock::now();
+
+    // in a network game nothing moves until the other side's input for this
+    // tick is in; ours keeps piling up in the queue meanwhile
+    if (netPlaying) {
+      gLockstep.Poll();
+
+      if (!gLockstep.IsReady(gWorld.GetTick())) {
+        std::this_thread::sleep_for(NET_STALL_WAIT);
+        continue;
+      }
+    }
+
+    // apply whatever the player did since the last tick
+    // while replaying it's thrown away; the recording has its own input
+    commands.clear();
+    gCommands.Drain(commands);
+
+    if (replaying) {
+      Sint64 seek = seekTick.exchange(-1);
+
+      if (seek >= 0) {
+        gPlayer.Seek(&gWorld, seek);
+      }
+
+      // hold on the last tick once the recording runs out
+      if (gWorld.GetTick() < gPlayer.GetEndTick()) {
+        gPlayer.Step(&gWorld);
+      }
+    }
+
+    else {
+      // ours go out for later, and everyone's for this tick come back
+      if (netPlaying) {
+        gLockstep.Exchange(gWorld.GetTick(), &commands);
+      }
+
+      for (int i = 0; i < commands.size(); ++i) {
+        gRecorder.RecordCommand(gWorld.GetTick(), &commands[i]);
+        gWorld.HandleCommand(&commands[i]);
+      }
+
+      gWorld.Tick(1 / SIM_TICK_RATE);
+
+      // lets the replay tell if it's still playing out the same way
+      if (gRecorder.IsOpen() &&
+          gWorld.GetTick() % REPLAY_HASH_INTERVAL == 0) {
+        gRecorder.RecordHash(gWorld.GetTick(), gWorld.Hash());
+      }
+
+      // and lets the other side check we're still playing the same game
+      if (netPlaying && gWorld.GetTick() % NET_HASH_INTERVAL == 0) {
+        gLockstep.RecordHash(gWorld.GetTick(), gWorld.Hash());
+      }
 
-    if (enemy->IsAtEndOfPath()) {
-      // enemies that clear the path also do damage to defender
-      // keep it at units so its easier :)
-      defenderHealth--;
+      if (checkpointPath != NULL &&
+          gWorld.GetTick() % CHECKPOINT_INTERVAL == 0) {
+        gWorld.SaveSnapshot(checkpointPath);
+      }
+    }
 
-      // update health text
-      tDefenderHealth.LoadFromRenderedText(
-          gRenderer, gFont, IntToPaddedText(defenderHealth, 3).c_str(), 255,
-          255, 255);
+    // hand the result over; renderer draws it while we do the next tick
+    RDrawList *list = gDrawLists.GetWriteList();
+    gWorld.BuildDrawList(list);
 
-      // clear enemy
-      gEnemies.erase(gEnemies.begin() + i);
+    if (metricsOn) {
+      gMetrics.Record(metTickTime, MicrosecondsSince(tickStart));
+      gMetrics.Record(metEnemies, list->enemies.size());
+      gMetrics.Record(metProjectiles, list->projectiles.size());
+    }
+
+    gDrawLists.Publish();
+
+    Uint64 tickAllocs = RMemory::GetThreadAllocs();
+
+    if (++tickCount > ALLOC_CHECK_WARMUP) {
+      checkedTicks++;
+
+      if (tickAllocs != lastTickAllocs) {
+        allocatingTicks++;
+      }
+    }
+
+    lastTickAllocs = tickAllocs;
+
+    nextTickTime += tickDuration;
+
+    // if we fell way behind, don't try to catch up all at once
+    auto now = std::chrono::high_resolution_clock::now();
+    if (now - nextTickTime > tickDuration * 4) {
+      nextTickTime = now;
+    }
+
+    std::this_thread::sleep_until(nextTickTime);
+  }
+}
+
+void PlaySounds(RDrawList *list) {
+  for (int i = 0; i < list->sounds.size(); ++i) {
+    switch (list->sounds[i]) {
+    case S_SHOOT_ENEMY:
+      Mix_PlayChannel(0, sfxShootEnemy, 0);
+      break;
+    case S_SHOOT_TOWER:
+      Mix_PlayChannel(0, sfxShootTower, 0);
+      break;
+    case S_HIT_ENEMY:
+      Mix_PlayChannel(0, sfxHitEnemy, 0);
+      break;
     }
   }
 }
 
-void UpdateProjectiles() {
-  // upd projectiles
-  for (int i = 0; i < gProjectiles.size(); ++i) {
-    RProjectile *projectile = gProjectiles.at(i);
+void UpdateGUIText(RDrawList *list) {
+  // re-rendering text is expensive, so only do it when the values change
+  if (list->defenderHealth != shownDefenderHealth) {
+    shownDefenderHealth = list->defenderHealth;
+
+    tDefenderHealth.LoadFromRenderedText(
+        gRenderer, gFont, IntToPaddedText(shownDefenderHealth, 3).c_str(), 255,
+        255, 255);
+  }
+
+  if (list->amtRed != shownAmtRed) {
+    shownAmtRed = list->amtRed;
 
-    projectile->Move();
-    projectile->Render(gRenderer);
+    graphicRedTank.SetText(gRenderer, gFont,
+                           IntToPaddedText(shownAmtRed, 3).c_str());
+  }
+
+  if (list->amtGreen != shownAmtGreen) {
+    shownAmtGreen = list->amtGreen;
+
+    graphicGreenTank.SetText(gRenderer, gFont,
+                             IntToPaddedText(shownAmtGreen, 3).c_str());
+  }
+
+  if (list->amtYellow != shownAmtYellow) {
+    shownAmtYellow = list->amtYellow;
+
+    graphicYellowTank.SetText(gRenderer, gFont,
+                              IntToPaddedText(shownAmtYellow, 3).c_str());
   }
 }
 
-void UpdateEnemies() {
-  for (int i = 0; i < gEnemies.size(); ++i) {
-    REntity *enemy = gEnemies.at(i);
+// these only queue things up; FlushQueue draws them
+void DrawProjectiles(RDrawList *list) {
+  for (int i = 0; i < list->projectiles.size(); ++i) {
+    RProjectileDrawItem *item = &list->projectiles[i];
 
-    CheckProjectileCollisions(enemy, gEnemies);
+    RTexture *texture = item->issuerKind == TOWER ? &tBallBlue : &tBallRed;
 
-    enemy->MoveAlongPath();
-    enemy->SetTarget(enemyTargetX, enemyTargetY);
-    enemy->Shoot(&tBallRed, gProjectiles, dt);
-    enemy->Render(gRenderer, dt);
+    RDrawList::SubmitProjectile(&gRenderQueue, item, texture, &gCamera);
   }
 }
 
-void UpdateTowers() {
-  bool didSetSnap = false;
+void DrawEnemies(RDrawList *list) {
+  RCrowdDetail detail =
+      gCrowdLod.Update(lastVisibleEnemies, gCamera.GetZoom());
 
-  for (int i = 0; i < gTowers.size(); ++i) {
-    REntity *tower = gTowers.at(i);
+  bool clustering = detail == CD_IMPOSTORS;
 
-    if (!didSetSnap &&
-        REntity::CheckCollision(tower->GetRect(), mouseX, mouseY)) {
-      crosshairSnapX = tower->GetPosX();
-      crosshairSnapY = tower->GetPosY();
+  if (clustering) {
+    lastVisibleEnemies =
+        gCrowdLod.Cluster(list->enemies, &gCamera, TILE_WIDTH / 2);
+    gCrowdLod.SubmitClusters(&gRenderQueue, &gCamera);
+  } else {
+    lastVisibleEnemies = 0;
+  }
 
-      didSetSnap = true;
-    }
+  // every tank of a colour shares these, so they're animated once a frame
+  sEnemy.Update(dt);
+  sEnemyWeapon.Update(dt);
+  sEnemyGreen.Update(dt);
+  sEnemyWeaponGreen.Update(dt);
+  sEnemyYellow.Update(dt);
+  sEnemyWeaponYellow.Update(dt);
 
-    CheckProjectileCollisions(tower, gTowers);
+  for (int i = 0; i < list->enemies.size(); ++i) {
+    REntityDrawItem *item = &list->enemies[i];
 
-    REntity *targetEnemy;
+    if (clustering && gCrowdLod.IsClustered(i)) {
+      continue;
+    }
 
-    if (gEnemies.size() > 0) {
-      targetEnemy = gEnemies.at(0);
+    RSprite *body = &sEnemy;
+    RSprite *weapon = &sEnemyWeapon;
 
-      float towerRange = 1000;
-      float targetDistance =
-          REntity::Distance(targetEnemy->GetPosX(), targetEnemy->GetPosY(),
-                            tower->GetPosX(), tower->GetPosY());
+    if (item->color == E_GREEN) {
+      body = &sEnemyGreen;
+      weapon = &sEnemyWeaponGreen;
+    } else if (item->color == E_YELLOW) {
+      body = &sEnemyYellow;
+      weapon = &sEnemyWeaponYellow;
+    }
 
-      if (targetDistance < towerRange) {
-        tower->SetTarget(targetEnemy->GetPosX(), targetEnemy->GetPosY());
-        tower->Shoot(&tBallBlue, gProjectiles, dt);
-      }
+    bool drawn = RDrawList::SubmitEntity(&gRenderQueue, item, body, weapon,
+                                         &gCamera, detail);
+
+    if (drawn && !clustering) {
+      lastVisibleEnemies++;
     }
+  }
+}
 
-    tower->Render(gRenderer, dt);
+void DrawTowers(RDrawList *list) {
+  sTowerBase.Update(dt);
+  sTowerWeapon.Update(dt);
+
+  for (int i = 0; i < list->towers.size(); ++i) {
+    RDrawList::SubmitEntity(&gRenderQueue, &list->towers[i], &sTowerBase,
+                            &sTowerWeapon, &gCamera);
   }
+}
+
+RArenaString MemLine(const char *name, RMemStats heap, RMemStats gpu) {
+  char line[128];
+
+  snprintf(line, sizeof(line), "%-10s heap %8.2f MB  gpu %8.2f MB", name,
+           heap.bytes / (1024.0 * 1024.0), gpu.bytes / (1024.0 * 1024.0));
+
+  return RArenaString(line, RArenaAllocator<char>(&gFrameArena));
+}
+
+void UpdateMemStats() {
+  memStatsTimer += dt;
 
-  // if no towers collide with the cursor, we should set the crosshair
-  // snap points to be invalid
-  if (!didSetSnap) {
-    crosshairSnapX = -1;
-    crosshairSnapY = -1;
+  // text is slow to make and the numbers don't move that fast
+  if (memStatsTimer < MEM_STATS_INTERVAL) {
+    return;
+  }
+
+  memStatsTimer = 0;
+
+  for (int i = 0; i < MEM_TAG_COUNT; ++i) {
+    RMemTag tag = (RMemTag)i;
+
+    tMemStats[i].LoadFromRenderedText(
+        gRenderer, gFont,
+        MemLine(RMemory::GetTagName(tag), RMemory::GetHeapStats(tag),
+                RMemory::GetGpuStats(tag))
+            .c_str());
+  }
+
+  tMemStats[MEM_TAG_COUNT].LoadFromRenderedText(
+      gRenderer, gFont,
+      MemLine("total",
+              RMemory::GetHeapTotal(), RMemory::GetGpuTotal())
+          .c_str());
+}
+
+void DrawMemStats() {
+  int y = 10;
+
+  for (int i = 0; i <= MEM_TAG_COUNT; ++i) {
+    tMemStats[i].SetScale(MEM_STATS_SCALE);
+    tMemStats[i].Render(gRenderer, 10, y);
+
+    y += tMemStats[i].GetHeight() + 2;
   }
 }
 
@@ -751,51 +1205,304 @@ void DrawUI() {
                          heartPosY - 12, tDefHealthW, tDefHealthH);
 }
 
-int main() {
+int main(int argc, char *argv[]) {
+  // Arguments
+
+  const char *recordPath = NULL;
+  const char *replayPath = NULL;
+  const char *wavesPath = NULL;
+
+  const char *metricsPath = NULL;
+  RMetricsFormat metricsFormat = MF_PROMETHEUS;
+  float metricsInterval = 10;
+
+  int hostPort = 0;
+  const char *joinAddress = NULL;
+  int inputDelay = NET_DEFAULT_INPUT_DELAY;
+
+  int relayPort = 0;
+  const char *relayHost = NULL;
+  int relayLatency = 0;
+  int relayJitter = 0;
+  float relayLoss = 0;
+
+  // the world's unless asked for; a replay or the host can overrule both
+  RTargetPolicy towerPolicy = gWorld.GetTowerPolicy();
+  float retargetInterval = gWorld.GetRetargetInterval();
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      recordPath = argv[++i];
+    }
+
+    else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+      replayPath = argv[++i];
+    }
+
+    else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+      checkpointPath = argv[++i];
+    }
+
+    else if (strcmp(argv[i], "--waves") == 0 && i + 1 < argc) {
+      wavesPath = argv[++i];
+    }
+
+    else if (strcmp(argv[i], "--tile-size") == 0 && i + 1 < argc) {
+      renderTileSize = atoi(argv[++i]);
+    }
+
+    else if (strcmp(argv[i], "--no-lod") == 0) {
+      gCrowdLod.SetEnabled(false);
+    }
+
+    else if (strcmp(argv[i], "--mem-stats") == 0) {
+      showMemStats = true;
+    }
+
+    else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+      metricsPath = argv[++i];
+    }
+
+    else if (strcmp(argv[i], "--metrics-format") == 0 && i + 1 < argc) {
+      ++i;
+
+      if (strcmp(argv[i], "json") == 0) {
+        metricsFormat = MF_JSON_LINES;
+      } else if (strcmp(argv[i], "prom") != 0) {
+        printf("Unknown metrics format %s, use prom or json\n", argv[i]);
+      }
+    }
+
+    else if (strcmp(argv[i], "--metrics-interval") == 0 && i + 1 < argc) {
+      metricsInterval = atof(argv[++i]);
+    }
+
+    else if (strcmp(argv[i], "--host") == 0 && i + 1 < argc) {
+      hostPort = atoi(argv[++i]);
+    }
+
+    else if (strcmp(argv[i], "--join") == 0 && i + 1 < argc) {
+      joinAddress = argv[++i];
+    }
+
+    else if (strcmp(argv[i], "--input-delay") == 0 && i + 1 < argc) {
+      inputDelay = atoi(argv[++i]);
+    }
+
+    else if (strcmp(argv[i], "--tower-policy") == 0 && i + 1 < argc) {
+      ++i;
+
+      if (!ParseTargetPolicy(argv[i], &towerPolicy)) {
+        printf("Unknown tower policy %s, use first, closest, weakest or "
+               "strongest\n",
+               argv[i]);
+        return 1;
+      }
+    }
+
+    else if (strcmp(argv[i], "--retarget") == 0 && i + 1 < argc) {
+      retargetInterval = atof(argv[++i]);
+
+      if (!IsEventSeconds(retargetInterval)) {
+        printf("Retarget interval has to be above 0 and at most %g seconds!\n",
+               MAX_EVENT_SECONDS);
+        return 1;
+      }
+    }
+
+    // --relay <port> <host:port> [--latency ms] [--jitter ms] [--loss %]
+    else if (strcmp(argv[i], "--relay") == 0 && i + 2 < argc) {
+      relayPort = atoi(argv[++i]);
+      relayHost = argv[++i];
+    }
+
+    else if (strcmp(argv[i], "--latency") == 0 && i + 1 < argc) {
+      relayLatency = atoi(argv[++i]);
+    }
+
+    else if (strcmp(argv[i], "--jitter") == 0 && i + 1 < argc) {
+      relayJitter = atoi(argv[++i]);
+    }
+
+    else if (strcmp(argv[i], "--loss") == 0 && i + 1 < argc) {
+      relayLoss = atof(argv[++i]);
+    }
+
+    else {
+      printf("Unknown argument %s\n", argv[i]);
+    }
+  }
+
+  // Networking
+
+  // a relay is all this process does; it never opens a window
+  if (relayPort > 0) {
+    return RunRelay(relayPort, relayHost, relayLatency, relayJitter,
+                    relayLoss);
+  }
+
+  // waves are part of the setup a replay or the other side of a network game
+  // expects, so they're loaded up front to be checked against; they aren't
+  // started until the world is ready
+  if (wavesPath != NULL) {
+    // either a path or the name of one in the waves folder
+    std::filesystem::path file = wavesPath;
+
+    if (!std::filesystem::exists(file)) {
+      file = PATH_WAVES / wavesPath;
+    }
+
+    if (!gWaves.LoadFromFile(file.c_str())) {
+      return 1;
+    }
+  }
+
+  // before there's a window to sit unresponsive while we wait
+  if (hostPort > 0 || joinAddress != NULL) {
+    if (replayPath != NULL) {
+      printf("Can't play back a replay in a network game!\n");
+      return 1;
+    }
+
+    bool joined =
+        hostPort > 0
+            ? gLockstep.Host(hostPort, time(NULL), inputDelay, towerPolicy,
+                             retargetInterval, gWaves.Hash(), NET_JOIN_TIMEOUT)
+            : gLockstep.Join(joinAddress, gWaves.Hash(), NET_JOIN_TIMEOUT);
+
+    if (!joined) {
+      return 1;
+    }
+
+    // the host's, whatever we were told
+    towerPolicy = gLockstep.GetTowerPolicy();
+    retargetInterval = gLockstep.GetRetargetInterval();
+
+    netPlaying = true;
+  }
+
   // Initialization
 
   if (!Init()) {
     return 1;
   }
 
+  if (metricsPath != NULL) {
+    AddMetrics();
+    metricsOn = gMetrics.Start(metricsPath, metricsFormat, metricsInterval);
+  }
+
   if (!LoadMedia()) {
     return 1;
   }
 
-  // seed the randomizer
-  srand(time(NULL));
+  if (!CreateSceneTarget()) {
+    return 1;
+  }
+
+  // seed the world; a replay brings its own seed, and in a network game the
+  // host picks
+  Uint32 seed = netPlaying ? gLockstep.GetSeed() : time(NULL);
+
+  if (replayPath != NULL) {
+    if (!gPlayer.Load(replayPath)) {
+      return 1;
+    }
+
+    // tanks would turn up that were never there, or the other way around
+    if (gPlayer.GetWaveHash() != gWaves.Hash()) {
+      printf("Replay %s was recorded with different waves; pass the same "
+             "--waves it was!\n",
+             replayPath);
+      return 1;
+    }
+
+    replaying = true;
+    seed = gPlayer.GetSeed();
+
+    // whatever the recording was set up with
+    towerPolicy = gPlayer.GetTowerPolicy();
+    retargetInterval = gPlayer.GetRetargetInterval();
+  }
+
+  gWorld.Seed(seed);
 
   MakeMapPaths();
-  ConfigureGUI();
+
+  // pick up where the last session left off if there's a checkpoint
+  // replays always start fresh from their seed, and so do network games;
+  // the other side wouldn't have the checkpoint
+  bool resumed = false;
+
+  if (checkpointPath != NULL && !replaying && !netPlaying &&
+      std::filesystem::exists(checkpointPath)) {
+    resumed = gWorld.LoadSnapshot(checkpointPath);
+  }
 
   // TODO remove; spawn some towers for testing
-  int nTowers = 24;
-  for (int i = 0; i < nTowers; ++i) {
-    SpawnTower(rand() % LEVEL_GRID_WIDTH, rand() % LEVEL_GRID_HEIGHT);
+  if (!resumed) {
+    gWorld.SpawnTowers(24);
+  }
+
+  // like waves, targeting is part of the setup, so it's always set the same
+  // way; replays and the joining side got theirs above, and a checkpoint
+  // has its own
+  if (!resumed) {
+    gWorld.SetTowerTargeting(towerPolicy, retargetInterval);
+  }
+
+  // a checkpoint already has its waves in progress
+  if (wavesPath != NULL && !resumed) {
+    gWorld.StartWaves(&gWaves);
+  }
+
+  ConfigureGUI();
+
+  // the level area of the window, looking at the level
+  gCamera.SetViewport(LEVEL_WIDTH, LEVEL_HEIGHT);
+
+  gCrowdLod.SetCountThreshold(CD_HURT_BARS, LOD_HURT_BARS_COUNT);
+  gCrowdLod.SetCountThreshold(CD_FIXED_TURRETS, LOD_FIXED_TURRETS_COUNT);
+  gCrowdLod.SetCountThreshold(CD_NO_TURRETS, LOD_NO_TURRETS_COUNT);
+  gCrowdLod.SetCountThreshold(CD_IMPOSTORS, LOD_IMPOSTORS_COUNT);
+  gCrowdLod.SetZoomThreshold(CD_HURT_BARS, LOD_HURT_BARS_ZOOM);
+  gCrowdLod.SetClusterSize(LOD_CLUSTER_CELL, LOD_CLUSTER_MIN);
+  gCamera.SetBounds(gMap0.GetWidth(), gMap0.GetHeight());
+
+  // everything from here on is either recorded or comes from the recording
+  if (replaying) {
+    gPlayer.Begin(&gWorld);
+  }
+
+  else if (recordPath != NULL && resumed) {
+    printf("Can't record a session resumed from a checkpoint!\n");
+  }
+
+  else if (recordPath != NULL) {
+    gRecorder.Open(recordPath, seed, SIM_TICK_RATE, gWaves.Hash(), towerPolicy,
+                   retargetInterval);
   }
 
   Mix_PlayMusic(songAutoDaFe, -1);
 
+  gWorld.SetJobSystem(&gJobs);
+
+  // from here on only the sim thread may touch the world
+  simRunning = true;
+  simThread = std::thread(SimulationLoop);
+
   // Main Loop
 
   SDL_Event e;
 
+  Uint64 frameCount = 0;
+
   bool quit = false;
   while (!quit) {
-    auto currentTime = std::chrono::high_resolution_clock::now();
-
-    dt = std::chrono::duration<float, std::chrono::seconds::period>(
-             currentTime - lastUpdateTime)
-             .count();
-
-    // dt must meet or exceed duration of frame before flip
-    if (dt < 1 / targetFps) {
-      continue;
-    }
-
     while (SDL_PollEvent(&e)) {
-      // always get mouse position
-      SDL_GetMouseState(&mouseX, &mouseY);
+      // mouse position and drag come from the events themselves; motion
+      // only leaves the latest position behind, so a burst of it is cheap
+      gInput.HandleEvent(&e);
 
       // Quit Commands
 
@@ -807,70 +1514,196 @@ int main() {
         if (e.key.keysym.sym == SDLK_ESCAPE) {
           quit = true;
         }
-      }
 
-      // Left Click State
+        // scrub through replays
+        else if (replaying && e.key.keysym.sym == SDLK_LEFT) {
+          seekTick = shownTick > REPLAY_SEEK_STEP
+                         ? shownTick - REPLAY_SEEK_STEP
+                         : 0;
+        }
+
+        else if (replaying && e.key.keysym.sym == SDLK_RIGHT) {
+          seekTick = shownTick + REPLAY_SEEK_STEP;
+        }
 
-      else if (e.type == SDL_MOUSEBUTTONDOWN) {
-        if (e.button.button == SDL_BUTTON_LEFT) {
-          leftClick = true;
+        else if (replaying && e.key.keysym.sym == SDLK_HOME) {
+          seekTick = 0;
         }
       }
 
-      else if (e.type == SDL_MOUSEBUTTONUP) {
-        if (e.button.button == SDL_BUTTON_LEFT) {
-          leftClick = false;
+      // baked map chunks are lost along with the render targets
+      else if (e.type == SDL_RENDER_TARGETS_RESET) {
+        gMapRenderer.Invalidate();
+      }
+
+      // Camera
+
+      // zoom toward whatever's under the mouse
+      else if (e.type == SDL_MOUSEWHEEL &&
+               IsWithinLevel(gInput.GetMouseX(), gInput.GetMouseY())) {
+        int mouseX = gInput.GetMouseX();
+        int mouseY = gInput.GetMouseY();
+
+        if (e.wheel.y > 0) {
+          gCamera.ZoomAt(CAMERA_ZOOM_STEP, mouseX, mouseY);
+        } else if (e.wheel.y < 0) {
+          gCamera.ZoomAt(1 / CAMERA_ZOOM_STEP, mouseX, mouseY);
         }
       }
 
       // Individual Event Handling
 
       buttonRedTank.HandleEvent(&e);
+      buttonGreenTank.HandleEvent(&e);
+      buttonYellowTank.HandleEvent(&e);
     }
 
-    // move target if holding left click somewhere within the level
-    mouseWithinLevel = mouseX > 0 && mouseX <= LEVEL_WIDTH && mouseY > 0 &&
-                       mouseY <= LEVEL_HEIGHT;
+    // drag with the middle button to pan, once for all of this frame's motion
+    int dragX, dragY;
+    gInput.TakeDrag(&dragX, &dragY);
 
-    if (leftClick && mouseWithinLevel) {
-      bool shouldSnap = crosshairSnapX >= 0 && crosshairSnapY >= 0;
+    if (dragX != 0 || dragY != 0) {
+      gCamera.Pan(-dragX, -dragY);
+    }
 
-      if (shouldSnap) {
-        enemyTargetX = crosshairSnapX;
-        enemyTargetY = crosshairSnapY;
-      }
+    // pan with wasd too
+    const Uint8 *keys = SDL_GetKeyboardState(NULL);
 
-      else {
-        enemyTargetX = mouseX;
-        enemyTargetY = mouseY;
-      }
+    float panX = keys[SDL_SCANCODE_D] - keys[SDL_SCANCODE_A];
+    float panY = keys[SDL_SCANCODE_S] - keys[SDL_SCANCODE_W];
+
+    if (panX != 0 || panY != 0) {
+      gCamera.Pan(panX * CAMERA_PAN_SPEED * dt, panY * CAMERA_PAN_SPEED * dt);
     }
 
-    ClearOffBoundsProjectiles();
-    ClearFinishedEnemies();
+    // wait for the sim to hand us a new tick; no point redrawing the old one
+    bool isNew = false;
+    RDrawList *list = gDrawLists.Acquire(1000 / targetFps, &isNew);
+
+    if (!isNew) {
+      continue;
+    }
+
+    auto currentTime = std::chrono::high_resolution_clock::now();
+
+    dt = std::chrono::duration<float, std::chrono::seconds::period>(
+             currentTime - lastUpdateTime)
+             .count();
+
+    shownTick = list->tick;
+
+    PlaySounds(list);
+
+    gParticles.SpawnEffects(list->effects);
+    gParticles.Update(dt);
+    UpdateGUIText(list);
 
     // Drawing
 
+    auto drawStart = std::chrono::high_resolution_clock::now();
+
     SDL_SetRenderDrawColor(gRenderer, 0, 0, 0, 255);
 
     SDL_RenderClear(gRenderer);
 
+    // bake any map chunks coming into view before the camera scales things
+    gMapRenderer.Prepare(gRenderer, &gCamera);
+
+    if (gSceneTarget != NULL) {
+      SDL_SetRenderTarget(gRenderer, gSceneTarget);
+      SDL_RenderClear(gRenderer);
+    }
+
+    // level side is drawn through the camera; only what's in view gets
+    // submitted
+    gCamera.Begin(gRenderer);
+
     // render map
-    tMap0.Render(gRenderer, 0, 0, LEVEL_WIDTH, LEVEL_HEIGHT);
+    gMapRenderer.Render(gRenderer, &gCamera);
 
     // render crosshair
-    tCrosshair.Render(gRenderer, enemyTargetX, enemyTargetY, NULL, true);
+    // the mouse is read again as late as we can before it's drawn; while
+    // aiming it sits right under the cursor instead of wherever the sim had
+    // it a tick or two ago, and the sim snaps it to towers once it catches up
+    gInput.Latch();
+
+    int targetX, targetY;
+    int crosshairX, crosshairY;
+
+    if (AimTarget(&targetX, &targetY)) {
+      // move the target too; the sim takes care of snapping it to towers
+      if (targetX != sentTargetX || targetY != sentTargetY) {
+        gCommands.Push(C_SET_TARGET, targetX, targetY);
+
+        sentTargetX = targetX;
+        sentTargetY = targetY;
+      }
+
+      gCamera.WorldToView(targetX, targetY, &crosshairX, &crosshairY);
+    } else {
+      gCamera.WorldToView(list->enemyTargetX, list->enemyTargetY, &crosshairX,
+                          &crosshairY);
+    }
+
+    tCrosshair.Render(gRenderer, crosshairX, crosshairY, NULL, true);
+
+    DrawProjectiles(list);
+    DrawEnemies(list);
+    DrawTowers(list);
+
+    gRenderQueue.Flush(gRenderer);
+
+    // on top of everything it's blowing up
+    gParticles.Render(gRenderer, &gCamera);
 
-    UpdateProjectiles();
-    UpdateEnemies();
-    UpdateTowers();
+    gCamera.End(gRenderer);
 
     DrawUI();
 
+    if (showMemStats) {
+      UpdateMemStats();
+      DrawMemStats();
+    }
+
+    // blow the internal target up to fill the window
+    if (gSceneTarget != NULL) {
+      SDL_SetRenderTarget(gRenderer, NULL);
+      SDL_RenderCopy(gRenderer, gSceneTarget, NULL, NULL);
+    }
+
     SDL_RenderPresent(gRenderer);
 
+    int inputLatency = gInput.Presented();
+
+    if (inputLatency >= 0) {
+      gInputLatency.Record(inputLatency);
+    }
+
+    if (metricsOn) {
+      gMetrics.Record(metFrameTime, dt * 1000000);
+      gMetrics.Record(metRenderTime, MicrosecondsSince(drawStart));
+
+      if (inputLatency >= 0) {
+        gMetrics.Record(metInputLatency, (Uint64)inputLatency * 1000);
+      }
+    }
+
     // Before Next Frame
 
+    gFrameArena.Reset();
+
+    Uint64 frameAllocs = RMemory::GetThreadAllocs();
+
+    if (frameCount++ > ALLOC_CHECK_WARMUP) {
+      checkedFrames++;
+
+      if (frameAllocs != lastFrameAllocs) {
+        allocatingFrames++;
+      }
+    }
+
+    lastFrameAllocs = frameAllocs;
+
     lastUpdateTime = currentTime;
   }
 
@@ -0,0 +1,135 @@
+#include "REntity.hpp"
+#include "RPath.hpp"
+#include "RTargeting.hpp"
+#include "RWorld.hpp"
+#include <stdio.h>
+#include <vector>
+
+// Tower targeting check
+//
+// Places a tower the way the game does, with the range every tower gets,
+// next to a straight road with a handful of tanks on it, set up so every
+// policy has a different favourite, and one tank out of range that would
+// beat all of them. Passes if each policy picks the one it should and the
+// range is short enough that a query doesn't take in most of the level.
+//
+//   targeting_check
+
+const int TOWER_GRID_X = 4;
+const int TOWER_GRID_Y = 3;
+
+typedef struct RTankSetup {
+  const char *name;
+
+  // along the road from level with the tower, in percent of its range
+  int offset;
+  int health;
+} RTankSetup;
+
+// the road runs half the tower's range away from it; distances are to the
+// tower, in percent of its range
+const int TANK_COUNT = 5;
+const RTankSetup TANKS[TANK_COUNT] = {
+    {"ahead", 75, 50},   // 90; furthest along of those in range
+    {"near", 0, 40},     // 50
+    {"hurt", -60, 10},   // 78
+    {"fresh", -40, 90},  // 64
+    {"gone", 200, 100},  // 206; further and healthier, but out of range
+};
+
+typedef struct RPolicyCase {
+  RTargetPolicy policy;
+  const char *name;
+  int expected;
+} RPolicyCase;
+
+const int CASE_COUNT = 4;
+const RPolicyCase CASES[CASE_COUNT] = {
+    {T_FIRST, "first", 0},
+    {T_CLOSEST, "closest", 1},
+    {T_WEAKEST, "weakest", 2},
+    {T_STRONGEST, "strongest", 3},
+};
+
+int main() {
+  RWorld world;
+
+  int towerX = TOWER_GRID_X * TILE_WIDTH + TILE_WIDTH / 2;
+  int towerY = TOWER_GRID_Y * TILE_HEIGHT + TILE_HEIGHT / 2;
+
+  world.SpawnTower(TOWER_GRID_X, TOWER_GRID_Y);
+  REntity *tower = world.GetTowerAt(towerX, towerY);
+
+  if (tower == NULL) {
+    printf("Could not place the tower!\n");
+    return 1;
+  }
+
+  int range = (int)tower->GetRange();
+  bool ok = true;
+
+  // a query box much over half the level is close to a scan of everything
+  printf("tower range %dpx\n", range);
+
+  if (range <= 0 || range * 4 > LEVEL_WIDTH) {
+    printf("  FAIL: wanted a few tiles\n");
+    ok = false;
+  }
+
+  int roadY = towerY - range / 2;
+
+  SDL_Point points[2] = {{0, roadY}, {LEVEL_WIDTH, roadY}};
+
+  RPath road;
+  road.SetPoints(points, 2);
+
+  std::vector<REntity> tanks(TANK_COUNT, REntity(TANK));
+  std::vector<REntity *> enemies;
+
+  for (int i = 0; i < TANK_COUNT; ++i) {
+    REntity *tank = &tanks[i];
+
+    tank->SetPath(&road);
+    tank->SetSpeed(towerX + TANKS[i].offset * range / 100);
+    tank->MoveAlongPath(1);
+    tank->TakeDamage(tank->GetMaxHealth() - TANKS[i].health);
+
+    enemies.push_back(tank);
+  }
+
+  // same cells as the world's
+  RTargeting targeting;
+  targeting.Resize(LEVEL_WIDTH, LEVEL_HEIGHT, TILE_WIDTH);
+  targeting.Index(enemies);
+
+  std::vector<int> scratch;
+
+  for (int i = 0; i < CASE_COUNT; ++i) {
+    const RPolicyCase *test = &CASES[i];
+
+    tower->SetTargetPolicy(test->policy);
+    REntity *picked = targeting.FindTarget(tower, enemies, scratch);
+
+    const char *pickedName = "nothing";
+
+    for (int j = 0; j < TANK_COUNT; ++j) {
+      if (picked == enemies[j]) {
+        pickedName = TANKS[j].name;
+      }
+    }
+
+    bool right = picked == enemies[test->expected];
+
+    printf("%-9s picked %-7s %s\n", test->name, pickedName,
+           right ? "ok" : "FAIL");
+
+    if (!right) {
+      printf("  wanted %s\n", TANKS[test->expected].name);
+      ok = false;
+    }
+  }
+
+  printf("\n%s\n", ok ? "targeting_check passed" : "targeting_check FAILED");
+
+  return ok ? 0 : 1;
+}